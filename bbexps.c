@@ -4,33 +4,784 @@
 #include <time.h>
 
 #include "bbsearch.h"
+#include "cache.h"
 #include "dag.h"
+#include "gen.h"
+#include "listsched.h"
 #include "parser.h"
+#include "schedule.h"
+#include "tuning.h"
+
+static void usage(const char *prog) {
+    printf("Usage: %s <patterson file> m timeout [options]\n", prog);
+    printf("or: %s <patterson file> \"dot\"\n", prog);
+    printf("or: %s gen <n> [gen options]\n", prog);
+    printf("options:\n");
+    printf("  --bounds <list>  comma separated bound stages to run, from\n"
+           "                   cheap, fernandez and fujita, or none\n");
+    printf("  --adaptive       skip bound stages that rarely prune\n");
+    printf("  --branch <policy>\n"
+           "                   order to try children in: level (default),\n"
+           "                   weight, succs, slack or bound\n");
+    printf("  --search <driver>\n"
+           "                   how to explore the search tree: dfs\n"
+           "                   (default), lds for limited discrepancy\n"
+           "                   search or restarts for randomized restarts\n");
+    printf("  --search-seed <s>\n"
+           "                   random seed of the restarts, default 1\n");
+    printf("  --direction <d>  search the dag forward (default), reverse,\n"
+           "                   auto to pick one by the dag's shape, or race\n"
+           "                   to search both on two threads and keep the\n"
+           "                   first to finish\n");
+    printf("  --portfolio      race cheap,fujita, cheap,fernandez and no\n"
+           "                   bounds on three threads that share their\n"
+           "                   best schedules, and stop at the first\n"
+           "                   proof. The timeout counts all three.\n");
+    printf("  --no-decompose   search the whole dag even if it splits into\n"
+           "                   series blocks\n");
+    printf("  --no-dp          never hand small dags that a short search\n"
+           "                   leaves open to the dynamic program\n");
+    printf("  --beam <w>       build a schedule by beam search of width w\n"
+           "                   instead, ignoring the timeout, and also\n"
+           "                   print the root bound and the relative gap\n"
+           "                   to it. Only the cheap bounds are used\n"
+           "                   unless --bounds is given.\n");
+    printf("  --threads <t>    threads of the beam search, or the most\n"
+           "                   that --auto may use, default 1\n");
+    printf("  --heuristic      build a schedule by list scheduling instead,\n"
+           "                   for dags too large to search, ignoring the\n"
+           "                   timeout, and also print the bound of the\n"
+           "                   critical path and the total work and the\n"
+           "                   relative gap to it\n");
+    printf("  --priority <rule>\n"
+           "                   the list scheduling priority: level\n"
+           "                   (default), weight or succs\n");
+    printf("  --auto           pick the engine, bounds, driver, dynamic\n"
+           "                   program and threads from the dag's size,\n"
+           "                   width, order strength and m / width, and\n"
+           "                   log the choice to stderr\n");
+    printf("  --rules <file>   like --auto, with the rules in the file\n");
+    printf("  --stats          print search statistics to stderr\n");
+    printf("  --cache <dir>    answer from and store results in a cache\n"
+           "                   directory keyed by the dag's content, m and\n"
+           "                   the search options. A timed out entry is\n"
+           "                   searched again, from its best schedule,\n"
+           "                   only with a longer timeout.\n");
+    printf("  --checkpoint <file>\n"
+           "                   save the search's progress to the file\n"
+           "                   periodically and when it times out\n");
+    printf("  --checkpoint-interval <seconds>\n"
+           "                   time between checkpoints, default 60\n");
+    printf("  --resume <file>  continue the search saved in a checkpoint\n");
+    printf("  --trace <file>   write a binary trace of the search, which\n"
+           "                   trace.py summarizes\n");
+    printf("  --edit-bench <count>\n"
+           "                   time re-solves against cold solves after\n"
+           "                   adding each of `count' random edges\n");
+    printf("  --emit-schedule <csv|json>\n"
+           "                   after the result, print each task's machine\n"
+           "                   and start and end times\n");
+    printf("  --validate <file>\n"
+           "                   check a schedule in the CSV format of\n"
+           "                   --emit-schedule instead of searching\n");
+    printf("  --split <k> <base>\n"
+           "                   split the search into at least k shards,\n"
+           "                   written to <base>.0, <base>.1, ..., and\n"
+           "                   print their paths\n");
+    printf("  --solve-shard <file>\n"
+           "                   search only the subtree of a shard file\n");
+    printf("  --incumbent <file>\n"
+           "                   with --solve-shard, poll the file for\n"
+           "                   better makespans found by other shards\n");
+    printf("gen options, to write a random layered dag of n tasks in\n"
+           "Patterson format:\n");
+    printf("  --width <w>      tasks per layer, default 10\n");
+    printf("  --order-strength <os>\n"
+           "                   choose the width for about this fraction of\n"
+           "                   ordered task pairs at density 1\n");
+    printf("  --density <p>    probability of each edge between consecutive\n"
+           "                   layers beyond one predecessor per task,\n"
+           "                   default 0.2\n");
+    printf("  --weights <lo> <hi>\n"
+           "                   range of task weights, default 1 to 10\n");
+    printf("  --seed <s>       random seed, default 1\n");
+    printf("  --out <file>     write to the file instead of stdout\n");
+}
+
+static void print_stats(bbstats *stats) {
+    fprintf(stderr, "blocks: %lu\n", stats->blocks);
+    fprintf(stderr, "closed by width: %lu\n", stats->width_closed);
+    fprintf(stderr, "closed by critical path: %lu\n", stats->path_closed);
+    fprintf(stderr, "closed by root bound: %lu\n", stats->root_closed);
+    fprintf(stderr, "closed during search: %lu\n", stats->gap_closed);
+    fprintf(stderr, "closed by dynamic programming: %lu\n",
+            stats->dp_closed);
+    fprintf(stderr, "nodes: %lu\n", stats->nodes);
+    fprintf(stderr, "passes: %lu\n", stats->passes);
+    for (int i = 0; i < N_STAGES; i++) {
+        fprintf(stderr, "%s: tries %lu, prunes %lu, skips %lu\n",
+                bound_stage_name(i), stats->tries[i], stats->prunes[i],
+                stats->skips[i]);
+    }
+}
+
+// splits the search into shard files named <base>.<i> and prints their
+// paths. Returns 0 on success and 1 on failure.
+static int write_shards(dag *g, unsigned m, size_t k, const char *base) {
+    shard *shards;
+    size_t nshards;
+    if (bbsearch_split(g, m, k, &shards, &nshards) != 0) {
+        printf("Split failed\n");
+        return 1;
+    }
+    int err = 0;
+    size_t len = strlen(base) + 32;
+    char path[len];
+    for (size_t i = 0; i < nshards; i++) {
+        snprintf(path, len, "%s.%zu", base, i);
+        if (!err && shard_write(path, &shards[i]) != 0) {
+            printf("Writing %s failed\n", path);
+            err = 1;
+        }
+        else if (!err) {
+            printf("%s\n", path);
+        }
+        shard_destroy(&shards[i]);
+    }
+    free(shards);
+    return err;
+}
+
+static double seconds_since(clock_t start) {
+    return ((double) clock() - (double) start) / CLOCKS_PER_SEC;
+}
+
+// adds `count' distinct random edges to the solved dag `g', one at a
+// time, and compares a cold solve (searching a freshly parsed copy from
+// scratch) of each edited dag with a re-solve that starts from the
+// previous optimum. Both timings cover the edit and the search, not
+// building the copy. Returns 0 on success and 1 on failure.
+static int edit_bench(const char *path, dag *g, unsigned m, int timeout,
+                      const bbopts *opts, int count) {
+    size_t size = dag_size(g);
+    unsigned order[size];
+    int opt = bbsearch_warm(g, m, timeout, opts, NULL, order, NULL);
+    if (opt < 0 || size < 4 || dag_closure(g) != 0) {
+        printf("Solve failed\n");
+        return 1;
+    }
+    // the edges not implied by the existing ones, drawn without
+    // replacement
+    size_t npairs = 0;
+    unsigned (*pairs)[2] = malloc((size - 2) * (size - 3) / 2
+                                  * sizeof(*pairs));
+    if (pairs == NULL) {
+        return 1;
+    }
+    for (unsigned i = 1; i + 1 < size; i++) {
+        for (unsigned j = i + 1; j + 1 < size; j++) {
+            if (!dag_reaches(g, i, j)) {
+                pairs[npairs][0] = i;
+                pairs[npairs][1] = j;
+                npairs++;
+            }
+        }
+    }
+    if ((size_t) count > npairs) {
+        printf("Only %zu unordered pairs of tasks to add edges to\n",
+               npairs);
+        free(pairs);
+        return 1;
+    }
+    bbwarm warm = {.order = order};
+    double cold_total = 0;
+    double warm_total = 0;
+    int err = 1;
+    srand(1);
+    // file, m, edge, cold length, cold time, warm length, warm time
+    for (int trial = 0; trial < count; trial++) {
+        size_t pick = trial + rand() % (npairs - trial);
+        unsigned from = pairs[pick][0];
+        unsigned to = pairs[pick][1];
+        pairs[pick][0] = pairs[trial][0];
+        pairs[pick][1] = pairs[trial][1];
+
+        dag *cold;
+        if (parse_patterson(path, &cold) != 0) {
+            printf("Parse failed\n");
+            goto out;
+        }
+        clock_t start = clock();
+        if (dag_add_edge(cold, from, to) != 0) {
+            dag_destroy(cold);
+            goto out;
+        }
+        int cold_result = bbsearch_opts(cold, m, timeout, opts, NULL);
+        double cold_time = seconds_since(start);
+        dag_destroy(cold);
+
+        dag *edited = dag_subgraph(g, 1, size - 2);
+        if (edited == NULL) {
+            goto out;
+        }
+        start = clock();
+        if (dag_add_edge(edited, from, to) != 0) {
+            dag_destroy(edited);
+            goto out;
+        }
+        int warm_result = bbsearch_warm(edited, m, timeout, opts, &warm,
+                                        NULL, NULL);
+        double warm_time = seconds_since(start);
+        dag_destroy(edited);
+
+        printf("%s, %u, %u->%u, %d, %f, %d, %f\n", path, m, from, to,
+               cold_result, cold_time, warm_result, warm_time);
+        cold_total += cold_time;
+        warm_total += warm_time;
+    }
+    fprintf(stderr, "cold: %f s, warm: %f s\n", cold_total, warm_total);
+    err = 0;
+ out:
+    free(pairs);
+    return err;
+}
+
+// prints the machine, start and end time of every task of `g', other
+// than the source and sink, as CSV or JSON.
+static void emit_times(dag *g, unsigned m, unsigned makespan,
+                       const unsigned *starts, const unsigned *machines,
+                       const char *format) {
+    size_t size = dag_size(g);
+    int json = strcmp(format, "json") == 0;
+    if (json) {
+        printf("{\"m\": %u, \"makespan\": %u, \"tasks\": [", m,
+               makespan);
+    }
+    else {
+        printf("task,machine,start,end\n");
+    }
+    for (unsigned i = 1; i + 1 < size; i++) {
+        unsigned end = starts[i] + dag_weight(g, i);
+        if (json) {
+            printf("%s\n  {\"task\": %u, \"machine\": %u, \"start\": %u, "
+                   "\"end\": %u}", (i > 1) ? "," : "", i, machines[i],
+                   starts[i], end);
+        }
+        else {
+            printf("%u,%u,%u,%u\n", i, machines[i], starts[i], end);
+        }
+    }
+    if (json) {
+        printf("\n]}\n");
+    }
+}
+
+// prints the complete schedule `s' like emit_times. Returns 0 on
+// success and 1 on failure.
+static int emit_schedule(schedule *s, const char *format) {
+    dag *g = schedule_dag(s);
+    size_t size = dag_size(g);
+    unsigned starts[size];
+    unsigned machines[size];
+    if (schedule_assign(s, starts, machines) != 0 ||
+        schedule_verify(s, starts, machines) != 1) {
+        printf("Invalid schedule\n");
+        return 1;
+    }
+    emit_times(g, schedule_m(s), schedule_length(s), starts, machines,
+               format);
+    return 0;
+}
+
+static const unsigned *sort_starts;
+
+static int start_cmp(const void *a, const void *b) {
+    unsigned x = *(const unsigned *) a;
+    unsigned y = *(const unsigned *) b;
+    if (sort_starts[x] != sort_starts[y]) {
+        return (sort_starts[x] < sort_starts[y]) ? -1 : 1;
+    }
+    return (x > y) - (x < y);
+}
+
+// checks a schedule of `g' on `m' machines in the CSV format of
+// --emit-schedule. Returns 0 if it is feasible and 1 otherwise.
+static int validate_schedule(dag *g, unsigned m, const char *path) {
+    size_t size = dag_size(g);
+    // heuristic schedules can have millions of tasks, too many for the
+    // stack
+    unsigned *starts = malloc(3 * size * sizeof(*starts));
+    if (starts == NULL) {
+        printf("Out of memory\n");
+        return 1;
+    }
+    unsigned *machines = starts + size;
+    unsigned *order = starts + 2 * size;
+    memset(starts, -1, size * sizeof(*starts));
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        printf("Cannot open %s\n", path);
+        free(starts);
+        return 1;
+    }
+    unsigned task;
+    unsigned machine;
+    unsigned start;
+    unsigned end;
+    int err = fscanf(f, " task,machine,start,end") != 0;
+    while (!err && fscanf(f, "%u,%u,%u,%u", &task, &machine, &start,
+                          &end) == 4) {
+        if (task == 0 || task + 1 >= size || starts[task] != (unsigned) -1 ||
+            end != start + dag_weight(g, task)) {
+            err = 1;
+            break;
+        }
+        starts[task] = start;
+        machines[task] = machine;
+    }
+    fclose(f);
+    unsigned makespan = 0;
+    for (unsigned i = 1; i + 1 < size; i++) {
+        err |= starts[i] == (unsigned) -1;
+        unsigned end = starts[i] + dag_weight(g, i);
+        makespan = (end > makespan) ? end : makespan;
+        order[i] = i;
+    }
+    if (err) {
+        printf("Malformed schedule\n");
+        free(starts);
+        return 1;
+    }
+    starts[dag_source(g)] = 0;
+    machines[dag_source(g)] = 0;
+    starts[dag_sink(g)] = makespan;
+    machines[dag_sink(g)] = 0;
+    order[0] = dag_source(g);
+    order[size - 1] = dag_sink(g);
+    sort_starts = starts;
+    qsort(&order[1], size - 2, sizeof(*order), start_cmp);
+    schedule *s = schedule_create(g, m);
+    if (s == NULL) {
+        free(starts);
+        return 1;
+    }
+    for (size_t i = 0; i < size; i++) {
+        schedule_add(s, order[i]);
+    }
+    int valid = schedule_verify(s, starts, machines) == 1;
+    schedule_destroy(s);
+    free(starts);
+    if (valid) {
+        printf("valid, %u\n", makespan);
+    }
+    else {
+        printf("invalid\n");
+    }
+    return !valid;
+}
+
+// builds a schedule of `g' by beam search and prints it like a search
+// result, followed by the root bound and the gap to it. Times are wall
+// clock times, as the search may run on several threads.
+static int run_beam(const char *path, dag *g, unsigned m, size_t width,
+                    const bbopts *opts, int do_stats,
+                    const char *emit_format) {
+    size_t size = dag_size(g);
+    unsigned *order = malloc(size * sizeof(*order));
+    if (order == NULL) {
+        printf("Out of memory\n");
+        return 1;
+    }
+    struct timespec start, end;
+    timespec_get(&start, TIME_UTC);
+    unsigned bound = 0;
+    bbstats stats;
+    int result = bbsearch_beam(g, m, width, opts, order, &bound, &stats);
+    timespec_get(&end, TIME_UTC);
+    double t = (end.tv_sec - start.tv_sec) +
+        (end.tv_nsec - start.tv_nsec) / 1e9;
+    double gap = (result >= 0 && bound > 0) ?
+        (double) (result - (int) bound) / bound : 0;
+    // file, # nodes, m, schedule length, scheduling time, root bound,
+    // gap
+    printf("%s, %zu, %u, %d, %f, %u, %f\n", path, size - 2, m, result, t,
+           bound, gap);
+    if (do_stats) {
+        print_stats(&stats);
+    }
+    int err = result < 0;
+    if (result >= 0 && emit_format != NULL) {
+        schedule *s = schedule_create(g, m);
+        if (s == NULL) {
+            err = 1;
+        }
+        for (size_t i = 0; s != NULL && i < size; i++) {
+            schedule_add(s, order[i]);
+        }
+        if (s != NULL) {
+            schedule_build(s, 0);
+            err = emit_schedule(s, emit_format);
+            schedule_destroy(s);
+        }
+    }
+    free(order);
+    return err;
+}
+
+// builds a schedule of `g' by list scheduling and prints it like
+// run_beam, with the larger of the critical path and the work per
+// machine as the bound.
+static int run_heuristic(const char *path, dag *g, unsigned m,
+                         list_rule rule, const char *emit_format) {
+    size_t size = dag_size(g);
+    unsigned *starts = malloc(2 * size * sizeof(*starts));
+    if (starts == NULL) {
+        printf("Out of memory\n");
+        return 1;
+    }
+    unsigned *machines = starts + size;
+    clock_t start = clock();
+    int result = list_schedule(g, m, rule, starts, machines);
+    double t = seconds_since(start);
+    unsigned long long work = 0;
+    for (size_t i = 0; i < size; i++) {
+        work += dag_weight(g, i);
+    }
+    unsigned bound = dag_level(g, dag_source(g));
+    if ((work + m - 1) / m > bound) {
+        bound = (work + m - 1) / m;
+    }
+    double gap = (result >= 0 && bound > 0) ?
+        (double) (result - (int) bound) / bound : 0;
+    // file, # nodes, m, schedule length, scheduling time, bound, gap
+    printf("%s, %zu, %u, %d, %f, %u, %f\n", path, size - 2, m, result, t,
+           bound, gap);
+    if (result >= 0 && emit_format != NULL) {
+        emit_times(g, m, result, starts, machines, emit_format);
+    }
+    free(starts);
+    return result < 0;
+}
+
+// picks the engine and options for `g' on `m' machines by the rules in
+// `rules_path', or the built in ones if it is NULL, with at most
+// opts->threads threads, and logs the choice to stderr. Returns 0 on
+// success and -1 on failure.
+static int choose_engine(dag *g, unsigned m, const char *rules_path,
+                         bbopts *opts, int *heuristic) {
+    tuning *t = (rules_path != NULL) ? tuning_read(rules_path) :
+        tuning_default();
+    if (t == NULL) {
+        printf("Bad rules file\n");
+        return -1;
+    }
+    features f;
+    if (features_compute(g, m, &f) != 0) {
+        printf("Out of memory\n");
+        tuning_destroy(t);
+        return -1;
+    }
+    // dags above FEATURES_MAX_SIZE only have a size
+    if (f.width == 0) {
+        fprintf(stderr, "auto: n %zu, width n/a, order strength n/a, "
+                "m/width n/a", f.n);
+    }
+    else {
+        fprintf(stderr, "auto: n %zu, width %zu, order strength %f, "
+                "m/width %f", f.n, f.width, f.strength, f.ratio);
+    }
+    int index = tuning_match(t, &f);
+    if (index < 0) {
+        fprintf(stderr, ": no rule, defaults\n");
+        tuning_destroy(t);
+        return 0;
+    }
+    engine e;
+    tuning_apply(tuning_rule_get(t, index), opts->threads, &e, opts);
+    tuning_destroy(t);
+    *heuristic = e == ENGINE_HEURISTIC;
+    fprintf(stderr, ": rule %d, %s", index + 1, engine_name(e));
+    if (e == ENGINE_SEARCH) {
+        if (opts->portfolio) {
+            fprintf(stderr, ", portfolio");
+        }
+        else {
+            fprintf(stderr, ", bounds ");
+            const char *sep = "";
+            for (int i = 0; i < N_STAGES; i++) {
+                if (opts->bounds & (1u << i)) {
+                    fprintf(stderr, "%s%s", sep, bound_stage_name(i));
+                    sep = ",";
+                }
+            }
+            fprintf(stderr, "%s", (opts->bounds == 0) ? "none" : "");
+        }
+        // only depth first searches hand dags to the dynamic program
+        fprintf(stderr, ", %s%s, direction %s",
+                search_driver_name(opts->driver),
+                (opts->driver == SEARCH_DFS && opts->dp) ? ", dp" : "",
+                search_direction_name(opts->direction));
+    }
+    fprintf(stderr, "\n");
+    return 0;
+}
+
+// runs the gen subcommand. Returns 0 on success and 1 on failure.
+static int gen_main(int argc, char **argv) {
+    genopts opts;
+    genopts_init(&opts);
+    double os = -1;
+    int width_set = 0;
+    const char *out_path = NULL;
+    int input_err = atoll(argv[2]) <= 0;
+    opts.n = atoll(argv[2]);
+    for (int i = 3; i < argc && !input_err; i++) {
+        if (strcmp(argv[i], "--width") == 0 && i + 1 < argc) {
+            input_err = atoll(argv[++i]) <= 0;
+            opts.width = atoll(argv[i]);
+            width_set = 1;
+        }
+        else if (strcmp(argv[i], "--order-strength") == 0 && i + 1 < argc) {
+            os = atof(argv[++i]);
+            input_err = os < 0 || os > 1;
+        }
+        else if (strcmp(argv[i], "--density") == 0 && i + 1 < argc) {
+            opts.density = atof(argv[++i]);
+            input_err = opts.density < 0 || opts.density > 1;
+        }
+        else if (strcmp(argv[i], "--weights") == 0 && i + 2 < argc) {
+            int lo = atoi(argv[++i]);
+            int hi = atoi(argv[++i]);
+            input_err = lo < 0 || hi < lo;
+            opts.min_weight = lo;
+            opts.max_weight = hi;
+        }
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            opts.seed = strtoull(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        }
+        else {
+            input_err = 1;
+        }
+    }
+    if (input_err || (width_set && os >= 0)) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (os >= 0) {
+        opts.width = gen_width(opts.n, os);
+    }
+    FILE *f = stdout;
+    if (out_path != NULL && (f = fopen(out_path, "w")) == NULL) {
+        printf("Cannot open %s\n", out_path);
+        return 1;
+    }
+    int err = gen_patterson(f, &opts);
+    if (f != stdout && fclose(f) != 0) {
+        err = -1;
+    }
+    if (err != 0) {
+        printf("Failed to write the dag\n");
+        return 1;
+    }
+    return 0;
+}
 
 int main(int argc, char **argv) {
-    int m;
-    int timeout;
+    int m = 0;
+    int timeout = -1;
     int do_dot = 0;
+    int do_stats = 0;
     int input_err = 0;
+    int split = 0;
+    int edit_count = 0;
+    int beam_width = 0;
+    int bounds_set = 0;
+    int heuristic = 0;
+    // set by the options that --auto picks
+    int engine_set = 0;
+    int auto_select = 0;
+    const char *rules_path = NULL;
+    list_rule rule = LIST_LEVEL;
+    const char *emit_format = NULL;
+    const char *validate_path = NULL;
+    const char *split_base = NULL;
+    const char *shard_path = NULL;
+    const char *incumbent_path = NULL;
+    const char *cache_dir = NULL;
+    bbopts opts;
+    bbopts_init(&opts);
+    if (argc >= 3 && strcmp(argv[1], "gen") == 0) {
+        return gen_main(argc, argv);
+    }
     if (argc == 3) {
         do_dot = 1;
         if (strcmp(argv[2], "dot") != 0) {
             input_err = 1;
         }
     }
-    else if (argc == 4) {
+    else if (argc >= 4) {
         if ((m = atoi(argv[2])) <= 0) {
             input_err = 1;
         }
         timeout = atoi(argv[3]);
+        for (int i = 4; i < argc && !input_err; i++) {
+            if (strcmp(argv[i], "--bounds") == 0 && i + 1 < argc) {
+                if (bound_parse(argv[++i], &opts.bounds) != 0) {
+                    input_err = 1;
+                }
+                bounds_set = 1;
+                engine_set = 1;
+            }
+            else if (strcmp(argv[i], "--adaptive") == 0) {
+                opts.adaptive = 1;
+            }
+            else if (strcmp(argv[i], "--branch") == 0 && i + 1 < argc) {
+                if (branch_parse(argv[++i], &opts.branch) != 0) {
+                    input_err = 1;
+                }
+            }
+            else if (strcmp(argv[i], "--search") == 0 && i + 1 < argc) {
+                if (driver_parse(argv[++i], &opts.driver) != 0) {
+                    input_err = 1;
+                }
+                engine_set = 1;
+            }
+            else if (strcmp(argv[i], "--direction") == 0 && i + 1 < argc) {
+                if (direction_parse(argv[++i], &opts.direction) != 0) {
+                    input_err = 1;
+                }
+            }
+            else if (strcmp(argv[i], "--portfolio") == 0) {
+                opts.portfolio = 1;
+                engine_set = 1;
+            }
+            else if (strcmp(argv[i], "--search-seed") == 0 && i + 1 < argc) {
+                opts.seed = strtoull(argv[++i], NULL, 10);
+            }
+            else if (strcmp(argv[i], "--beam") == 0 && i + 1 < argc) {
+                if ((beam_width = atoi(argv[++i])) <= 0) {
+                    input_err = 1;
+                }
+                engine_set = 1;
+            }
+            else if (strcmp(argv[i], "--heuristic") == 0) {
+                heuristic = 1;
+                engine_set = 1;
+            }
+            else if (strcmp(argv[i], "--priority") == 0 && i + 1 < argc) {
+                if (list_rule_parse(argv[++i], &rule) != 0) {
+                    input_err = 1;
+                }
+            }
+            else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+                int threads = atoi(argv[++i]);
+                if (threads <= 0) {
+                    input_err = 1;
+                }
+                opts.threads = threads;
+            }
+            else if (strcmp(argv[i], "--no-decompose") == 0) {
+                opts.decompose = 0;
+            }
+            else if (strcmp(argv[i], "--no-dp") == 0) {
+                opts.dp = 0;
+                engine_set = 1;
+            }
+            else if (strcmp(argv[i], "--auto") == 0) {
+                auto_select = 1;
+            }
+            else if (strcmp(argv[i], "--rules") == 0 && i + 1 < argc) {
+                rules_path = argv[++i];
+                auto_select = 1;
+            }
+            else if (strcmp(argv[i], "--stats") == 0) {
+                do_stats = 1;
+            }
+            else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+                cache_dir = argv[++i];
+            }
+            else if (strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) {
+                opts.checkpoint_path = argv[++i];
+            }
+            else if (strcmp(argv[i], "--checkpoint-interval") == 0 &&
+                     i + 1 < argc) {
+                if ((opts.checkpoint_interval = atoi(argv[++i])) <= 0) {
+                    input_err = 1;
+                }
+            }
+            else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+                opts.trace_path = argv[++i];
+            }
+            else if (strcmp(argv[i], "--resume") == 0 && i + 1 < argc) {
+                opts.resume_path = argv[++i];
+            }
+            else if (strcmp(argv[i], "--emit-schedule") == 0 &&
+                     i + 1 < argc) {
+                emit_format = argv[++i];
+                if (strcmp(emit_format, "csv") != 0 &&
+                    strcmp(emit_format, "json") != 0) {
+                    input_err = 1;
+                }
+            }
+            else if (strcmp(argv[i], "--validate") == 0 && i + 1 < argc) {
+                validate_path = argv[++i];
+            }
+            else if (strcmp(argv[i], "--edit-bench") == 0 && i + 1 < argc) {
+                if ((edit_count = atoi(argv[++i])) <= 0) {
+                    input_err = 1;
+                }
+            }
+            else if (strcmp(argv[i], "--split") == 0 && i + 2 < argc) {
+                if ((split = atoi(argv[++i])) <= 0) {
+                    input_err = 1;
+                }
+                split_base = argv[++i];
+            }
+            else if (strcmp(argv[i], "--solve-shard") == 0 && i + 1 < argc) {
+                shard_path = argv[++i];
+            }
+            else if (strcmp(argv[i], "--incumbent") == 0 && i + 1 < argc) {
+                incumbent_path = argv[++i];
+            }
+            else {
+                input_err = 1;
+            }
+        }
     }
     else {
         input_err = 1;
     }
 
+    // shards and beams run the options' bounds on one search
+    if ((split && shard_path != NULL) ||
+        (incumbent_path != NULL && shard_path == NULL) ||
+        (opts.portfolio && (shard_path != NULL || beam_width ||
+                            bounds_set ||
+                            opts.direction == DIRECTION_RACE))) {
+        input_err = 1;
+    }
+    // the list scheduler runs no search
+    if (heuristic && (beam_width || cache_dir != NULL ||
+                      shard_path != NULL || split || opts.portfolio)) {
+        input_err = 1;
+    }
+    // --auto picks the engine itself, for one whole dag
+    if (auto_select && (engine_set || split || shard_path != NULL ||
+                        edit_count || validate_path != NULL ||
+                        opts.direction == DIRECTION_RACE)) {
+        input_err = 1;
+    }
+    // cached results come from plain searches only
+    if (cache_dir != NULL && (shard_path != NULL || beam_width ||
+                              opts.resume_path != NULL)) {
+        input_err = 1;
+    }
+
     if (input_err) {
-        printf("Usage: %s <patterson file> m timeout\n", argv[0]);
-        printf("or: %s <patterson file> \"dot\"\n", argv[0]);
+        usage(argv[0]);
         return 1;
     }
 
@@ -45,12 +796,114 @@ int main(int argc, char **argv) {
         return 0;
     }
 
+    if (split) {
+        int err = write_shards(g, m, split, split_base);
+        dag_destroy(g);
+        return err;
+    }
+
+    if (validate_path != NULL) {
+        int err = validate_schedule(g, m, validate_path);
+        dag_destroy(g);
+        return err;
+    }
+
+    if (edit_count) {
+        int err = edit_bench(argv[1], g, m, timeout, &opts, edit_count);
+        dag_destroy(g);
+        return err;
+    }
+
+    if (auto_select &&
+        choose_engine(g, m, rules_path, &opts, &heuristic) != 0) {
+        dag_destroy(g);
+        return 1;
+    }
+
+    if (heuristic && cache_dir != NULL) {
+        // the list scheduler runs no search to cache
+        cache_dir = NULL;
+    }
+
+    if (beam_width) {
+        // the expensive stages would run on every partial schedule
+        if (!bounds_set) {
+            opts.bounds = BOUND_CHEAP;
+        }
+        int err = run_beam(argv[1], g, m, beam_width, &opts, do_stats,
+                           emit_format);
+        dag_destroy(g);
+        return err;
+    }
+
+    if (heuristic) {
+        int err = run_heuristic(argv[1], g, m, rule, emit_format);
+        dag_destroy(g);
+        return err;
+    }
+
+    bbstats stats;
+    schedule *best = NULL;
     clock_t start = clock();
-    int result = bbsearch(g, m, timeout);
-    clock_t end = clock();
-    double t = ((double)end - (double)start) / CLOCKS_PER_SEC;
+    double t = 0;
+    cache_status status = CACHE_MISS;
+    int result;
+    if (cache_dir != NULL) {
+        size_t size = dag_size(g);
+        unsigned *order = malloc(size * sizeof(*order));
+        if (order == NULL) {
+            printf("Out of memory\n");
+            return 1;
+        }
+        result = cache_solve(cache_dir, g, m, timeout, &opts, order, &stats,
+                             &t, &status);
+        if (result >= 0 && emit_format != NULL &&
+            (best = schedule_create(g, m)) != NULL) {
+            for (size_t i = 0; i < size; i++) {
+                schedule_add(best, order[i]);
+            }
+            schedule_build(best, 0);
+        }
+        free(order);
+    }
+    else if (shard_path != NULL) {
+        shard sh;
+        if (shard_read(shard_path, &sh) != 0 || sh.m != m) {
+            printf("Bad shard file\n");
+            return 1;
+        }
+        result = bbsearch_shard(g, &sh, timeout, incumbent_path, &opts,
+                                &stats);
+        shard_destroy(&sh);
+    }
+    else if (emit_format != NULL) {
+        result = bbsearch_best(g, m, timeout, &opts, &best, &stats);
+    }
+    else {
+        result = bbsearch_opts(g, m, timeout, &opts, &stats);
+    }
+    if (cache_dir == NULL) {
+        t = seconds_since(start);
+    }
 
     // file, # nodes, m, schedule length, scheduling time
     printf("%s, %zu, %u, %d, %f\n", argv[1], dag_size(g) - 2, m, result, t);
+    if (do_stats) {
+        print_stats(&stats);
+        if (cache_dir != NULL) {
+            static const char *status_names[] = {
+                [CACHE_MISS] = "miss",
+                [CACHE_HIT] = "hit",
+                [CACHE_WARM] = "warm",
+            };
+            fprintf(stderr, "cache: %s\n", status_names[status]);
+        }
+    }
+    int err = 0;
+    if (best != NULL) {
+        err = emit_schedule(best, emit_format);
+        schedule_destroy(best);
+    }
     dag_destroy(g);
+    return err;
 }
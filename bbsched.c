@@ -0,0 +1,326 @@
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bbsched.h"
+#include "bbsearch.h"
+#include "cache.h"
+#include "dag.h"
+#include "parser.h"
+#include "schedule.h"
+
+struct bbsched_dag {
+    dag *g;
+};
+
+// the per stage counters of bbsched_result
+_Static_assert(N_STAGES == 3, "bbsched_result needs a counter per stage");
+
+// the smallest structs bbsched_solve accepts: those of version 1
+#define OPTS_MIN_SIZE (offsetof(bbsched_opts, threads) + \
+                       sizeof(((bbsched_opts *) NULL)->threads))
+#define RESULT_MIN_SIZE (offsetof(bbsched_result, skips) + \
+                         sizeof(((bbsched_result *) NULL)->skips))
+
+int bbsched_version(void) {
+    return BBSCHED_VERSION;
+}
+
+// wraps `g', or destroys it and returns NULL on failure.
+static bbsched_dag *wrap(dag *g) {
+    bbsched_dag *d = malloc(sizeof(*d));
+    if (d == NULL) {
+        dag_destroy(g);
+        return NULL;
+    }
+    d->g = g;
+    return d;
+}
+
+bbsched_dag *bbsched_load(const char *path) {
+    assert(path != NULL);
+    dag *g;
+    if (parse_patterson(path, &g) != 0) {
+        return NULL;
+    }
+    return wrap(g);
+}
+
+bbsched_dag *bbsched_from_arrays(size_t n, const int *weights,
+                                 size_t nedges, const unsigned *from,
+                                 const unsigned *to) {
+    assert(n == 0 || weights != NULL);
+    assert(nedges == 0 || (from != NULL && to != NULL));
+    // the predecessors of task j, as dag vertices, are
+    // preds[first[j]] to preds[first[j + 1] - 1]
+    size_t *first = calloc(n + 1, sizeof(*first));
+    unsigned *preds = malloc((nedges + 1) * sizeof(*preds));
+    dag *g = dag_create();
+    if (first == NULL || preds == NULL || g == NULL) {
+        goto err;
+    }
+    for (size_t i = 0; i < nedges; i++) {
+        if (from[i] >= to[i] || to[i] >= n) {
+            goto err;
+        }
+        first[to[i]]++;
+    }
+    // first[j] becomes the end of task j's range, and then its start
+    // as the range is filled backwards
+    for (size_t j = 0; j < n; j++) {
+        first[j + 1] += first[j];
+    }
+    for (size_t i = nedges; i-- > 0;) {
+        preds[--first[to[i]]] = from[i] + 1;
+    }
+    for (size_t j = 0; j < n; j++) {
+        size_t npreds = first[j + 1] - first[j];
+        if (weights[j] < 0) {
+            goto err;
+        }
+        if (dag_vertex(g, weights[j], npreds, &preds[first[j]]) ==
+            (unsigned) -1) {
+            goto err;
+        }
+    }
+    if (dag_build(g) != 0) {
+        goto err;
+    }
+    free(first);
+    free(preds);
+    return wrap(g);
+ err:
+    free(first);
+    free(preds);
+    if (g != NULL) {
+        dag_destroy(g);
+    }
+    return NULL;
+}
+
+void bbsched_free(bbsched_dag *g) {
+    assert(g != NULL);
+    dag_destroy(g->g);
+    free(g);
+}
+
+size_t bbsched_ntasks(bbsched_dag *g) {
+    assert(g != NULL);
+    return dag_size(g->g) - 2;
+}
+
+// fills all of `opts' with the defaults.
+static void opts_defaults(bbsched_opts *opts) {
+    bbopts defaults;
+    bbopts_init(&defaults);
+    opts->size = sizeof(*opts);
+    opts->timeout = -1;
+    opts->bounds = NULL;
+    opts->branch = NULL;
+    opts->search = NULL;
+    opts->seed = defaults.seed;
+    opts->adaptive = defaults.adaptive;
+    opts->decompose = defaults.decompose;
+    opts->beam = 0;
+    opts->threads = defaults.threads;
+    opts->cache = NULL;
+    opts->direction = NULL;
+    opts->portfolio = defaults.portfolio;
+    opts->dp = defaults.dp;
+}
+
+void bbsched_opts_init(bbsched_opts *opts, size_t size) {
+    assert(opts != NULL);
+    assert(size >= sizeof(opts->size));
+    bbsched_opts defaults;
+    opts_defaults(&defaults);
+    // a caller with a newer header sets the fields this library lacks
+    memcpy(opts, &defaults, (size < sizeof(defaults)) ? size :
+           sizeof(defaults));
+    opts->size = size;
+}
+
+// converts the API's options into `opts'. Returns 0 on success and -1
+// on an unknown name.
+static int convert_opts(const bbsched_opts *in, bbopts *opts) {
+    bbopts_init(opts);
+    if (in->beam > 0) {
+        // the expensive stages would run on every partial schedule
+        opts->bounds = BOUND_CHEAP;
+    }
+    if (in->bounds != NULL && bound_parse(in->bounds, &opts->bounds) != 0) {
+        return -1;
+    }
+    if (in->branch != NULL && branch_parse(in->branch, &opts->branch) != 0) {
+        return -1;
+    }
+    if (in->search != NULL && driver_parse(in->search, &opts->driver) != 0) {
+        return -1;
+    }
+    if (in->direction != NULL &&
+        direction_parse(in->direction, &opts->direction) != 0) {
+        return -1;
+    }
+    if (in->threads == 0 ||
+        (in->beam > 0 && (in->cache != NULL || in->portfolio))) {
+        return -1;
+    }
+    opts->seed = in->seed;
+    opts->adaptive = in->adaptive;
+    opts->decompose = in->decompose;
+    opts->portfolio = in->portfolio;
+    opts->dp = in->dp;
+    opts->threads = in->threads;
+    return 0;
+}
+
+// stores the start times and machines of the tasks of the complete
+// schedule `s'. Returns 0 on success and -1 on failure.
+static int assign(schedule *s, unsigned *starts, unsigned *machines) {
+    size_t size = dag_size(schedule_dag(s));
+    unsigned *all = malloc(2 * size * sizeof(*all));
+    if (all == NULL || schedule_assign(s, all, all + size) != 0) {
+        free(all);
+        return -1;
+    }
+    memcpy(starts, all + 1, (size - 2) * sizeof(*starts));
+    memcpy(machines, all + size + 1, (size - 2) * sizeof(*machines));
+    free(all);
+    return 0;
+}
+
+// stores the start times and machines of the order of all tasks of
+// `g' on `m' machines. Returns 0 on success and -1 on failure.
+static int assign_order(dag *g, unsigned m, const unsigned *order,
+                        unsigned *starts, unsigned *machines) {
+    schedule *s = schedule_create(g, m);
+    for (size_t i = 0, size = dag_size(g); s != NULL && i < size; i++) {
+        schedule_add(s, order[i]);
+    }
+    int err = s == NULL || schedule_build(s, 0) != 0 ||
+        assign(s, starts, machines) != 0;
+    if (s != NULL) {
+        schedule_destroy(s);
+    }
+    return err ? -1 : 0;
+}
+
+// runs a beam search for bbsched_solve.
+static int solve_beam(dag *g, unsigned m, size_t width, const bbopts *opts,
+                      bbsched_result *res, bbstats *stats, unsigned *starts,
+                      unsigned *machines) {
+    size_t size = dag_size(g);
+    unsigned *order = malloc(size * sizeof(*order));
+    if (order == NULL) {
+        return -1;
+    }
+    struct timespec start, end;
+    timespec_get(&start, TIME_UTC);
+    int result = bbsearch_beam(g, m, width, opts, order, &res->bound, stats);
+    timespec_get(&end, TIME_UTC);
+    res->seconds = (end.tv_sec - start.tv_sec) +
+        (end.tv_nsec - start.tv_nsec) / 1e9;
+    if (result >= 0 && starts != NULL && machines != NULL &&
+        assign_order(g, m, order, starts, machines) != 0) {
+        result = -1;
+    }
+    free(order);
+    return result;
+}
+
+// solves through the cache for bbsched_solve.
+static int solve_cached(dag *g, unsigned m, const bbsched_opts *in,
+                        const bbopts *opts, bbsched_result *res,
+                        bbstats *stats, unsigned *starts,
+                        unsigned *machines) {
+    unsigned *order = malloc(dag_size(g) * sizeof(*order));
+    if (order == NULL) {
+        return -1;
+    }
+    int result = cache_solve(in->cache, g, m, in->timeout, opts, order,
+                             stats, &res->seconds, NULL);
+    if (result >= 0 && starts != NULL && machines != NULL &&
+        assign_order(g, m, order, starts, machines) != 0) {
+        result = -1;
+    }
+    free(order);
+    return result;
+}
+
+// solves `g' for bbsched_solve with options and a result of this
+// library's size.
+static int solve(bbsched_dag *g, unsigned m, const bbsched_opts *opts,
+                 bbsched_result *res, unsigned *starts, unsigned *machines) {
+    bbopts search_opts;
+    if (convert_opts(opts, &search_opts) != 0) {
+        return -1;
+    }
+    bbstats stats;
+    memset(&stats, 0, sizeof(stats));
+    if (opts->cache != NULL) {
+        res->makespan = solve_cached(g->g, m, opts, &search_opts, res,
+                                     &stats, starts, machines);
+    }
+    else if (opts->beam > 0) {
+        res->makespan = solve_beam(g->g, m, opts->beam, &search_opts, res,
+                                   &stats, starts, machines);
+    }
+    else if (starts != NULL && machines != NULL) {
+        schedule *best = NULL;
+        clock_t start = clock();
+        res->makespan = bbsearch_best(g->g, m, opts->timeout, &search_opts,
+                                      &best, &stats);
+        res->seconds = ((double) clock() - (double) start) / CLOCKS_PER_SEC;
+        if (best != NULL) {
+            if (assign(best, starts, machines) != 0) {
+                res->makespan = -1;
+            }
+            schedule_destroy(best);
+        }
+    }
+    else {
+        clock_t start = clock();
+        res->makespan = bbsearch_opts(g->g, m, opts->timeout, &search_opts,
+                                      &stats);
+        res->seconds = ((double) clock() - (double) start) / CLOCKS_PER_SEC;
+    }
+    res->blocks = stats.blocks;
+    res->width_closed = stats.width_closed;
+    res->path_closed = stats.path_closed;
+    res->root_closed = stats.root_closed;
+    res->gap_closed = stats.gap_closed;
+    res->dp_closed = stats.dp_closed;
+    res->nodes = stats.nodes;
+    res->passes = stats.passes;
+    for (int i = 0; i < N_STAGES; i++) {
+        res->tries[i] = stats.tries[i];
+        res->prunes[i] = stats.prunes[i];
+        res->skips[i] = stats.skips[i];
+    }
+    return res->makespan;
+}
+
+int bbsched_solve(bbsched_dag *g, unsigned m, const bbsched_opts *opts,
+                  bbsched_result *res, unsigned *starts,
+                  unsigned *machines) {
+    if (res == NULL || res->size < RESULT_MIN_SIZE) {
+        return -1;
+    }
+    size_t res_size = (res->size < sizeof(*res)) ? res->size : sizeof(*res);
+    bbsched_result full;
+    memset(&full, 0, sizeof(full));
+    full.makespan = -1;
+    if (g != NULL && m > 0 && opts != NULL && opts->size >= OPTS_MIN_SIZE) {
+        // the fields the caller's header lacks keep their defaults
+        bbsched_opts in;
+        opts_defaults(&in);
+        memcpy(&in, opts, (opts->size < sizeof(in)) ? opts->size :
+               sizeof(in));
+        solve(g, m, &in, &full, starts, machines);
+    }
+    full.size = res->size;
+    memcpy(res, &full, res_size);
+    return full.makespan;
+}
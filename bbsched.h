@@ -0,0 +1,124 @@
+#ifndef BBSCHED_H
+#define BBSCHED_H
+
+#include <stdlib.h>
+
+// A stable C API to the solver, exported by libbbsched.so for use from
+// other languages (see bbsched.py). Only opaque handles, plain numbers
+// and arrays cross it, so the solver's own headers can change without
+// breaking callers. Tasks are numbered from 0 and exclude the source
+// and sink: task i is vertex i + 1 of the dag, and vertex i + 2 of a
+// Patterson file.
+
+// bumped whenever a signature changes or a field is added. Fields are
+// only ever added at the end of a struct, and each struct starts with
+// its size, so a caller built against an older header keeps working
+// with a newer library.
+#define BBSCHED_VERSION 5
+
+#ifdef BBSCHED_EXPORT
+#define BBSCHED_API __attribute__((visibility("default")))
+#else
+#define BBSCHED_API
+#endif
+
+struct bbsched_dag;
+typedef struct bbsched_dag bbsched_dag;
+
+typedef struct bbsched_opts {
+    // sizeof(bbsched_opts) of the caller's header, set by
+    // bbsched_opts_init. Fields past it keep their defaults.
+    size_t size;
+    // seconds before an exact search gives up, or negative for none
+    int timeout;
+    // comma separated bound stages as for bbexps --bounds, the branching
+    // policy and the search driver, or NULL for the defaults
+    const char *bounds;
+    const char *branch;
+    const char *search;
+    unsigned long long seed;
+    int adaptive;
+    int decompose;
+    // if nonzero, build the schedule by beam search of this width on
+    // `threads' threads instead of searching exactly. Only the cheap
+    // bounds run unless `bounds' is set.
+    size_t beam;
+    unsigned threads;
+    // a cache directory as for bbexps --cache, or NULL for none. It
+    // cannot be combined with a beam search.
+    const char *cache;
+    // the search direction as for bbexps --direction, or NULL for the
+    // default
+    const char *direction;
+    // if nonzero, race the portfolio of bbexps --portfolio instead of
+    // running `bounds'. It cannot be combined with a beam search.
+    int portfolio;
+    // if nonzero, small dags that a short search leaves open are solved
+    // by dynamic programming, as by bbexps without --no-dp
+    int dp;
+} bbsched_opts;
+
+typedef struct bbsched_result {
+    // sizeof(bbsched_result) of the caller's header, which the caller
+    // sets. Fields past it are not written.
+    size_t size;
+    // the makespan, or -1 on error and -2 on time out
+    int makespan;
+    // the beam search's root lower bound, or 0
+    unsigned bound;
+    // processor time of an exact search, and wall time of a beam
+    // search, as bbexps reports them
+    double seconds;
+    // the counters of bbstats, indexed by bound stage where it applies:
+    // cheap, fernandez, fujita
+    unsigned long blocks;
+    unsigned long width_closed;
+    unsigned long path_closed;
+    unsigned long root_closed;
+    unsigned long gap_closed;
+    unsigned long nodes;
+    unsigned long passes;
+    unsigned long tries[3];
+    unsigned long prunes[3];
+    unsigned long skips[3];
+    unsigned long dp_closed;
+} bbsched_result;
+
+// returns BBSCHED_VERSION of the library, to check against the header
+// or binding the caller was written for.
+BBSCHED_API int bbsched_version(void);
+
+// reads a dag from a Patterson file, or returns NULL on failure.
+BBSCHED_API bbsched_dag *bbsched_load(const char *path);
+
+// builds a dag of `n' tasks with the given weights and the `nedges'
+// edges from[i] -> to[i]. Every edge must go from a smaller task to a
+// larger one, and no weight may be negative. Returns NULL if either
+// does not hold or on failure.
+BBSCHED_API bbsched_dag *bbsched_from_arrays(size_t n, const int *weights,
+                                             size_t nedges,
+                                             const unsigned *from,
+                                             const unsigned *to);
+
+BBSCHED_API void bbsched_free(bbsched_dag *g);
+
+// returns the number of tasks.
+BBSCHED_API size_t bbsched_ntasks(bbsched_dag *g);
+
+// fills `opts', of `size' bytes, with the defaults of bbexps: no
+// timeout and the build's default bounds, branching and driver, with
+// decomposition. Pass sizeof(*opts).
+BBSCHED_API void bbsched_opts_init(bbsched_opts *opts, size_t size);
+
+// solves `g' on `m' machines and fills `res'. The dag can be solved
+// again, with any number of machines or options. If `starts' and
+// `machines' are not NULL and a schedule is found, they receive the
+// start time and machine, from 0 to m - 1, of every task. Returns the
+// makespan like bbsearch, or -1 on bad options or arguments: no dag,
+// no machines, or a struct size that does not reach `threads' of
+// bbsched_opts or `skips' of bbsched_result.
+BBSCHED_API int bbsched_solve(bbsched_dag *g, unsigned m,
+                              const bbsched_opts *opts, bbsched_result *res,
+                              unsigned *starts, unsigned *machines);
+
+#endif // BBSCHED_H
@@ -0,0 +1,186 @@
+"""Call the solver in-process through libbbsched.so, built by
+`make libbbsched.so'. A loaded DAG can be solved any number of times,
+with different machine counts and options, without starting a process
+or parsing its file again:
+
+    import bbsched
+    dag = bbsched.Dag.load("series/data1201/Pat0.rcp")
+    for m in (4, 8, 16):
+        result = dag.solve(m, timeout=60, bounds="cheap,fernandez")
+        print(m, result.makespan, result.seconds, result.nodes)
+
+Tasks are numbered from 0 and exclude the source and sink, as in
+bbsched.h.
+"""
+
+import ctypes
+import os
+
+# must match BBSCHED_VERSION and the structs of bbsched.h. A newer
+# library only appends fields, so it accepts these structs too.
+VERSION = 5
+STAGES = ["cheap", "fernandez", "fujita"]
+
+class Opts(ctypes.Structure):
+    _fields_ = [
+        ("size", ctypes.c_size_t),
+        ("timeout", ctypes.c_int),
+        ("bounds", ctypes.c_char_p),
+        ("branch", ctypes.c_char_p),
+        ("search", ctypes.c_char_p),
+        ("seed", ctypes.c_ulonglong),
+        ("adaptive", ctypes.c_int),
+        ("decompose", ctypes.c_int),
+        ("beam", ctypes.c_size_t),
+        ("threads", ctypes.c_uint),
+        ("cache", ctypes.c_char_p),
+        ("direction", ctypes.c_char_p),
+        ("portfolio", ctypes.c_int),
+        ("dp", ctypes.c_int),
+    ]
+
+class Result(ctypes.Structure):
+    _fields_ = [
+        ("size", ctypes.c_size_t),
+        ("makespan", ctypes.c_int),
+        ("bound", ctypes.c_uint),
+        ("seconds", ctypes.c_double),
+        ("blocks", ctypes.c_ulong),
+        ("width_closed", ctypes.c_ulong),
+        ("path_closed", ctypes.c_ulong),
+        ("root_closed", ctypes.c_ulong),
+        ("gap_closed", ctypes.c_ulong),
+        ("nodes", ctypes.c_ulong),
+        ("passes", ctypes.c_ulong),
+        ("tries", ctypes.c_ulong * len(STAGES)),
+        ("prunes", ctypes.c_ulong * len(STAGES)),
+        ("skips", ctypes.c_ulong * len(STAGES)),
+        ("dp_closed", ctypes.c_ulong),
+    ]
+
+    def stats(self):
+        """Returns the counters as a dict, keyed like bbexps --stats."""
+        stats = {name: getattr(self, name) for name in [
+            "blocks", "width_closed", "path_closed", "root_closed",
+            "gap_closed", "dp_closed", "nodes", "passes"]}
+        for i, stage in enumerate(STAGES):
+            stats[stage] = {"tries": self.tries[i],
+                            "prunes": self.prunes[i],
+                            "skips": self.skips[i]}
+        return stats
+
+def _load_library(path=None):
+    if path is None:
+        path = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                            "libbbsched.so")
+    lib = ctypes.CDLL(path)
+    lib.bbsched_version.restype = ctypes.c_int
+    lib.bbsched_load.argtypes = [ctypes.c_char_p]
+    lib.bbsched_load.restype = ctypes.c_void_p
+    lib.bbsched_from_arrays.argtypes = [
+        ctypes.c_size_t, ctypes.POINTER(ctypes.c_int), ctypes.c_size_t,
+        ctypes.POINTER(ctypes.c_uint), ctypes.POINTER(ctypes.c_uint)]
+    lib.bbsched_from_arrays.restype = ctypes.c_void_p
+    lib.bbsched_free.argtypes = [ctypes.c_void_p]
+    lib.bbsched_free.restype = None
+    lib.bbsched_ntasks.argtypes = [ctypes.c_void_p]
+    lib.bbsched_ntasks.restype = ctypes.c_size_t
+    lib.bbsched_opts_init.argtypes = [ctypes.POINTER(Opts), ctypes.c_size_t]
+    lib.bbsched_opts_init.restype = None
+    lib.bbsched_solve.argtypes = [
+        ctypes.c_void_p, ctypes.c_uint, ctypes.POINTER(Opts),
+        ctypes.POINTER(Result), ctypes.POINTER(ctypes.c_uint),
+        ctypes.POINTER(ctypes.c_uint)]
+    lib.bbsched_solve.restype = ctypes.c_int
+    if lib.bbsched_version() < VERSION:
+        raise ImportError("{} has version {}, expected {} or later".format(
+            path, lib.bbsched_version(), VERSION))
+    return lib
+
+_lib = _load_library(os.environ.get("BBSCHED_LIBRARY"))
+
+def _encode(value):
+    return None if value is None else value.encode()
+
+class Dag:
+    """A DAG held by the library. Use load or from_arrays to create one,
+    and close it, or use it as a context manager, to free it early."""
+
+    def __init__(self, handle):
+        self._handle = handle
+        if not handle:
+            raise ValueError("could not build the dag")
+
+    @classmethod
+    def load(cls, path):
+        """Reads a DAG from a Patterson file."""
+        return cls(_lib.bbsched_load(path.encode()))
+
+    @classmethod
+    def from_arrays(cls, weights, edges):
+        """Builds a DAG with the given non-negative task weights and
+        (from, to) edges, where every edge goes from a smaller task to a
+        larger one."""
+        n = len(weights)
+        c_weights = (ctypes.c_int * n)(*weights)
+        c_from = (ctypes.c_uint * len(edges))(*[e[0] for e in edges])
+        c_to = (ctypes.c_uint * len(edges))(*[e[1] for e in edges])
+        return cls(_lib.bbsched_from_arrays(n, c_weights, len(edges),
+                                            c_from, c_to))
+
+    def __len__(self):
+        return _lib.bbsched_ntasks(self._handle)
+
+    def close(self):
+        if self._handle:
+            _lib.bbsched_free(self._handle)
+            self._handle = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def __del__(self):
+        self.close()
+
+    def solve(self, m, timeout=-1, bounds=None, branch=None, search=None,
+              direction=None, seed=None, adaptive=False, decompose=True,
+              portfolio=False, dp=True, beam=0, threads=1, cache=None,
+              schedule=False):
+        """Solves the DAG on m machines and returns a Result, whose
+        makespan is -2 on time out. The options are those of bbexps, with
+        None for the defaults, and cache a directory as for --cache.
+        With schedule=True the result also gets `starts' and `machines',
+        the start time and machine of every task, if a schedule was
+        found."""
+        opts = Opts()
+        _lib.bbsched_opts_init(ctypes.byref(opts), ctypes.sizeof(opts))
+        opts.timeout = timeout
+        opts.bounds = _encode(bounds)
+        opts.branch = _encode(branch)
+        opts.search = _encode(search)
+        opts.direction = _encode(direction)
+        if seed is not None:
+            opts.seed = seed
+        opts.adaptive = int(adaptive)
+        opts.decompose = int(decompose)
+        opts.portfolio = int(portfolio)
+        opts.dp = int(dp)
+        opts.beam = beam
+        opts.threads = threads
+        opts.cache = _encode(cache)
+        result = Result(size=ctypes.sizeof(Result))
+        starts = machines = None
+        if schedule:
+            starts = (ctypes.c_uint * len(self))()
+            machines = (ctypes.c_uint * len(self))()
+        err = _lib.bbsched_solve(self._handle, m, ctypes.byref(opts),
+                                 ctypes.byref(result), starts, machines)
+        if err == -1:
+            raise ValueError("solve failed; check the options")
+        if schedule and result.makespan >= 0:
+            result.starts = list(starts)
+            result.machines = list(machines)
+        return result
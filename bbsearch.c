@@ -1,25 +1,295 @@
 #include <assert.h>
 #include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <stdio.h>
 
-#include "binheap.h"
 #include "bitmap.h"
+#include "bucketq.h"
 #include "dag.h"
+#include "dp.h"
 #include "schedule.h"
+#include "shard.h"
 #include "bbsearch.h"
+#include "checkpoint.h"
+#include "trace.h"
 
-static int do_timeout;
-static clock_t end_time;
+// widths, which take a bipartite matching over the closure, are only
+// computed for dags up to this size
+#define WIDTH_MAX_SIZE (1 << 12)
+
+// the adaptive pipeline trusts a stage's hit rate at a depth after it
+// has run this many times there
+#define ADAPT_WARMUP (32)
+// and then skips it if it prunes less than once per ADAPT_RATE runs,
+#define ADAPT_RATE (32)
+// except at every ADAPT_PROBE-th visit, which keeps the rate current
+#define ADAPT_PROBE (16)
+
+// small blocks are searched for this many nodes before the dynamic
+// program takes over, which gives them back to the search after this
+// many labels
+#define DP_PROBE_NODES (1 << 14)
+#define DP_MAX_LABELS (1 << 18)
+
+// shard solves reread their incumbent file every this many nodes
+#define POLL_NODES (1 << 12)
+
+// traced events are written out this many at a time
+#define TRACE_EVENTS (1 << 16)
+
+// restart i is cut off after luby(i) times this many nodes
+#define RESTART_NODES (1 << 10)
+// and, after the first, adds random noise of up to a RESTART_NOISE-th
+// of the largest priority to each child's priority
+#define RESTART_NOISE (8)
+
+// the best schedules the searches of a portfolio have found, per
+// series block, in the block's own ids. A block's length only ever
+// falls, and its order is written together with it under the lock.
+typedef struct shared_best {
+    pthread_mutex_t lock;
+    size_t nblocks;
+    atomic_uint *lens;
+    unsigned **orders;
+} shared_best;
+
+// settings and progress shared by the searches of all blocks of one
+// bbsearch_opts call
+typedef struct bbrun {
+    unsigned m;
+    int do_timeout;
+    clock_t end_time;
+    // set by another thread to stop the search as if it timed out, or
+    // NULL
+    atomic_int *cancel;
+    // the best schedules of the other searches of a portfolio, which
+    // bound this one's, or NULL
+    shared_best *shared;
+    const bbopts *opts;
+    bbstats *stats;
+    // the block being searched, and the sum of the makespans of the
+    // blocks before it
+    unsigned block;
+    unsigned done;
+    // the checkpoint to resume, or NULL once it has been resumed
+    checkpoint *resume;
+    clock_t next_checkpoint;
+    // where search events go, or NULL if they are not traced
+    tracer *trace;
+} bbrun;
+
+// state shared by all nodes of one search
+typedef struct bbctx {
+    dag *g;
+    schedule *s;
+    bitmap *ready_set;
+    const bbopts *opts;
+    bbstats *stats;
+    int do_timeout;
+    clock_t end_time;
+    atomic_int *cancel;
+    // the strongest lower bound on the whole dag. Once the incumbent
+    // reaches it `stop' is set, and the search unwinds without trying
+    // the remaining children.
+    unsigned root_bound;
+    int stop;
+    // when solving a shard, a file holding the best makespan found by
+    // other processes, and the last value read from it
+    const char *incumbent_path;
+    unsigned external;
+    // the run this search belongs to, or NULL for shards
+    bbrun *run;
+    // where search events go, or NULL if they are not traced
+    tracer *trace;
+    // the best complete schedule found so far and its length. The
+    // first `best_same' tasks of the current schedule are known to
+    // match it, so only the rest is copied when it improves.
+    unsigned *best_order;
+    unsigned best_len;
+    size_t best_same;
+    // while resuming, the path to the checkpointed node. At depth d
+    // only the child resume[d] is tried, and the children after it.
+    const unsigned *resume;
+    size_t resume_len;
+    // one child queue per search depth, reused across nodes. Created
+    // when the depth is first reached, so a search that stops early on
+    // a large dag does not pay for all of them.
+    bucketq **sorters;
+    // the largest child priority under the branching policy
+    unsigned max_prio;
+    // under the weight and succs policies, each task's rank among the
+    // distinct keys of all tasks, which is its priority. Packing the
+    // keys into one number instead would size the child queues by the
+    // product of their ranges. NULL under the other policies.
+    unsigned *ranks;
+    // the largest priority the child queues hold
+    unsigned sorter_max;
+    // limits of the driver's current pass: the child ranks above 0
+    // still allowed on the current path, and the nodes left. `cut' is
+    // set when either skipped part of the tree. Unlimited for
+    // SEARCH_DFS.
+    unsigned discrepancies;
+    unsigned long nodes_left;
+    int cut;
+    // the largest random noise added to child priorities, or 0, and the
+    // state of the random number generator
+    unsigned noise;
+    uint64_t rand;
+    // dominators[j] is the set of tasks that, when ready together
+    // with `j', make scheduling `j' next unnecessary. NULL if the dag
+    // has no closure or the search timed out before they were set.
+    bitmap **dominators;
+    // per depth and stage: how often the stage was reached, how often
+    // it ran and how often it pruned. Indexed by
+    // depth * N_STAGES + stage.
+    unsigned long *reached;
+    unsigned long *tries;
+    unsigned long *prunes;
+} bbctx;
+
+static const char *stage_names[N_STAGES] = {
+    [STAGE_CHEAP] = "cheap",
+    [STAGE_FERNANDEZ] = "fernandez",
+    [STAGE_FUJITA] = "fujita",
+};
+
+static const char *branch_names[N_BRANCH_POLICIES] = {
+    [BRANCH_LEVEL] = "level",
+    [BRANCH_WEIGHT] = "weight",
+    [BRANCH_SUCCS] = "succs",
+    [BRANCH_SLACK] = "slack",
+    [BRANCH_BOUND] = "bound",
+};
+
+static const char *driver_names[N_SEARCH_DRIVERS] = {
+    [SEARCH_DFS] = "dfs",
+    [SEARCH_LDS] = "lds",
+    [SEARCH_RESTARTS] = "restarts",
+};
+
+static const char *direction_names[N_SEARCH_DIRECTIONS] = {
+    [DIRECTION_FORWARD] = "forward",
+    [DIRECTION_REVERSE] = "reverse",
+    [DIRECTION_AUTO] = "auto",
+    [DIRECTION_RACE] = "race",
+};
+
+void bbopts_init(bbopts *opts) {
+    assert(opts != NULL);
+    opts->bounds = BOUND_CHEAP | BOUND_FUJITA;
+    opts->adaptive = 0;
+    opts->branch = BRANCH_LEVEL;
+    opts->driver = SEARCH_DFS;
+    opts->seed = 1;
+    opts->direction = DIRECTION_FORWARD;
+    opts->portfolio = 0;
+    opts->threads = 1;
+    opts->decompose = 1;
+    opts->dp = 1;
+    opts->checkpoint_path = NULL;
+    opts->checkpoint_interval = 60;
+    opts->resume_path = NULL;
+    opts->trace_path = NULL;
+}
+
+const char *bound_stage_name(bound_stage stage) {
+    assert(stage < N_STAGES);
+    return stage_names[stage];
+}
+
+int bound_parse(const char *list, unsigned *bounds) {
+    assert(list != NULL);
+    assert(bounds != NULL);
+    *bounds = 0;
+    if (strcmp(list, "none") == 0) {
+        return 0;
+    }
+    while (*list != '\0') {
+        size_t len = strcspn(list, ",");
+        int found = 0;
+        for (int i = 0; i < N_STAGES; i++) {
+            if (strlen(stage_names[i]) == len &&
+                strncmp(list, stage_names[i], len) == 0) {
+                *bounds |= 1u << i;
+                found = 1;
+            }
+        }
+        if (!found) {
+            return -1;
+        }
+        list += (list[len] == ',') ? len + 1 : len;
+    }
+    return 0;
+}
+
+const char *branch_policy_name(branch_policy policy) {
+    assert(policy < N_BRANCH_POLICIES);
+    return branch_names[policy];
+}
+
+int branch_parse(const char *name, branch_policy *policy) {
+    assert(name != NULL);
+    assert(policy != NULL);
+    for (int i = 0; i < N_BRANCH_POLICIES; i++) {
+        if (strcmp(name, branch_names[i]) == 0) {
+            *policy = i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char *search_driver_name(search_driver driver) {
+    assert(driver < N_SEARCH_DRIVERS);
+    return driver_names[driver];
+}
+
+int driver_parse(const char *name, search_driver *driver) {
+    assert(name != NULL);
+    assert(driver != NULL);
+    for (int i = 0; i < N_SEARCH_DRIVERS; i++) {
+        if (strcmp(name, driver_names[i]) == 0) {
+            *driver = i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char *search_direction_name(search_direction direction) {
+    assert(direction < N_SEARCH_DIRECTIONS);
+    return direction_names[direction];
+}
+
+int direction_parse(const char *name, search_direction *direction) {
+    assert(name != NULL);
+    assert(direction != NULL);
+    for (int i = 0; i < N_SEARCH_DIRECTIONS; i++) {
+        if (strcmp(name, direction_names[i]) == 0) {
+            *direction = i;
+            return 0;
+        }
+    }
+    return -1;
+}
 
 int fujita_bound(schedule *s) {
     dag *g = schedule_dag(s);
+    // the search below takes the critical path length as too short, so
+    // try it first
+    schedule_build(s, dag_level(g, dag_source(g)));
+    if (schedule_machine_bound(s) <= schedule_m(s)) {
+        return dag_level(g, dag_source(g));
+    }
     unsigned delta = 1;
     while (1) {
-        /* printf("loop1\n"); */
         schedule_build(s, dag_level(g, dag_source(g)) + delta);
         int min_m = schedule_machine_bound(s);
-        /* printf("delta: %d, min_m: %d, m: %d\n", delta, min_m, schedule_m(s)); */
         if (min_m <= schedule_m(s)) {
             break;
         }
@@ -47,48 +317,450 @@ int fujita_bound(schedule *s) {
     return best_time;
 }
 
-int bb(schedule *s, bitmap *ready_set, unsigned best_soln) {
-    assert(s != NULL);
-    if (do_timeout && clock() >= end_time) {
+// returns a lower bound from the given stage for the partial schedule
+// `s', which has been built with the critical path length.
+static unsigned stage_bound(schedule *s, bound_stage stage) {
+    switch (stage) {
+    case STAGE_CHEAP: {
+        unsigned bound = schedule_work_bound(s);
+        unsigned path = schedule_path_bound(s);
+        return (path > bound) ? path : bound;
+    }
+    case STAGE_FERNANDEZ:
+        return schedule_fernandez_bound(s);
+    case STAGE_FUJITA:
+        return fujita_bound(s);
+    default:
+        return 0;
+    }
+}
+
+// returns the largest lower bound for `s' of the stages in the mask
+// `stages'.
+static unsigned strongest_bound(schedule *s, unsigned stages) {
+    unsigned bound = 0;
+    for (int stage = 0; stage < N_STAGES; stage++) {
+        if (!(stages & (1u << stage))) {
+            continue;
+        }
+        unsigned b = stage_bound(s, stage);
+        bound = (b > bound) ? b : bound;
+    }
+    return bound;
+}
+
+// records an event of the current node if the search is traced.
+static void ctx_trace(bbctx *ctx, trace_kind kind, unsigned stage,
+                      unsigned value, unsigned best) {
+    if (ctx->trace == NULL) {
+        return;
+    }
+    size_t depth = schedule_size(ctx->s);
+    trace_event event = {
+        .depth = depth,
+        .task = (depth > 0) ? schedule_get(ctx->s, depth - 1) : 0,
+        .value = value,
+        .best = best,
+        .kind = kind,
+        .stage = stage,
+        .block = (ctx->run != NULL) ? ctx->run->block : 0,
+    };
+    tracer_add(ctx->trace, event);
+}
+
+// returns 1 if the adaptive pipeline should skip `stage' at the
+// current depth.
+static int stage_skipped(bbctx *ctx, size_t slot) {
+    unsigned long tries = ctx->tries[slot];
+    return ctx->opts->adaptive && tries >= ADAPT_WARMUP &&
+        ctx->prunes[slot] * ADAPT_RATE < tries &&
+        ctx->reached[slot] % ADAPT_PROBE != 0;
+}
+
+// runs the stages of `bounds' in order and returns 1 as soon as one
+// shows the node cannot improve on `best_soln', 0 otherwise.
+static inline int run_pipeline(bbctx *ctx, unsigned best_soln,
+                               unsigned bounds) {
+    size_t depth = schedule_size(ctx->s);
+    for (int stage = 0; stage < N_STAGES; stage++) {
+        if (!(bounds & (1u << stage))) {
+            continue;
+        }
+        size_t slot = depth * N_STAGES + stage;
+        ctx->reached[slot]++;
+        if (stage_skipped(ctx, slot)) {
+            ctx->stats->skips[stage]++;
+            continue;
+        }
+        ctx->tries[slot]++;
+        ctx->stats->tries[stage]++;
+        unsigned bound = stage_bound(ctx->s, stage);
+        ctx_trace(ctx, TRACE_PROBE, stage, bound, best_soln);
+        if (bound >= best_soln) {
+            ctx->prunes[slot]++;
+            ctx->stats->prunes[stage]++;
+            ctx_trace(ctx, TRACE_PRUNE, stage, bound, best_soln);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// defines pipeline_BOUNDS, run_pipeline for a constant mask of stages.
+// The stage loop unrolls and the disabled stages drop out, so each
+// pipeline runs its stages back to back with no test of the mask.
+#define DEFINE_PIPELINE(BOUNDS)                                         \
+    static int pipeline_##BOUNDS(bbctx *ctx, unsigned best_soln) {      \
+        return run_pipeline(ctx, best_soln, BOUNDS);                    \
+    }
+
+_Static_assert(N_STAGES == 3, "bound_prunes needs a pipeline per mask");
+DEFINE_PIPELINE(0)
+DEFINE_PIPELINE(1)
+DEFINE_PIPELINE(2)
+DEFINE_PIPELINE(3)
+DEFINE_PIPELINE(4)
+DEFINE_PIPELINE(5)
+DEFINE_PIPELINE(6)
+DEFINE_PIPELINE(7)
+
+// runs the options' bound stages in order and returns 1 as soon as
+// one shows the node cannot improve on `best_soln', 0 otherwise.
+static int bound_prunes(bbctx *ctx, unsigned best_soln) {
+    switch (ctx->opts->bounds) {
+    case 0:
+        return pipeline_0(ctx, best_soln);
+    case 1:
+        return pipeline_1(ctx, best_soln);
+    case 2:
+        return pipeline_2(ctx, best_soln);
+    case 3:
+        return pipeline_3(ctx, best_soln);
+    case 4:
+        return pipeline_4(ctx, best_soln);
+    case 5:
+        return pipeline_5(ctx, best_soln);
+    case 6:
+        return pipeline_6(ctx, best_soln);
+    case 7:
+        return pipeline_7(ctx, best_soln);
+    default:
+        return run_pipeline(ctx, best_soln, ctx->opts->bounds);
+    }
+}
+
+// returns 1 if every predecessor of `i' is an ancestor of `j', so `i'
+// can always start as early as `j'.
+static int preds_precede(dag *g, unsigned i, unsigned j) {
+    size_t npreds = dag_npreds(g, i);
+    unsigned preds[npreds];
+    dag_preds(g, i, preds);
+    for (size_t k = 0; k < npreds; k++) {
+        if (!dag_reaches(g, preds[k], j)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// returns 1 if some optimal schedule starts `i' before `j' whenever
+// both are ready. That holds when the two have the same weight, `i'
+// can start whenever `j' can and everything that waits on `j' also
+// waits on `i': swapping them in any schedule keeps it valid and
+// keeps its length. Ties are broken by id.
+static int dominates(dag *g, unsigned i, unsigned j) {
+    if (i == j || dag_weight(g, i) != dag_weight(g, j) ||
+        !dag_descs_subset(g, j, i) || !preds_precede(g, i, j)) {
+        return 0;
+    }
+    if (dag_descs_subset(g, i, j) && preds_precede(g, j, i)) {
+        return i < j;
+    }
+    return 1;
+}
+
+static void destroy_dominators(bitmap **dominators, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        if (dominators[i] != NULL) {
+            bitmap_destroy(dominators[i]);
+        }
+    }
+    free(dominators);
+}
+
+// sets the dominators of the tasks of `ctx''s dag, which takes time
+// quadratic in its size. Leaves them NULL, so the search runs without
+// the rule, if the search times out first. Returns 0 on success and -1
+// on failure.
+static int create_dominators(bbctx *ctx) {
+    dag *g = ctx->g;
+    size_t size = dag_size(g);
+    bitmap **dominators = calloc(size, sizeof(*dominators));
+    if (dominators == NULL) {
+        return -1;
+    }
+    for (size_t j = 0; j < size; j++) {
+        if (ctx->do_timeout && clock() >= ctx->end_time) {
+            destroy_dominators(dominators, size);
+            return 0;
+        }
+        dominators[j] = bitmap_create(size);
+        if (dominators[j] == NULL) {
+            destroy_dominators(dominators, size);
+            return -1;
+        }
+        int weight = dag_weight(g, j);
+        for (size_t i = 0; i < size; i++) {
+            // comparable tasks are never ready at the same time
+            if (i != j && dag_weight(g, i) == weight &&
+                !dag_reaches(g, i, j) && !dag_reaches(g, j, i) &&
+                dominates(g, i, j)) {
+                bitmap_set(dominators[j], i, 1);
+            }
+        }
+    }
+    ctx->dominators = dominators;
+    return 0;
+}
+
+// writes a checkpoint for the current node. Returns 0 on success and
+// -1 on failure.
+static int write_checkpoint(bbctx *ctx) {
+    bbrun *run = ctx->run;
+    size_t len = schedule_size(ctx->s);
+    unsigned path[len + 1];
+    for (size_t i = 0; i < len; i++) {
+        path[i] = schedule_get(ctx->s, i);
+    }
+    checkpoint cp = {
+        .m = run->m,
+        .block = run->block,
+        .done = run->done,
+        .incumbent = ctx->best_len,
+        .order_len = dag_size(ctx->g),
+        .order = ctx->best_order,
+        .len = len,
+        .path = path,
+        .stats = *ctx->stats,
+    };
+    // a node still on the way to the resumed one: the old path holds
+    // more progress
+    if (ctx->resume_len > len) {
+        cp.len = ctx->resume_len;
+        cp.path = (unsigned *) ctx->resume;
+    }
+    return checkpoint_write(run->opts->checkpoint_path, &cp);
+}
+
+// makes `order', of the `size' tasks of block `block', that block's
+// shared best schedule if its length `len' is shorter than the one
+// there. Keeps the old schedule if there is no memory for the new one.
+static void share_best(shared_best *shared, unsigned block,
+                       const unsigned *order, size_t size, unsigned len) {
+    assert(block < shared->nblocks);
+    pthread_mutex_lock(&shared->lock);
+    if (len < atomic_load(&shared->lens[block])) {
+        if (shared->orders[block] == NULL) {
+            shared->orders[block] = malloc(size * sizeof(*order));
+        }
+        if (shared->orders[block] != NULL) {
+            memcpy(shared->orders[block], order, size * sizeof(*order));
+            atomic_store(&shared->lens[block], len);
+        }
+    }
+    pthread_mutex_unlock(&shared->lock);
+}
+
+// copies the shared best schedule of block `block', of `size' tasks,
+// into `order' if it is shorter than `len'.
+static void take_best(shared_best *shared, unsigned block, unsigned *order,
+                      size_t size, unsigned len) {
+    assert(block < shared->nblocks);
+    pthread_mutex_lock(&shared->lock);
+    if (atomic_load(&shared->lens[block]) < len) {
+        memcpy(order, shared->orders[block], size * sizeof(*order));
+    }
+    pthread_mutex_unlock(&shared->lock);
+}
+
+// stores the current complete schedule as the best one.
+static void record_best(bbctx *ctx) {
+    size_t size = schedule_size(ctx->s);
+    for (size_t i = ctx->best_same; i < size; i++) {
+        ctx->best_order[i] = schedule_get(ctx->s, i);
+    }
+    ctx->best_len = schedule_length(ctx->s);
+    ctx->best_same = size;
+    if (ctx->run != NULL && ctx->run->shared != NULL) {
+        share_best(ctx->run->shared, ctx->run->block, ctx->best_order,
+                   size, ctx->best_len);
+    }
+}
+
+// removes the last task of the schedule.
+static void ctx_pop(bbctx *ctx) {
+    schedule_pop(ctx->s);
+    size_t size = schedule_size(ctx->s);
+    ctx->best_same = (ctx->best_same < size) ? ctx->best_same : size;
+}
+
+// returns the child queue for nodes at `depth', or NULL on failure.
+static bucketq *ctx_sorter(bbctx *ctx, size_t depth) {
+    if (ctx->sorters[depth] == NULL) {
+        ctx->sorters[depth] = bucketq_create(ctx->sorter_max);
+    }
+    return ctx->sorters[depth];
+}
+
+// returns the priority of the ready task `i' as a child of the
+// current node under the branching policy, at most max_prio.
+static unsigned policy_prio(bbctx *ctx, unsigned i) {
+    dag *g = ctx->g;
+    unsigned level = dag_level(g, i);
+    switch (ctx->opts->branch) {
+    case BRANCH_WEIGHT:
+    case BRANCH_SUCCS:
+        return ctx->ranks[i];
+    case BRANCH_SLACK: {
+        unsigned through = schedule_earliest_start(ctx->s, i) + level;
+        return (through < ctx->max_prio) ? through : ctx->max_prio;
+    }
+    case BRANCH_BOUND: {
+        // the node's schedule is already built, so building the child's
+        // cannot fail for lack of memory
+        schedule_add(ctx->s, i);
+        schedule_build(ctx->s, 0);
+        unsigned bound = stage_bound(ctx->s, STAGE_CHEAP);
+        ctx_pop(ctx);
+        return ctx->max_prio - ((bound < ctx->max_prio) ? bound :
+                                ctx->max_prio);
+    }
+    default:
+        return level;
+    }
+}
+
+// splitmix64, as in gen.c.
+static uint64_t next_rand(uint64_t *state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// returns the priority of the ready task `i' as a child of the current
+// node, at most max_prio + noise. Higher priorities are tried first.
+static unsigned child_prio(bbctx *ctx, unsigned i) {
+    unsigned prio = policy_prio(ctx, i);
+    if (ctx->noise > 0) {
+        prio += next_rand(&ctx->rand) % (ctx->noise + 1);
+    }
+    return prio;
+}
+
+static int bb(bbctx *ctx, unsigned best_soln) {
+    assert(ctx != NULL);
+    int checkpoints = ctx->run != NULL &&
+        ctx->run->opts->checkpoint_path != NULL &&
+        ctx->opts->driver == SEARCH_DFS;
+    if ((ctx->do_timeout && clock() >= ctx->end_time) ||
+        (ctx->cancel != NULL &&
+         atomic_load_explicit(ctx->cancel, memory_order_relaxed))) {
+        if (checkpoints) {
+            write_checkpoint(ctx);
+        }
         return -2;
     }
-    dag *g = schedule_dag(s);
+    if (checkpoints && clock() >= ctx->run->next_checkpoint) {
+        if (write_checkpoint(ctx) != 0) {
+            return -1;
+        }
+        ctx->run->next_checkpoint = clock() +
+            ctx->run->opts->checkpoint_interval * CLOCKS_PER_SEC;
+    }
+    if (ctx->nodes_left == 0) {
+        ctx->cut = 1;
+        return best_soln;
+    }
+    ctx->nodes_left--;
+    schedule *s = ctx->s;
+    bitmap *ready_set = ctx->ready_set;
+    dag *g = ctx->g;
+    ctx->stats->nodes++;
+    if (ctx->incumbent_path != NULL &&
+        ctx->stats->nodes % POLL_NODES == 0) {
+        unsigned external;
+        if (incumbent_read(ctx->incumbent_path, &external) == 0 &&
+            external < ctx->external) {
+            ctx->external = external;
+        }
+    }
+    // another process's schedule is as good as any in this subtree, as
+    // is another search's of the same portfolio
+    if (ctx->external < best_soln) {
+        best_soln = ctx->external;
+    }
+    if (ctx->run != NULL && ctx->run->shared != NULL) {
+        unsigned shared = atomic_load_explicit(
+            &ctx->run->shared->lens[ctx->run->block], memory_order_relaxed);
+        best_soln = (shared < best_soln) ? shared : best_soln;
+    }
+    if (best_soln <= ctx->root_bound) {
+        ctx->stop = 1;
+        return best_soln;
+    }
     if (schedule_build(s, 0) != 0) {
         return -1;
     }
     if (schedule_size(s) == dag_size(g)) {
         unsigned sched_len = schedule_length(s);
+        if (sched_len < ctx->best_len) {
+            record_best(ctx);
+            ctx_trace(ctx, TRACE_INCUMBENT, 0, sched_len, best_soln);
+        }
+        ctx_trace(ctx, TRACE_LEAF, 0, sched_len, best_soln);
         return (best_soln < sched_len) ? best_soln : sched_len;
     }
-#ifdef FUJITA
-#ifdef FB
-    unsigned fb = schedule_fernandez_bound(s);
-    if (fb >= best_soln) {
+    if (bound_prunes(ctx, best_soln)) {
         return best_soln;
     }
-#else // no FB
-    unsigned mb = fujita_bound(s);
-    if (mb >= best_soln) {
-        return best_soln;
-    }
-#endif // FB
-#endif // FUJITA
-    binheap *sorter = binheap_create();
+    ctx_trace(ctx, TRACE_EXPAND, 0, 0, best_soln);
+    // children are tried in decreasing order of priority, which is
+    // the level unless another branching policy is chosen; children
+    // with equal priorities are tried in increasing order of vertex id
+    bucketq *sorter = ctx_sorter(ctx, schedule_size(s));
     if (sorter == NULL) {
         return -1;
     }
     for (size_t i = 0; i < dag_size(g); i++) {
-        if (bitmap_get(ready_set, i) == 1) {
-            if (binheap_put(sorter, i, dag_level(g, i)) != 0) {
-                binheap_destroy(sorter);
+        if (bitmap_get(ready_set, i) == 1 &&
+            (ctx->dominators == NULL ||
+             !bitmap_intersects(ctx->dominators[i], ready_set))) {
+            if (bucketq_put(sorter, i, child_prio(ctx, i)) != 0) {
+                bucketq_clear(sorter);
                 return -1;
             }
         }
     }
     idx_vec new_ready;
     idx_vec_init(&new_ready, 0);
-    while (binheap_size(sorter) > 0) {
-        unsigned new_idx = binheap_get(sorter);
+    size_t depth = schedule_size(s);
+    // the number of children tried so far
+    size_t rank = 0;
+    while (bucketq_size(sorter) > 0) {
+        unsigned new_idx = bucketq_get(sorter);
+        // the children before the checkpointed one were searched
+        int resuming = ctx->resume_len > depth;
+        if (resuming && new_idx != ctx->resume[depth]) {
+            continue;
+        }
+        // every child after the first is a discrepancy
+        if (rank > 0 && ctx->discrepancies == 0) {
+            ctx->cut = 1;
+            bucketq_clear(sorter);
+            break;
+        }
+        ctx->discrepancies -= (rank > 0);
         schedule_add(s, new_idx);
 
         size_t nsuccs = dag_nsuccs(g, new_idx);
@@ -112,10 +784,15 @@ int bb(schedule *s, bitmap *ready_set, unsigned best_soln) {
         }
 
         bitmap_set(ready_set, new_idx, 0);
-        int soln = bb(s, ready_set, best_soln);
+        int soln = bb(ctx, best_soln);
         bitmap_set(ready_set, new_idx, 1);
+        ctx->discrepancies += (rank++ > 0);
+        if (resuming) {
+            ctx->resume_len = 0;
+        }
         if (soln < 0) {
-            binheap_destroy(sorter);
+            bucketq_clear(sorter);
+            idx_vec_destroy(&new_ready);
             return soln;
         }
         best_soln = (best_soln < soln) ? best_soln : soln;
@@ -125,42 +802,1799 @@ int bb(schedule *s, bitmap *ready_set, unsigned best_soln) {
             bitmap_set(ready_set, r, 0);
         }
 
-        schedule_pop(s);
+        ctx_pop(ctx);
+        if (best_soln <= ctx->root_bound) {
+            ctx->stop = 1;
+        }
+        // out of nodes, the rest of the pass is cut off
+        if (ctx->nodes_left == 0) {
+            ctx->cut = 1;
+        }
+        if (ctx->stop || ctx->nodes_left == 0) {
+            bucketq_clear(sorter);
+            break;
+        }
     }
     idx_vec_destroy(&new_ready);
-    binheap_destroy(sorter);
     return best_soln;
 }
 
+// returns the i-th term, from 1, of the Luby sequence 1, 1, 2, 1, 1,
+// 2, 4, 1, 1, 2, 1, 1, 2, 4, 8, ...
+static unsigned long luby(unsigned long i) {
+    while (1) {
+        // the sequence up to 2^k - 1 ends with 2^(k - 1), and repeats
+        // the part up to 2^(k - 1) - 1 before that
+        unsigned long k = 1;
+        while ((1ul << k) - 1 < i) {
+            k++;
+        }
+        if ((1ul << k) - 1 == i) {
+            return 1ul << (k - 1);
+        }
+        i -= (1ul << (k - 1)) - 1;
+    }
+}
+
+// searches below the current node with the options' driver, starting
+// with the incumbent `upper'. Returns like bb.
+static int search(bbctx *ctx, unsigned upper) {
+    int result = upper;
+    switch (ctx->opts->driver) {
+    case SEARCH_LDS:
+        for (unsigned k = 0; result >= 0; k++) {
+            ctx->stats->passes++;
+            ctx->discrepancies = k;
+            ctx->cut = 0;
+            result = bb(ctx, result);
+            // a pass that skipped nothing searched the whole tree
+            if (!ctx->cut || ctx->stop) {
+                break;
+            }
+        }
+        ctx->discrepancies = UINT_MAX;
+        return result;
+    case SEARCH_RESTARTS: {
+        unsigned max_noise = ctx->max_prio / RESTART_NOISE + 1;
+        ctx->rand = ctx->opts->seed;
+        for (unsigned long i = 1; result >= 0; i++) {
+            ctx->stats->passes++;
+            // the cutoffs grow without bound, so some pass completes
+            unsigned long cutoff = luby(i);
+            ctx->nodes_left = (cutoff > ULONG_MAX / RESTART_NODES) ?
+                ULONG_MAX : cutoff * RESTART_NODES;
+            ctx->noise = (i > 1) ? max_noise : 0;
+            ctx->cut = 0;
+            result = bb(ctx, result);
+            if (!ctx->cut || ctx->stop) {
+                break;
+            }
+        }
+        ctx->nodes_left = ULONG_MAX;
+        ctx->noise = 0;
+        return result;
+    }
+    default:
+        return bb(ctx, upper);
+    }
+}
+
 int bbsearch(dag *g, unsigned m, int timeout) {
-    assert(g != NULL);
-    schedule *s = schedule_create(g, m);
-    if (s == NULL) {
+    bbopts opts;
+    bbopts_init(&opts);
+    return bbsearch_opts(g, m, timeout, &opts, NULL);
+}
+
+// returns 1 if the nodes of searches with `opts' need the tasks' time
+// windows, which every bound stage reads.
+static int uses_windows(const bbopts *opts) {
+    return opts->bounds != 0 || opts->branch == BRANCH_BOUND;
+}
+
+// a task and its priority key under a policy that orders by two
+// numbers, for sorting by key
+typedef struct keyed_task {
+    uint64_t key;
+    unsigned id;
+} keyed_task;
+
+static int keyed_task_cmp(const void *a, const void *b) {
+    const keyed_task *x = a;
+    const keyed_task *y = b;
+    return (x->key > y->key) - (x->key < y->key);
+}
+
+// sets ctx->ranks for the weight and succs policies, which order by
+// level then weight and by successors then level. Returns the largest
+// rank, or -1 on failure.
+static long rank_tasks(bbctx *ctx) {
+    dag *g = ctx->g;
+    size_t size = dag_size(g);
+    keyed_task *tasks = malloc(size * sizeof(*tasks));
+    ctx->ranks = malloc(size * sizeof(*ctx->ranks));
+    if (tasks == NULL || ctx->ranks == NULL) {
+        free(tasks);
+        free(ctx->ranks);
+        ctx->ranks = NULL;
         return -1;
     }
-    schedule_add(s, dag_source(g));
-    bitmap *ready_set = bitmap_create(0);
-    if (ready_set == NULL) {
-        schedule_destroy(s);
+    for (unsigned i = 0; i < size; i++) {
+        uint64_t high = (ctx->opts->branch == BRANCH_WEIGHT) ?
+            dag_level(g, i) : dag_nsuccs(g, i);
+        uint64_t low = (ctx->opts->branch == BRANCH_WEIGHT) ?
+            (unsigned) dag_weight(g, i) : dag_level(g, i);
+        tasks[i] = (keyed_task) {.key = high << 32 | low, .id = i};
+    }
+    qsort(tasks, size, sizeof(*tasks), keyed_task_cmp);
+    long rank = 0;
+    for (size_t i = 0; i < size; i++) {
+        if (i > 0 && tasks[i].key != tasks[i - 1].key) {
+            rank++;
+        }
+        ctx->ranks[tasks[i].id] = rank;
+    }
+    free(tasks);
+    return rank;
+}
+
+// allocates the search state for `g' on `m' machines, with an empty
+// schedule. Returns 0 on success and -1 on failure.
+static int ctx_create(bbctx *ctx, dag *g, unsigned m) {
+    size_t size = dag_size(g);
+    ctx->g = g;
+    ctx->external = UINT_MAX;
+    ctx->best_len = UINT_MAX;
+    ctx->best_same = 0;
+    ctx->best_order = malloc(size * sizeof(*ctx->best_order));
+    if (ctx->best_order == NULL) {
+        return -1;
+    }
+    if (dag_has_closure(g) && create_dominators(ctx) != 0) {
+        free(ctx->best_order);
         return -1;
     }
+    ctx->s = schedule_create(g, m);
+    if (ctx->s == NULL) {
+        goto err1;
+    }
+    schedule_set_windows(ctx->s, uses_windows(ctx->opts));
+    ctx->ready_set = bitmap_create(0);
+    if (ctx->ready_set == NULL) {
+        goto err2;
+    }
+    ctx->reached = calloc(size * N_STAGES, sizeof(*ctx->reached));
+    ctx->tries = calloc(size * N_STAGES, sizeof(*ctx->tries));
+    ctx->prunes = calloc(size * N_STAGES, sizeof(*ctx->prunes));
+    if (ctx->reached == NULL || ctx->tries == NULL || ctx->prunes == NULL) {
+        goto err3;
+    }
+    ctx->sorters = calloc(size, sizeof(*ctx->sorters));
+    if (ctx->sorters == NULL) {
+        goto err3;
+    }
+    ctx->discrepancies = UINT_MAX;
+    ctx->nodes_left = ULONG_MAX;
+    ctx->noise = 0;
+    // levels never exceed the level of the source, and no lower bound
+    // or list schedule exceeds the total work
+    unsigned crit = dag_level(g, dag_source(g));
+    unsigned work = 0;
+    for (size_t i = 0; i < size; i++) {
+        work += dag_weight(g, i);
+    }
+    ctx->ranks = NULL;
+    switch (ctx->opts->branch) {
+    case BRANCH_WEIGHT:
+    case BRANCH_SUCCS: {
+        long max_rank = rank_tasks(ctx);
+        if (max_rank < 0) {
+            goto err4;
+        }
+        ctx->max_prio = max_rank;
+        break;
+    }
+    case BRANCH_SLACK:
+    case BRANCH_BOUND:
+        ctx->max_prio = work;
+        break;
+    default:
+        ctx->max_prio = crit;
+    }
+    // room for the restarts' noise
+    ctx->sorter_max = ctx->max_prio;
+    if (ctx->opts->driver == SEARCH_RESTARTS) {
+        ctx->sorter_max += ctx->max_prio / RESTART_NOISE + 1;
+    }
+    return 0;
+ err4:
+    free(ctx->sorters);
+ err3:
+    free(ctx->reached);
+    free(ctx->tries);
+    free(ctx->prunes);
+    bitmap_destroy(ctx->ready_set);
+ err2:
+    schedule_destroy(ctx->s);
+ err1:
+    if (ctx->dominators != NULL) {
+        destroy_dominators(ctx->dominators, size);
+    }
+    free(ctx->best_order);
+    return -1;
+}
 
-    if (timeout < 0) {
-        do_timeout = 0;
+static void ctx_destroy(bbctx *ctx) {
+    size_t size = dag_size(ctx->g);
+    for (size_t i = 0; i < size; i++) {
+        if (ctx->sorters[i] != NULL) {
+            bucketq_destroy(ctx->sorters[i]);
+        }
     }
-    else {
-        do_timeout = 1;
-        end_time = clock() + timeout * CLOCKS_PER_SEC;
+    free(ctx->sorters);
+    free(ctx->ranks);
+    free(ctx->reached);
+    free(ctx->tries);
+    free(ctx->prunes);
+    bitmap_destroy(ctx->ready_set);
+    schedule_destroy(ctx->s);
+    if (ctx->dominators != NULL) {
+        destroy_dominators(ctx->dominators, size);
+    }
+    free(ctx->best_order);
+}
+
+// returns 1 if every predecessor of `i' is in the schedule `s'.
+static int preds_scheduled(schedule *s, unsigned i) {
+    dag *g = schedule_dag(s);
+    size_t npreds = dag_npreds(g, i);
+    unsigned preds[npreds + 1];
+    dag_preds(g, i, preds);
+    for (size_t j = 0; j < npreds; j++) {
+        if (!schedule_contains(s, preds[j])) {
+            return 0;
+        }
     }
+    return 1;
+}
 
-    size_t nsuccs = dag_nsuccs(g, dag_source(g));
-    unsigned succs[nsuccs];
-    dag_succs(g, dag_source(g), succs);
-    for (size_t i = 0; i < nsuccs; i++) {
-        bitmap_set(ready_set, succs[i], 1);
+// schedules the `len' tasks of `prefix', which must start with the
+// source, and marks the tasks that become ready. Returns 0 on success
+// and -1 if the prefix is not a valid partial schedule.
+static int ctx_start(bbctx *ctx, const unsigned *prefix, size_t len) {
+    dag *g = ctx->g;
+    size_t size = dag_size(g);
+    if (len == 0 || len > size || prefix[0] != dag_source(g)) {
+        return -1;
     }
-    int result = bb(s, ready_set, UINT_MAX);
-    bitmap_destroy(ready_set);
-    schedule_destroy(s);
+    for (size_t i = 0; i < len; i++) {
+        if (prefix[i] >= size || schedule_contains(ctx->s, prefix[i]) ||
+            schedule_add(ctx->s, prefix[i]) != 0) {
+            return -1;
+        }
+    }
+    if (!schedule_is_valid(ctx->s)) {
+        return -1;
+    }
+    for (unsigned i = 0; i < size; i++) {
+        if (!schedule_contains(ctx->s, i) && preds_scheduled(ctx->s, i) &&
+            bitmap_set(ctx->ready_set, i, 1) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// empties the schedule and the ready set again after ctx_start.
+static void ctx_reset(bbctx *ctx) {
+    while (schedule_size(ctx->s) > 0) {
+        ctx_pop(ctx);
+    }
+    for (unsigned i = 0, size = dag_size(ctx->g); i < size; i++) {
+        bitmap_set(ctx->ready_set, i, 0);
+    }
+}
+
+// builds a greedy schedule, whose length is stored in `upper', and
+// sets the context's root bound to the strongest lower bound of the
+// enabled stages on the whole dag. Leaves the schedule empty. Returns
+// 0 on success and -1 on failure.
+static int presolve(bbctx *ctx, unsigned *upper) {
+    dag *g = ctx->g;
+    schedule_add(ctx->s, dag_source(g));
+    if (schedule_complete_greedy(ctx->s) != 0 ||
+        schedule_build(ctx->s, 0) != 0) {
+        ctx_reset(ctx);
+        return -1;
+    }
+    *upper = schedule_length(ctx->s);
+    record_best(ctx);
+    while (schedule_size(ctx->s) > 1) {
+        ctx_pop(ctx);
+    }
+    // the root bound takes the cheap stage, enabled or not, and the
+    // enabled ones. Fujita's bound alone takes far longer than the
+    // timeout on dags of a few thousand tasks.
+    schedule_set_windows(ctx->s, 1);
+    int err = schedule_build(ctx->s, 0);
+    unsigned crit = dag_level(g, dag_source(g));
+    unsigned stages = BOUND_CHEAP | ctx->opts->bounds;
+    unsigned bound = (err == 0) ? strongest_bound(ctx->s, stages) : 0;
+    schedule_set_windows(ctx->s, uses_windows(ctx->opts));
+    ctx->root_bound = (crit > bound) ? crit : bound;
+    ctx_reset(ctx);
+    return err;
+}
+
+// stores the tasks of `g' in order of their earliest start times,
+// ignoring machines. With at least as many machines as the dag's width
+// this order schedules every task at its earliest start. Returns 0 on
+// success and -1 on failure.
+static int asap_order(dag *g, unsigned *order) {
+    size_t size = dag_size(g);
+    unsigned crit = dag_level(g, dag_source(g));
+    unsigned *starts = calloc(size, sizeof(*starts));
+    bucketq *sorter = bucketq_create(crit);
+    if (starts == NULL || sorter == NULL) {
+        free(starts);
+        if (sorter != NULL) {
+            bucketq_destroy(sorter);
+        }
+        return -1;
+    }
+    int err = 0;
+    // predecessors have smaller ids
+    for (unsigned i = 0; i < size; i++) {
+        size_t npreds = dag_npreds(g, i);
+        unsigned preds[npreds + 1];
+        dag_preds(g, i, preds);
+        for (size_t j = 0; j < npreds; j++) {
+            unsigned end = starts[preds[j]] + dag_weight(g, preds[j]);
+            starts[i] = (end > starts[i]) ? end : starts[i];
+        }
+        err |= bucketq_put(sorter, i, crit - starts[i]);
+    }
+    for (size_t i = 0; i < size; i++) {
+        order[i] = bucketq_get(sorter);
+    }
+    free(starts);
+    bucketq_destroy(sorter);
+    return err;
+}
+
+// evaluates the repaired `order' and makes it the incumbent if it is
+// shorter than `upper'. Leaves the schedule empty. Returns 0 on
+// success and -1 on failure.
+static int try_order(bbctx *ctx, const unsigned *order, unsigned *upper) {
+    schedule_add(ctx->s, dag_source(ctx->g));
+    int err = schedule_complete_ordered(ctx->s, order);
+    if (err == 0) {
+        err = schedule_build(ctx->s, 0);
+    }
+    if (err == 0 && schedule_length(ctx->s) < *upper) {
+        *upper = schedule_length(ctx->s);
+        record_best(ctx);
+    }
+    ctx_reset(ctx);
+    return err;
+}
+
+// solves the context's dag, which has at most DP_MAX_SIZE vertices,
+// with dp_solve, looking for schedules shorter than `upper' or than
+// another side's of a portfolio. Returns what dp_solve does.
+static int solve_dp(bbctx *ctx, unsigned upper) {
+    dag *g = ctx->g;
+    size_t size = dag_size(g);
+    bbrun *run = ctx->run;
+    if (run->shared != NULL) {
+        unsigned shared = atomic_load(&run->shared->lens[run->block]);
+        upper = (shared < upper) ? shared : upper;
+    }
+    dplimits limits = {
+        .do_timeout = ctx->do_timeout,
+        .end_time = ctx->end_time,
+        .cancel = ctx->cancel,
+        .max_labels = DP_MAX_LABELS,
+    };
+    unsigned order[size];
+    int result = dp_solve(g, run->m, upper, &limits,
+                          order, &ctx->stats->nodes);
+    if (result >= 0 && (unsigned) result < upper) {
+        memcpy(ctx->best_order, order, size * sizeof(*order));
+        ctx->best_len = result;
+        ctx->best_same = 0;
+        if (run->shared != NULL) {
+            share_best(run->shared, run->block, order, size, result);
+        }
+    }
+    if (result >= 0) {
+        ctx->stats->dp_closed++;
+    }
+    return result;
+}
+
+// searches a single dag whose closure, if it has one, is already
+// built, adding to the run's counters. Starts from `warm' if it is not
+// NULL, and stores the best order in `order' if it is not NULL.
+static int solve(dag *g, bbrun *run, const bbwarm *warm, unsigned *order) {
+    bbstats *stats = run->stats;
+    unsigned m = run->m;
+    unsigned crit = dag_level(g, dag_source(g));
+    // with a machine for every task of a largest antichain, no task
+    // ever waits for a machine
+    if (dag_has_closure(g) && dag_size(g) <= WIDTH_MAX_SIZE &&
+        m >= dag_width(g)) {
+        stats->width_closed++;
+        if (order != NULL && asap_order(g, order) != 0) {
+            return -1;
+        }
+        return crit;
+    }
+    bbctx ctx = {
+        .opts = run->opts,
+        .stats = stats,
+        .do_timeout = run->do_timeout,
+        .end_time = run->end_time,
+        .cancel = run->cancel,
+        .run = run,
+        .trace = run->trace,
+    };
+    if (ctx_create(&ctx, g, m) != 0) {
+        return -1;
+    }
+    int result = -1;
+    unsigned upper;
+    unsigned source = dag_source(g);
+    if (presolve(&ctx, &upper) != 0) {
+        goto done;
+    }
+    if (warm != NULL && warm->order != NULL &&
+        try_order(&ctx, warm->order, &upper) != 0) {
+        goto done;
+    }
+    // a greedy schedule as long as the critical path, or the
+    // strongest root bound, is optimal. Otherwise it is the first
+    // incumbent.
+    if (upper == crit) {
+        stats->path_closed++;
+        result = upper;
+        goto done;
+    }
+    if (upper <= ctx.root_bound) {
+        stats->root_closed++;
+        result = upper;
+        goto done;
+    }
+    checkpoint *cp = run->resume;
+    if (cp != NULL && cp->block == run->block) {
+        run->resume = NULL;
+        if (cp->order_len != dag_size(g) ||
+            ctx_start(&ctx, cp->path, cp->len) != 0) {
+            goto done;
+        }
+        ctx_reset(&ctx);
+        if (cp->incumbent < upper) {
+            upper = cp->incumbent;
+            ctx.best_len = cp->incumbent;
+            ctx.best_same = 0;
+            memcpy(ctx.best_order, cp->order,
+                   cp->order_len * sizeof(*cp->order));
+        }
+        ctx.resume = cp->path;
+        ctx.resume_len = cp->len;
+    }
+    if (ctx_start(&ctx, &source, 1) != 0) {
+        goto done;
+    }
+    // a short depth first search settles most small dags. The dynamic
+    // program takes the rest, unless another driver was asked for or
+    // the search has to write checkpoints or traces, and the search
+    // goes on if the program gives up.
+    if (run->opts->dp && dag_size(g) <= DP_MAX_SIZE &&
+        run->opts->driver == SEARCH_DFS && ctx.resume == NULL &&
+        run->opts->checkpoint_path == NULL && run->trace == NULL) {
+        ctx.nodes_left = DP_PROBE_NODES;
+        ctx.cut = 0;
+        result = bb(&ctx, upper);
+        ctx.nodes_left = ULONG_MAX;
+        if (result < 0 || !ctx.cut || ctx.stop) {
+            goto searched;
+        }
+        upper = result;
+        result = solve_dp(&ctx, upper);
+        if (result != -3) {
+            goto done;
+        }
+    }
+    result = search(&ctx, upper);
+ searched:
+    if (ctx.stop && result >= 0) {
+        stats->gap_closed++;
+    }
+ done:
+    // on time out the incumbent is the best schedule found so far. In a
+    // portfolio, another search's may be better, and the result may be
+    // that one's length.
+    if (order != NULL && (result >= 0 || result == -2)) {
+        memcpy(order, ctx.best_order, dag_size(g) * sizeof(*order));
+        if (run->shared != NULL) {
+            take_best(run->shared, run->block, order, dag_size(g),
+                      ctx.best_len);
+        }
+    }
+    ctx_destroy(&ctx);
+    return result;
+}
+
+// solves each series block of `g' on its own. Blocks never overlap in
+// time, so the makespan is the sum of the blocks' makespans, and a
+// best order runs the blocks' best orders one after another. The warm
+// start's order is split among the blocks.
+static int solve_blocks(dag *g, bbrun *run, const bbwarm *warm,
+                        unsigned *order) {
+    size_t size = dag_size(g);
+    unsigned ends[size];
+    size_t nblocks = dag_series_blocks(g, ends);
+    if (nblocks <= 1) {
+        return solve(g, run, warm, order);
+    }
+    run->stats->blocks = nblocks;
+    // blocks before the checkpointed one are already solved
+    size_t skip = (run->resume != NULL) ? run->resume->block : 0;
+    int total = (run->resume != NULL) ? run->resume->done : 0;
+    unsigned first = dag_source(g) + 1;
+    // block orders, with their source and sink
+    unsigned local[size];
+    unsigned local_warm[size];
+    size_t len = 0;
+    if (order != NULL) {
+        order[len++] = dag_source(g);
+    }
+    for (size_t i = 0; i < nblocks; first = ends[i++] + 1) {
+        if (i < skip) {
+            continue;
+        }
+        if (first == ends[i]) {
+            total += dag_weight(g, first);
+            if (order != NULL) {
+                order[len++] = first;
+            }
+            continue;
+        }
+        dag *block = dag_subgraph(g, first, ends[i]);
+        if (block == NULL) {
+            return -1;
+        }
+        // vertex `id' of the block is vertex `id + first - 1' of `g'
+        bbwarm block_warm = {.order = NULL};
+        if (warm != NULL && warm->order != NULL) {
+            size_t n = 0;
+            local_warm[n++] = dag_source(block);
+            for (size_t j = 0; j < size; j++) {
+                if (warm->order[j] >= first && warm->order[j] <= ends[i]) {
+                    local_warm[n++] = warm->order[j] - first + 1;
+                }
+            }
+            local_warm[n++] = dag_sink(block);
+            block_warm.order = (n == dag_size(block)) ? local_warm : NULL;
+        }
+        run->block = i;
+        run->done = total;
+        int result = -1;
+        if (dag_closure(block) == 0) {
+            result = solve(block, run, &block_warm,
+                           (order != NULL) ? local : NULL);
+        }
+        size_t block_size = dag_size(block);
+        dag_destroy(block);
+        if (result == -2 && order != NULL) {
+            // the block's best schedule so far, then the blocks not
+            // reached in id order
+            for (size_t j = 1; j + 1 < block_size; j++) {
+                order[len++] = local[j] + first - 1;
+            }
+            for (unsigned id = ends[i] + 1; id < dag_sink(g); id++) {
+                order[len++] = id;
+            }
+            order[len++] = dag_sink(g);
+        }
+        if (result < 0) {
+            return result;
+        }
+        total += result;
+        if (order != NULL) {
+            for (size_t j = 1; j + 1 < block_size; j++) {
+                order[len++] = local[j] + first - 1;
+            }
+        }
+    }
+    if (order != NULL) {
+        order[len++] = dag_sink(g);
+    }
+    return total;
+}
+
+int bbsearch_opts(dag *g, unsigned m, int timeout, const bbopts *opts,
+                  bbstats *stats) {
+    return bbsearch_warm(g, m, timeout, opts, NULL, NULL, stats);
+}
+
+// bbsearch_warm in the forward direction, stopping early once `cancel'
+// is set and bounded by the schedules in `shared', each if it is not
+// NULL.
+static int search_dag(dag *g, unsigned m, int timeout, const bbopts *opts,
+                      const bbwarm *warm, unsigned *order, bbstats *stats,
+                      atomic_int *cancel, shared_best *shared) {
+    bbstats local_stats;
+    if (stats == NULL) {
+        stats = &local_stats;
+    }
+    memset(stats, 0, sizeof(*stats));
+    stats->blocks = 1;
+    clock_t now = clock();
+    bbrun run = {
+        .m = m,
+        .do_timeout = timeout >= 0,
+        .end_time = now + timeout * CLOCKS_PER_SEC,
+        .cancel = cancel,
+        .shared = shared,
+        .opts = opts,
+        .stats = stats,
+        .next_checkpoint = now + opts->checkpoint_interval * CLOCKS_PER_SEC,
+    };
+    checkpoint cp;
+    if (opts->resume_path != NULL) {
+        if (opts->driver != SEARCH_DFS) {
+            return -1;
+        }
+        if (checkpoint_read(opts->resume_path, &cp) != 0) {
+            return -1;
+        }
+        if (cp.m != m) {
+            checkpoint_destroy(&cp);
+            return -1;
+        }
+        *stats = cp.stats;
+        run.resume = &cp;
+    }
+    if (opts->trace_path != NULL &&
+        (run.trace = tracer_create(opts->trace_path, TRACE_EVENTS)) == NULL) {
+        if (opts->resume_path != NULL) {
+            checkpoint_destroy(&cp);
+        }
+        return -1;
+    }
+    int result;
+    if (dag_size(g) <= CLOSURE_MAX_SIZE && dag_closure(g) == 0 &&
+        opts->decompose) {
+        result = solve_blocks(g, &run, warm, order);
+    }
+    else {
+        result = solve(g, &run, warm, order);
+    }
+    if (opts->resume_path != NULL) {
+        checkpoint_destroy(&cp);
+    }
+    if (run.trace != NULL && tracer_close(run.trace) != 0 && result >= 0) {
+        result = -1;
+    }
+    return result;
+}
+
+// a task and its start time, for sorting by start time
+typedef struct timed_task {
+    unsigned start;
+    unsigned id;
+} timed_task;
+
+static int timed_task_cmp(const void *a, const void *b) {
+    const timed_task *x = a;
+    const timed_task *y = b;
+    if (x->start != y->start) {
+        return (x->start < y->start) ? -1 : 1;
+    }
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+// stores in `mirrored' an order of dag_reverse(g) whose list schedule
+// is no longer than that of the valid order `order' of `g'. The
+// schedule of `order', run backwards, starts every task at the
+// makespan minus its end time. Taken in order of those starts, list
+// scheduling starts no task later. Returns 0 on success and -1 on
+// failure.
+static int mirror_order(dag *g, unsigned m, const unsigned *order,
+                        unsigned *mirrored) {
+    size_t size = dag_size(g);
+    schedule *s = schedule_create(g, m);
+    unsigned *all = malloc(2 * size * sizeof(*all));
+    timed_task *tasks = malloc(size * sizeof(*tasks));
+    int err = -1;
+    if (s == NULL || all == NULL || tasks == NULL) {
+        goto out;
+    }
+    for (size_t i = 0; i < size; i++) {
+        if (schedule_add(s, order[i]) != 0) {
+            goto out;
+        }
+    }
+    if (schedule_build(s, 0) != 0 ||
+        schedule_assign(s, all, all + size) != 0) {
+        goto out;
+    }
+    unsigned length = schedule_length(s);
+    for (unsigned id = 0; id < size; id++) {
+        // a task can only start with a predecessor of zero weight,
+        // which has the smaller id, so ties go by id
+        tasks[id].start = length - all[id] - dag_weight(g, id);
+        tasks[id].id = size - 1 - id;
+    }
+    qsort(tasks, size, sizeof(*tasks), timed_task_cmp);
+    for (size_t i = 0; i < size; i++) {
+        mirrored[i] = tasks[i].id;
+    }
+    err = 0;
+ out:
+    if (s != NULL) {
+        schedule_destroy(s);
+    }
+    free(all);
+    free(tasks);
+    return err;
+}
+
+// searches the dag whose reverse is `r', by searching `r', for
+// bbsearch_warm. The warm start's order is turned around, and the
+// best order of `r' is mirrored into `order'.
+static int search_reversed(dag *r, unsigned m, int timeout,
+                           const bbopts *opts, const bbwarm *warm,
+                           unsigned *order, bbstats *stats,
+                           atomic_int *cancel, shared_best *shared) {
+    size_t size = dag_size(r);
+    unsigned *reversed = malloc(2 * size * sizeof(*reversed));
+    if (reversed == NULL) {
+        return -1;
+    }
+    bbwarm reversed_warm;
+    if (warm != NULL) {
+        reversed_warm = *warm;
+        if (warm->order != NULL) {
+            // the warm order may not be valid, so it cannot be mirrored;
+            // its repair keeps tasks in the turned around order instead
+            unsigned *turned = reversed + size;
+            for (size_t i = 0; i < size; i++) {
+                turned[i] = size - 1 - warm->order[size - 1 - i];
+            }
+            reversed_warm.order = turned;
+        }
+    }
+    int result = search_dag(r, m, timeout, opts,
+                            (warm != NULL) ? &reversed_warm : NULL,
+                            (order != NULL) ? reversed : NULL, stats, cancel,
+                            shared);
+    if (order != NULL && (result >= 0 || result == -2) &&
+        mirror_order(r, m, reversed, order) != 0) {
+        result = -1;
+    }
+    free(reversed);
+    return result;
+}
+
+// returns the length of the greedy schedule of `g' on `m' machines,
+// or -1 on failure.
+static int greedy_length(dag *g, unsigned m) {
+    schedule *s = schedule_create(g, m);
+    if (s == NULL) {
+        return -1;
+    }
+    int length = -1;
+    if (schedule_add(s, dag_source(g)) == 0 &&
+        schedule_complete_greedy(s) == 0 && schedule_build(s, 0) == 0) {
+        length = schedule_length(s);
+    }
+    schedule_destroy(s);
+    return length;
+}
+
+// returns 1 if `g', whose reverse is `r', looks easier to search
+// reversed on `m' machines, as for DIRECTION_AUTO.
+static int prefer_reverse(dag *g, dag *r, unsigned m) {
+    int forward = greedy_length(g, m);
+    int reverse = greedy_length(r, m);
+    if (forward < 0 || reverse < 0 || forward != reverse) {
+        return reverse >= 0 && reverse < forward;
+    }
+    return dag_npreds(g, dag_sink(g)) < dag_nsuccs(g, dag_source(g));
+}
+
+// one search of a race or a portfolio: the dag, or for the reverse
+// direction the reversed dag, the search's options and its results
+typedef struct race_side {
+    dag *g;
+    int reverse;
+    unsigned m;
+    int timeout;
+    bbopts opts;
+    const bbwarm *warm;
+    // set by the first side to prove its schedule optimal, and the best
+    // schedules of all sides or NULL
+    atomic_int *cancel;
+    shared_best *shared;
+    unsigned *order;
+    bbstats stats;
+    int result;
+} race_side;
+
+// searches one side of a race or a portfolio, and stops the others
+// once it has an optimal schedule.
+static void *race_thread(void *arg) {
+    race_side *side = arg;
+    if (side->reverse) {
+        side->result = search_reversed(side->g, side->m, side->timeout,
+                                       &side->opts, side->warm, side->order,
+                                       &side->stats, side->cancel,
+                                       side->shared);
+    }
+    else {
+        side->result = search_dag(side->g, side->m, side->timeout,
+                                  &side->opts, side->warm, side->order,
+                                  &side->stats, side->cancel, side->shared);
+    }
+    if (side->result >= 0) {
+        atomic_store(side->cancel, 1);
+    }
+    return NULL;
+}
+
+// searches the `n' sides, the first on this thread and each other one
+// on a thread of its own. Returns 0 on success and -1 if a thread
+// could not be started, after stopping and joining those that were.
+static int run_sides(race_side *sides, size_t n) {
+    pthread_t threads[n];
+    size_t started = 1;
+    for (; started < n; started++) {
+        if (pthread_create(&threads[started], NULL, race_thread,
+                           &sides[started]) != 0) {
+            atomic_store(sides[0].cancel, 1);
+            break;
+        }
+    }
+    if (started == n) {
+        race_thread(&sides[0]);
+    }
+    for (size_t i = 1; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    return (started == n) ? 0 : -1;
+}
+
+// races the two directions of `g' for bbsearch_warm, searching the
+// reverse on a second thread. Returns the result, order and counters
+// of the first side to prove its schedule optimal, or of the forward
+// side if neither did.
+static int race(dag *g, unsigned m, int timeout, const bbopts *opts,
+                const bbwarm *warm, unsigned *order, bbstats *stats) {
+    // both sides would write the same files
+    if (opts->checkpoint_path != NULL || opts->resume_path != NULL ||
+        opts->trace_path != NULL) {
+        return -1;
+    }
+    size_t size = dag_size(g);
+    atomic_int cancel = 0;
+    race_side sides[2];
+    for (int i = 0; i < 2; i++) {
+        sides[i] = (race_side) {
+            .g = g,
+            .reverse = i,
+            .m = m,
+            .timeout = timeout,
+            .opts = *opts,
+            .warm = warm,
+            .cancel = &cancel,
+            .shared = NULL,
+            .order = NULL,
+        };
+    }
+    int result = -1;
+    sides[1].g = dag_reverse(g);
+    if (sides[1].g == NULL) {
+        return -1;
+    }
+    if (order != NULL) {
+        sides[0].order = order;
+        sides[1].order = malloc(size * sizeof(*order));
+        if (sides[1].order == NULL) {
+            goto out;
+        }
+    }
+    if (run_sides(sides, 2) != 0) {
+        goto out;
+    }
+    race_side *winner = &sides[0];
+    if (sides[0].result < 0 && sides[1].result >= 0) {
+        winner = &sides[1];
+        if (order != NULL) {
+            memcpy(order, sides[1].order, size * sizeof(*order));
+        }
+    }
+    result = winner->result;
+    if (stats != NULL) {
+        *stats = winner->stats;
+    }
+ out:
+    free(sides[1].order);
+    dag_destroy(sides[1].g);
+    return result;
+}
+
+// the bound pipelines a portfolio races, one per thread
+static const unsigned portfolio_bounds[] = {
+    BOUND_CHEAP | BOUND_FUJITA,
+    BOUND_CHEAP | BOUND_FERNANDEZ,
+    0,
+};
+#define N_PORTFOLIO (sizeof(portfolio_bounds) / sizeof(*portfolio_bounds))
+
+// races the pipelines of portfolio_bounds on `g' for bbsearch_warm, or
+// on its reverse `r' instead if that is not NULL. The sides share
+// their best schedules per series block, so each one prunes against
+// the best any has found, and all stop once one has proved its
+// schedule optimal. Returns the result, order and counters of the
+// first side to do so, or if none did, of the side with the shortest
+// order among those that timed out.
+static int portfolio(dag *g, dag *r, unsigned m, int timeout,
+                     const bbopts *opts, const bbwarm *warm,
+                     unsigned *order, bbstats *stats) {
+    // the sides would write the same files
+    if (opts->checkpoint_path != NULL || opts->resume_path != NULL ||
+        opts->trace_path != NULL) {
+        return -1;
+    }
+    dag *searched = (r != NULL) ? r : g;
+    size_t size = dag_size(g);
+    // the sides share the searched dag, so its closure and width, which
+    // are computed when first needed, must exist before they start
+    if (size <= CLOSURE_MAX_SIZE) {
+        if (dag_closure(searched) != 0) {
+            return -1;
+        }
+        if (size <= WIDTH_MAX_SIZE) {
+            dag_width(searched);
+        }
+    }
+    atomic_int cancel = 0;
+    shared_best shared = {
+        .nblocks = size,
+        .lens = malloc(size * sizeof(*shared.lens)),
+        .orders = calloc(size, sizeof(*shared.orders)),
+    };
+    unsigned *orders = NULL;
+    if (order != NULL) {
+        orders = malloc(N_PORTFOLIO * size * sizeof(*orders));
+    }
+    int result = -1;
+    if (shared.lens == NULL || shared.orders == NULL ||
+        (order != NULL && orders == NULL) ||
+        pthread_mutex_init(&shared.lock, NULL) != 0) {
+        goto out;
+    }
+    for (size_t i = 0; i < size; i++) {
+        atomic_init(&shared.lens[i], UINT_MAX);
+    }
+    race_side sides[N_PORTFOLIO];
+    for (size_t i = 0; i < N_PORTFOLIO; i++) {
+        sides[i] = (race_side) {
+            .g = searched,
+            .reverse = r != NULL,
+            .m = m,
+            .timeout = timeout,
+            .opts = *opts,
+            .warm = warm,
+            .cancel = &cancel,
+            .shared = &shared,
+            .order = (orders != NULL) ? orders + i * size : NULL,
+        };
+        sides[i].opts.bounds = portfolio_bounds[i];
+        // the dynamic program would do the same work on every side
+        sides[i].opts.dp = opts->dp && i == 0;
+    }
+    int err = run_sides(sides, N_PORTFOLIO);
+    pthread_mutex_destroy(&shared.lock);
+    if (err != 0) {
+        goto out;
+    }
+    // the first proof, or else the shortest order of a time out
+    race_side *winner = NULL;
+    int winner_len = INT_MAX;
+    for (size_t i = 0; i < N_PORTFOLIO &&
+             (winner == NULL || winner->result < 0); i++) {
+        if (sides[i].result >= 0) {
+            winner = &sides[i];
+        }
+        else if (sides[i].result == -2) {
+            int len = (order != NULL) ?
+                bbsearch_order_length(g, m, sides[i].order) : 0;
+            if (len >= 0 && len < winner_len) {
+                winner = &sides[i];
+                winner_len = len;
+            }
+        }
+    }
+    if (winner == NULL) {
+        winner = &sides[0];
+    }
+    if (order != NULL && winner->result != -1) {
+        memcpy(order, winner->order, size * sizeof(*order));
+    }
+    result = winner->result;
+    if (stats != NULL) {
+        *stats = winner->stats;
+    }
+ out:
+    for (size_t i = 0; i < size && shared.orders != NULL; i++) {
+        free(shared.orders[i]);
+    }
+    free(shared.orders);
+    free(shared.lens);
+    free(orders);
+    return result;
+}
+// searches `g' for bbsearch_warm, or its reverse `r' instead if that
+// is not NULL, on its own or as a portfolio as the options ask.
+static int search_side(dag *g, dag *r, unsigned m, int timeout,
+                       const bbopts *opts, const bbwarm *warm,
+                       unsigned *order, bbstats *stats) {
+    if (opts->portfolio) {
+        return portfolio(g, r, m, timeout, opts, warm, order, stats);
+    }
+    if (r != NULL) {
+        return search_reversed(r, m, timeout, opts, warm, order, stats,
+                               NULL, NULL);
+    }
+    return search_dag(g, m, timeout, opts, warm, order, stats, NULL, NULL);
+}
+
+// searches `g' in the direction the options ask for bbsearch_warm.
+static int search_directions(dag *g, unsigned m, int timeout,
+                             const bbopts *opts, const bbwarm *warm,
+                             unsigned *order, bbstats *stats) {
+    if (opts->direction == DIRECTION_RACE) {
+        // a race of portfolios would run six searches
+        return opts->portfolio ? -1 :
+            race(g, m, timeout, opts, warm, order, stats);
+    }
+    if (opts->direction == DIRECTION_FORWARD) {
+        return search_side(g, NULL, m, timeout, opts, warm, order, stats);
+    }
+    dag *r = dag_reverse(g);
+    if (r == NULL) {
+        return -1;
+    }
+    int result;
+    if (opts->direction == DIRECTION_AUTO && !prefer_reverse(g, r, m)) {
+        result = search_side(g, NULL, m, timeout, opts, warm, order, stats);
+    }
+    else {
+        result = search_side(g, r, m, timeout, opts, warm, order, stats);
+    }
+    dag_destroy(r);
+    return result;
+}
+
+int bbsearch_warm(dag *g, unsigned m, int timeout, const bbopts *opts,
+                  const bbwarm *warm, unsigned *order, bbstats *stats) {
+    assert(g != NULL);
+    assert(opts != NULL);
+    dag *reduced = bbsearch_reduce(g);
+    if (reduced == NULL) {
+        return -1;
+    }
+    int result = search_directions(reduced, m, timeout, opts, warm, order,
+                                   stats);
+    if (reduced != g) {
+        dag_destroy(reduced);
+    }
+    return result;
+}
+
+int bbsearch_best(dag *g, unsigned m, int timeout, const bbopts *opts,
+                  schedule **best, bbstats *stats) {
+    assert(best != NULL);
+    unsigned *order = malloc(dag_size(g) * sizeof(*order));
+    if (order == NULL) {
+        return -1;
+    }
+    int result = bbsearch_warm(g, m, timeout, opts, NULL, order, stats);
+    if (result >= 0) {
+        *best = schedule_create(g, m);
+        if (*best == NULL) {
+            free(order);
+            return -1;
+        }
+        for (size_t i = 0, size = dag_size(g); i < size; i++) {
+            schedule_add(*best, order[i]);
+        }
+        // the order must evaluate to the makespan the search reports
+        if (schedule_build(*best, 0) != 0 ||
+            schedule_length(*best) != (unsigned) result) {
+            schedule_destroy(*best);
+            *best = NULL;
+            result = -1;
+        }
+    }
+    free(order);
+    return result;
+}
+
+int bbsearch_order_length(dag *g, unsigned m, const unsigned *order) {
+    assert(g != NULL);
+    assert(order != NULL);
+    schedule *s = schedule_create(g, m);
+    if (s == NULL) {
+        return -1;
+    }
+    for (size_t i = 0, size = dag_size(g); i < size; i++) {
+        if (order[i] >= size || schedule_contains(s, order[i]) ||
+            schedule_add(s, order[i]) != 0) {
+            schedule_destroy(s);
+            return -1;
+        }
+    }
+    int length = -1;
+    if (schedule_is_valid(s) && schedule_build(s, 0) == 0) {
+        length = schedule_length(s);
+    }
+    schedule_destroy(s);
+    return length;
+}
+
+dag *bbsearch_reduce(dag *g) {
+    assert(g != NULL);
+    size_t size = dag_size(g);
+    if (dag_has_closure(g) || size <= 2 || size > CLOSURE_MAX_SIZE) {
+        return g;
+    }
+    dag *copy = dag_subgraph(g, dag_source(g) + 1, dag_sink(g) - 1);
+    if (copy == NULL) {
+        return NULL;
+    }
+    if (dag_closure(copy) != 0) {
+        dag_destroy(copy);
+        return NULL;
+    }
+    return copy;
+}
+
+unsigned bbsearch_root_bound(dag *g, unsigned m) {
+    assert(g != NULL);
+    unsigned crit = dag_level(g, dag_source(g));
+    schedule *s = schedule_create(g, m);
+    if (s == NULL) {
+        return crit;
+    }
+    schedule_add(s, dag_source(g));
+    unsigned all = (1u << N_STAGES) - 1;
+    unsigned bound = (schedule_build(s, 0) == 0) ? strongest_bound(s, all) : 0;
+    schedule_destroy(s);
+    return (crit > bound) ? crit : bound;
+}
+
+DECLARE_VECTOR(shard_vec, shard);
+DEFINE_VECTOR(shard_vec, shard);
+
+static void destroy_shard_vec(shard_vec *shards, size_t first) {
+    for (size_t i = first; i < shards->size; i++) {
+        shard_destroy(&shards->data[i]);
+    }
+    shard_vec_destroy(shards);
+}
+
+// appends a shard for each child of `parent' that the search would
+// try, in order of decreasing level. Returns the number of children
+// added, or -1 on failure.
+static int expand_shard(bbctx *ctx, const shard *parent, shard_vec *out) {
+    dag *g = ctx->g;
+    bucketq *sorter = ctx_sorter(ctx, 0);
+    if (sorter == NULL || ctx_start(ctx, parent->prefix, parent->len) != 0) {
+        ctx_reset(ctx);
+        return -1;
+    }
+    for (unsigned i = 0, size = dag_size(g); i < size; i++) {
+        if (bitmap_get(ctx->ready_set, i) == 1 &&
+            (ctx->dominators == NULL ||
+             !bitmap_intersects(ctx->dominators[i], ctx->ready_set)) &&
+            bucketq_put(sorter, i, dag_level(g, i)) != 0) {
+            goto err;
+        }
+    }
+    int count = 0;
+    while (bucketq_size(sorter) > 0) {
+        shard child = *parent;
+        child.len = parent->len + 1;
+        child.prefix = malloc(child.len * sizeof(*child.prefix));
+        if (child.prefix == NULL) {
+            goto err;
+        }
+        memcpy(child.prefix, parent->prefix,
+               parent->len * sizeof(*child.prefix));
+        child.prefix[parent->len] = bucketq_get(sorter);
+        if (shard_vec_push(out, child) != 0) {
+            free(child.prefix);
+            goto err;
+        }
+        count++;
+    }
+    ctx_reset(ctx);
+    return count;
+ err:
+    bucketq_clear(sorter);
+    ctx_reset(ctx);
+    return -1;
+}
+
+int bbsearch_split(dag *g, unsigned m, size_t k, shard **shards,
+                   size_t *nshards) {
+    assert(g != NULL);
+    assert(shards != NULL);
+    assert(nshards != NULL);
+    dag *reduced = bbsearch_reduce(g);
+    if (reduced == NULL) {
+        return -1;
+    }
+    bbopts opts;
+    bbopts_init(&opts);
+    bbstats stats;
+    bbctx ctx = {.opts = &opts, .stats = &stats};
+    int result = -1;
+    if (ctx_create(&ctx, reduced, m) != 0) {
+        goto err0;
+    }
+    unsigned upper;
+    shard_vec queue;
+    if (presolve(&ctx, &upper) != 0 || shard_vec_init(&queue, 0) != 0) {
+        goto err1;
+    }
+    shard root = {
+        .m = m,
+        .incumbent = upper,
+        .bound = ctx.root_bound,
+        .len = 1,
+        .prefix = malloc(sizeof(*root.prefix)),
+    };
+    if (root.prefix == NULL) {
+        goto err2;
+    }
+    root.prefix[0] = dag_source(g);
+    if (shard_vec_push(&queue, root) != 0) {
+        free(root.prefix);
+        goto err2;
+    }
+    // expand the oldest shard until there are enough. The queue's
+    // live shards are data[head..size); complete schedules cannot be
+    // expanded and go to the back.
+    size_t head = 0;
+    size_t stuck = 0;
+    size_t size = dag_size(g);
+    while (queue.size - head < k && stuck < queue.size - head &&
+           upper > ctx.root_bound) {
+        shard next = queue.data[head++];
+        if (next.len == size) {
+            stuck++;
+            if (shard_vec_push(&queue, next) != 0) {
+                shard_destroy(&next);
+                goto err2;
+            }
+            continue;
+        }
+        stuck = 0;
+        int count = expand_shard(&ctx, &next, &queue);
+        shard_destroy(&next);
+        if (count < 0) {
+            goto err2;
+        }
+    }
+    *nshards = queue.size - head;
+    *shards = malloc((*nshards + 1) * sizeof(**shards));
+    if (*shards == NULL) {
+        goto err2;
+    }
+    memcpy(*shards, &queue.data[head], *nshards * sizeof(**shards));
+    shard_vec_destroy(&queue);
+    result = 0;
+    goto err1;
+ err2:
+    destroy_shard_vec(&queue, head);
+ err1:
+    ctx_destroy(&ctx);
+ err0:
+    if (reduced != g) {
+        dag_destroy(reduced);
+    }
+    return result;
+}
+
+int bbsearch_shard(dag *g, const shard *sh, int timeout,
+                   const char *incumbent_path, const bbopts *opts,
+                   bbstats *stats) {
+    assert(g != NULL);
+    assert(sh != NULL);
+    assert(opts != NULL);
+    bbstats local_stats;
+    if (stats == NULL) {
+        stats = &local_stats;
+    }
+    memset(stats, 0, sizeof(*stats));
+    stats->blocks = 1;
+    dag *reduced = bbsearch_reduce(g);
+    if (reduced == NULL) {
+        return -1;
+    }
+    bbctx ctx = {
+        .opts = opts,
+        .stats = stats,
+        .do_timeout = timeout >= 0,
+        .end_time = clock() + timeout * CLOCKS_PER_SEC,
+        .root_bound = sh->bound,
+        .incumbent_path = incumbent_path,
+    };
+    int result = -1;
+    if (ctx_create(&ctx, reduced, sh->m) != 0) {
+        goto out;
+    }
+    if (opts->trace_path != NULL &&
+        (ctx.trace = tracer_create(opts->trace_path, TRACE_EVENTS)) == NULL) {
+        ctx_destroy(&ctx);
+        goto out;
+    }
+    if (incumbent_path != NULL) {
+        incumbent_read(incumbent_path, &ctx.external);
+    }
+    if (ctx_start(&ctx, sh->prefix, sh->len) == 0) {
+        result = search(&ctx, sh->incumbent);
+        if (ctx.stop && result >= 0) {
+            stats->gap_closed++;
+        }
+    }
+    if (ctx.trace != NULL && tracer_close(ctx.trace) != 0 && result >= 0) {
+        result = -1;
+    }
+    ctx_destroy(&ctx);
+ out:
+    if (reduced != g) {
+        dag_destroy(reduced);
+    }
+    return result;
+}
+
+// what a beam search keeps of a partial schedule besides its tasks
+typedef struct beam_state {
+    // the sum of the levels of its tasks
+    unsigned long levels;
+    // identifies its set of tasks
+    uint64_t key;
+} beam_state;
+
+// a child of a partial schedule in a beam search
+typedef struct beam_child {
+    // the parent's index in the beam, and the task added to it
+    unsigned parent;
+    unsigned task;
+    unsigned bound;
+    unsigned length;
+    beam_state state;
+} beam_child;
+
+DECLARE_VECTOR(child_vec, beam_child);
+DEFINE_VECTOR(child_vec, beam_child);
+
+// state shared by the threads of a beam search
+typedef struct beam {
+    dag *g;
+    const bbopts *opts;
+    // the partial schedules of the current depth, `nstates' prefixes of
+    // `depth' tasks one after another, and their states
+    unsigned *prefixes;
+    beam_state *states;
+    size_t nstates;
+    size_t depth;
+    // a random key per task. The key of a set of tasks is the xor of
+    // its tasks' keys.
+    uint64_t *task_keys;
+    unsigned nthreads;
+    // workers wait on `start' for `step' to change, and the last one to
+    // finish a step signals `done'
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    unsigned long step;
+    unsigned busy;
+    int quit;
+    int err;
+} beam;
+
+// one thread of a beam search, with its own schedule and children
+typedef struct beam_worker {
+    beam *b;
+    unsigned id;
+    schedule *s;
+    child_vec children;
+    unsigned long nodes;
+    unsigned long tries[N_STAGES];
+    pthread_t thread;
+} beam_worker;
+
+// returns the largest lower bound for `s' of the stages in `bounds',
+// and at least its length, counting the stages run in `tries'.
+static unsigned enabled_bound(schedule *s, unsigned bounds,
+                              unsigned long *tries) {
+    unsigned bound = schedule_length(s);
+    for (int stage = 0; stage < N_STAGES; stage++) {
+        if (bounds & (1u << stage)) {
+            tries[stage]++;
+            unsigned b = stage_bound(s, stage);
+            bound = (b > bound) ? b : bound;
+        }
+    }
+    return bound;
+}
+
+// the largest and second largest of some values, and the task with
+// the largest
+typedef struct top2 {
+    unsigned first;
+    unsigned second;
+    unsigned task;
+} top2;
+
+static void top2_add(top2 *top, unsigned value, unsigned task) {
+    if (value > top->first) {
+        top->second = top->first;
+        top->first = value;
+        top->task = task;
+    }
+    else if (value > top->second) {
+        top->second = value;
+    }
+}
+
+// returns the largest value of a task other than `task'.
+static unsigned top2_other(const top2 *top, unsigned task) {
+    return (task == top->task) ? top->second : top->first;
+}
+
+// evaluates every child of the beam's partial schedules number id,
+// id + nthreads, id + 2 nthreads, ... into the worker's children. Each
+// partial schedule is built and bounded once. A child's bound is the
+// largest of its parent's, the earliest time its task can end the
+// schedule, its start plus its level, and the same for each other ready
+// task, which cannot start before the first machine is free again.
+// Returns 0 on success and -1 on failure.
+static int beam_expand(beam_worker *w) {
+    beam *b = w->b;
+    schedule *s = w->s;
+    dag *g = b->g;
+    unsigned size = dag_size(g);
+    w->children.size = 0;
+    for (size_t i = w->id; i < b->nstates; i += b->nthreads) {
+        // keep the part of the schedule the prefix shares with the one
+        // before, which usually has the same ancestors
+        const unsigned *prefix = &b->prefixes[i * b->depth];
+        size_t same = 0;
+        while (same < schedule_size(s) && same < b->depth &&
+               schedule_get(s, same) == prefix[same]) {
+            same++;
+        }
+        while (schedule_size(s) > same) {
+            schedule_pop(s);
+        }
+        for (size_t j = same; j < b->depth; j++) {
+            if (schedule_add(s, prefix[j]) != 0) {
+                return -1;
+            }
+        }
+        if (schedule_build(s, 0) != 0) {
+            return -1;
+        }
+        w->nodes++;
+        unsigned length = schedule_length(s);
+        unsigned bound = enabled_bound(s, b->opts->bounds, w->tries);
+        // the ready tasks' earliest starts plus levels, and levels
+        top2 through = {0, 0, UINT_MAX};
+        top2 levels = {0, 0, UINT_MAX};
+        size_t first = w->children.size;
+        for (unsigned t = 0; t < size; t++) {
+            if (schedule_contains(s, t) || !preds_scheduled(s, t)) {
+                continue;
+            }
+            unsigned start = schedule_earliest_start(s, t);
+            unsigned end = start + dag_weight(g, t);
+            top2_add(&through, start + dag_level(g, t), t);
+            top2_add(&levels, dag_level(g, t), t);
+            beam_child child = {
+                .parent = i,
+                .task = t,
+                .length = (end > length) ? end : length,
+                .state = {
+                    .levels = b->states[i].levels + dag_level(g, t),
+                    .key = b->states[i].key ^ b->task_keys[t],
+                },
+            };
+            if (child_vec_push(&w->children, child) != 0) {
+                return -1;
+            }
+        }
+        for (size_t j = first; j < w->children.size; j++) {
+            beam_child *child = &w->children.data[j];
+            unsigned t = child->task;
+            unsigned own = schedule_earliest_start(s, t) + dag_level(g, t);
+            unsigned others = top2_other(&through, t);
+            unsigned delayed = schedule_next_free(s, t) +
+                top2_other(&levels, t);
+            child->bound = bound;
+            child->bound = (own > child->bound) ? own : child->bound;
+            child->bound = (others > child->bound) ? others : child->bound;
+            child->bound = (delayed > child->bound) ? delayed : child->bound;
+        }
+    }
+    return 0;
+}
+
+static void *beam_thread(void *arg) {
+    beam_worker *w = arg;
+    beam *b = w->b;
+    unsigned long step = 0;
+    pthread_mutex_lock(&b->lock);
+    while (1) {
+        while (b->step == step && !b->quit) {
+            pthread_cond_wait(&b->start, &b->lock);
+        }
+        if (b->quit) {
+            break;
+        }
+        step = b->step;
+        pthread_mutex_unlock(&b->lock);
+        int err = beam_expand(w);
+        pthread_mutex_lock(&b->lock);
+        b->err |= err;
+        if (--b->busy == 0) {
+            pthread_cond_signal(&b->done);
+        }
+    }
+    pthread_mutex_unlock(&b->lock);
+    return NULL;
+}
+
+// expands the beam's partial schedules on all threads, the calling
+// thread being worker 0. Returns 0 on success and -1 on failure.
+static int beam_step(beam *b, beam_worker *workers) {
+    pthread_mutex_lock(&b->lock);
+    b->step++;
+    b->busy = b->nthreads - 1;
+    pthread_cond_broadcast(&b->start);
+    pthread_mutex_unlock(&b->lock);
+    int err = beam_expand(&workers[0]);
+    pthread_mutex_lock(&b->lock);
+    while (b->busy > 0) {
+        pthread_cond_wait(&b->done, &b->lock);
+    }
+    err |= b->err;
+    pthread_mutex_unlock(&b->lock);
+    return err;
+}
+
+// orders children by bound, then length, then key, so that children
+// with the same tasks, bound and length end up next to each other.
+// The parent and task break the remaining ties, which makes the
+// search's result independent of the number of threads.
+static int child_cmp(const void *a, const void *b) {
+    const beam_child *x = a;
+    const beam_child *y = b;
+    if (x->bound != y->bound) {
+        return (x->bound < y->bound) ? -1 : 1;
+    }
+    if (x->state.levels != y->state.levels) {
+        return (x->state.levels > y->state.levels) ? -1 : 1;
+    }
+    if (x->length != y->length) {
+        return (x->length < y->length) ? -1 : 1;
+    }
+    if (x->state.key != y->state.key) {
+        return (x->state.key < y->state.key) ? -1 : 1;
+    }
+    if (x->parent != y->parent) {
+        return (x->parent < y->parent) ? -1 : 1;
+    }
+    return (x->task > y->task) - (x->task < y->task);
+}
+
+// runs the beam search proper from the source. Stores the best
+// complete schedule found in `order' and returns its length, or
+// returns -1 on failure.
+static int beam_run(beam *b, beam_worker *workers, size_t width,
+                    unsigned *order) {
+    dag *g = b->g;
+    size_t size = dag_size(g);
+    unsigned *next = malloc(width * size * sizeof(*next));
+    beam_state *next_states = malloc(width * sizeof(*next_states));
+    child_vec all;
+    int result = -1;
+    if (next == NULL || next_states == NULL ||
+        child_vec_init(&all, 0) != 0) {
+        free(next);
+        free(next_states);
+        return -1;
+    }
+    b->prefixes[0] = dag_source(g);
+    b->states[0].levels = dag_level(g, dag_source(g));
+    b->states[0].key = b->task_keys[dag_source(g)];
+    b->nstates = 1;
+    for (b->depth = 1; b->depth < size; b->depth++) {
+        if (beam_step(b, workers) != 0) {
+            goto out;
+        }
+        all.size = 0;
+        for (unsigned i = 0; i < b->nthreads; i++) {
+            child_vec *children = &workers[i].children;
+            for (size_t j = 0; j < children->size; j++) {
+                if (child_vec_push(&all, children->data[j]) != 0) {
+                    goto out;
+                }
+            }
+        }
+        qsort(all.data, all.size, sizeof(*all.data), child_cmp);
+        // keep the best children, each set of tasks with a given bound
+        // and length once
+        size_t depth = b->depth;
+        size_t n = 0;
+        for (size_t j = 0; j < all.size && n < width; j++) {
+            beam_child *c = &all.data[j];
+            if (j > 0 && c->state.key == c[-1].state.key &&
+                c->bound == c[-1].bound && c->length == c[-1].length) {
+                continue;
+            }
+            memcpy(&next[n * (depth + 1)], &b->prefixes[c->parent * depth],
+                   depth * sizeof(*next));
+            next[n * (depth + 1) + depth] = c->task;
+            next_states[n++] = c->state;
+        }
+        unsigned *prefixes = b->prefixes;
+        b->prefixes = next;
+        next = prefixes;
+        beam_state *states = b->states;
+        b->states = next_states;
+        next_states = states;
+        b->nstates = n;
+    }
+    // the children of the last step are complete schedules, whose bound
+    // is their length, so the first is a shortest one
+    memcpy(order, b->prefixes, size * sizeof(*order));
+    result = all.data[0].length;
+ out:
+    child_vec_destroy(&all);
+    free(next);
+    free(next_states);
+    return result;
+}
+
+int bbsearch_beam(dag *g, unsigned m, size_t width, const bbopts *opts,
+                  unsigned *order, unsigned *bound, bbstats *stats) {
+    assert(g != NULL);
+    assert(width > 0);
+    assert(opts != NULL);
+    bbstats local_stats;
+    if (stats == NULL) {
+        stats = &local_stats;
+    }
+    memset(stats, 0, sizeof(*stats));
+    stats->blocks = 1;
+    size_t size = dag_size(g);
+    unsigned nthreads = (opts->threads > 0) ? opts->threads : 1;
+    beam b = {
+        .g = g,
+        .opts = opts,
+        .prefixes = malloc(width * size * sizeof(*b.prefixes)),
+        .states = malloc(width * sizeof(*b.states)),
+        .task_keys = malloc(size * sizeof(*b.task_keys)),
+        .nthreads = 1,
+    };
+    beam_worker *workers = calloc(nthreads, sizeof(*workers));
+    unsigned *greedy = malloc(size * sizeof(*greedy));
+    int result = -1;
+    if (b.prefixes == NULL || b.states == NULL || b.task_keys == NULL ||
+        workers == NULL || greedy == NULL) {
+        goto out1;
+    }
+    uint64_t state = opts->seed;
+    for (size_t i = 0; i < size; i++) {
+        b.task_keys[i] = next_rand(&state);
+    }
+    for (unsigned i = 0; i < nthreads; i++) {
+        workers[i].b = &b;
+        workers[i].id = i;
+        workers[i].s = schedule_create(g, m);
+        if (workers[i].s == NULL ||
+            child_vec_init(&workers[i].children, 0) != 0) {
+            goto out2;
+        }
+    }
+
+    // the greedy schedule, and the strongest bound at the root
+    schedule *s = workers[0].s;
+    schedule_add(s, dag_source(g));
+    if (schedule_complete_greedy(s) != 0 || schedule_build(s, 0) != 0) {
+        goto out2;
+    }
+    result = schedule_length(s);
+    for (size_t i = 0; i < size; i++) {
+        greedy[i] = schedule_get(s, i);
+    }
+    while (schedule_size(s) > 1) {
+        schedule_pop(s);
+    }
+    if (schedule_build(s, 0) != 0) {
+        result = -1;
+        goto out2;
+    }
+    unsigned crit = dag_level(g, dag_source(g));
+    unsigned root = enabled_bound(s, opts->bounds, stats->tries);
+    root = (crit > root) ? crit : root;
+    if (bound != NULL) {
+        *bound = root;
+    }
+    if ((unsigned) result <= root) {
+        stats->root_closed++;
+        goto out2;
+    }
+
+    pthread_mutex_init(&b.lock, NULL);
+    pthread_cond_init(&b.start, NULL);
+    pthread_cond_init(&b.done, NULL);
+    for (; b.nthreads < nthreads; b.nthreads++) {
+        if (pthread_create(&workers[b.nthreads].thread, NULL, beam_thread,
+                           &workers[b.nthreads]) != 0) {
+            break;
+        }
+    }
+    unsigned *beam_order = malloc(size * sizeof(*beam_order));
+    int beam_len = -1;
+    if (beam_order != NULL) {
+        beam_len = beam_run(&b, workers, width, beam_order);
+    }
+    pthread_mutex_lock(&b.lock);
+    b.quit = 1;
+    pthread_cond_broadcast(&b.start);
+    pthread_mutex_unlock(&b.lock);
+    for (unsigned i = 1; i < b.nthreads; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+    pthread_mutex_destroy(&b.lock);
+    pthread_cond_destroy(&b.start);
+    pthread_cond_destroy(&b.done);
+    if (beam_len < 0) {
+        result = -1;
+    }
+    else if (beam_len < result) {
+        result = beam_len;
+        memcpy(greedy, beam_order, size * sizeof(*greedy));
+    }
+    free(beam_order);
+ out2:
+    for (unsigned i = 0; i < nthreads; i++) {
+        stats->nodes += workers[i].nodes;
+        for (int stage = 0; stage < N_STAGES; stage++) {
+            stats->tries[stage] += workers[i].tries[stage];
+        }
+        if (workers[i].s != NULL) {
+            schedule_destroy(workers[i].s);
+        }
+        child_vec_destroy(&workers[i].children);
+    }
+    if (result >= 0 && order != NULL) {
+        memcpy(order, greedy, size * sizeof(*order));
+    }
+ out1:
+    free(b.prefixes);
+    free(b.states);
+    free(b.task_keys);
+    free(workers);
+    free(greedy);
     return result;
 }
@@ -2,11 +2,285 @@
 #define BBSEARCH_H
 
 #include "dag.h"
+#include "schedule.h"
+#include "shard.h"
+
+// the searches reduce dags up to this size with dag_closure before
+// searching them, copying those without their closure first
+#define CLOSURE_MAX_SIZE (1 << 14)
+
+// lower bounds tried at each search node, cheapest first. A stage only
+// runs if the stages before it failed to prune the node.
+typedef enum bound_stage {
+    // the partial schedule's length, the remaining work spread over
+    // all machines and the longest remaining path
+    STAGE_CHEAP,
+    // the Fernandez bound
+    STAGE_FERNANDEZ,
+    // Fujita's binary search over the machine bound
+    STAGE_FUJITA,
+    N_STAGES
+} bound_stage;
+
+#define BOUND_CHEAP (1u << STAGE_CHEAP)
+#define BOUND_FERNANDEZ (1u << STAGE_FERNANDEZ)
+#define BOUND_FUJITA (1u << STAGE_FUJITA)
+
+// orders in which the children of a search node are tried. Ties go
+// to the child with the smaller id.
+typedef enum branch_policy {
+    // decreasing level, the longest path from the task to the sink
+    BRANCH_LEVEL,
+    // decreasing level, then decreasing weight
+    BRANCH_WEIGHT,
+    // decreasing number of successors, then decreasing level
+    BRANCH_SUCCS,
+    // increasing slack: the child whose earliest start plus level,
+    // the shortest makespan through it, is largest goes first
+    BRANCH_SLACK,
+    // increasing cheap lower bound of the child's node, which costs a
+    // schedule_build per child
+    BRANCH_BOUND,
+    N_BRANCH_POLICIES
+} branch_policy;
+
+// how the search tree is explored. Every driver is complete: given
+// unlimited time it proves its schedule optimal.
+typedef enum search_driver {
+    // depth first, trying children in branching order
+    SEARCH_DFS,
+    // limited discrepancy search: depth first passes that only follow
+    // paths taking a child other than the first at most k times, for
+    // k = 0, 1, 2, ..., until a pass skips nothing
+    SEARCH_LDS,
+    // randomized restarts: depth first passes with the branching order
+    // perturbed at random, each cut off after a number of nodes that
+    // follows the Luby sequence, until a pass runs to completion. The
+    // first pass keeps the branching order.
+    SEARCH_RESTARTS,
+    N_SEARCH_DRIVERS
+} search_driver;
+
+// which way the dag is searched. A dag and its reverse have the same
+// optimal makespan, but one is often much easier to search.
+typedef enum search_direction {
+    // the dag as given
+    DIRECTION_FORWARD,
+    // the reversed dag, from the sink back to the source
+    DIRECTION_REVERSE,
+    // the direction whose greedy schedule is shorter, which starts its
+    // search with the better incumbent. On a tie, the direction with
+    // fewer tasks to choose from first: reversed if the dag has fewer
+    // exit tasks than entry tasks.
+    DIRECTION_AUTO,
+    // both directions at once on two threads, keeping whichever
+    // finishes first. The timeout counts the processor time of both.
+    DIRECTION_RACE,
+    N_SEARCH_DIRECTIONS
+} search_direction;
+
+typedef struct bbopts {
+    // bitwise or of the BOUND_* stages to run
+    unsigned bounds;
+    // if nonzero, skip stages that rarely prune at the current depth
+    int adaptive;
+    // the order children are tried in. It must match when resuming a
+    // checkpoint.
+    branch_policy branch;
+    // the search driver, and the seed of the restarts' random choices.
+    // Checkpoints are only written and resumed by SEARCH_DFS.
+    search_driver driver;
+    unsigned long long seed;
+    // the direction of bbsearch_warm and the searches built on it.
+    // Racing writes no checkpoints or traces.
+    search_direction direction;
+    // if nonzero, bbsearch_warm ignores `bounds' and races a portfolio
+    // of pipelines on three threads instead: cheap and Fujita's bound,
+    // cheap and the Fernandez bound, and no bounds. They prune against
+    // the best schedule any of them has found, and all stop as soon as
+    // one proves its schedule optimal. The timeout counts the processor
+    // time of all three. Cannot be combined with DIRECTION_RACE, and
+    // writes no checkpoints or traces.
+    int portfolio;
+    // the number of threads of bbsearch_beam
+    unsigned threads;
+    // if nonzero, split the dag into series blocks, where every task
+    // of a block precedes every task of the later blocks, and solve
+    // each block on its own
+    int decompose;
+    // if nonzero, a block of at most DP_MAX_SIZE vertices that a short
+    // search leaves open is solved by dynamic programming over the sets
+    // of tasks that can run first, as in dp.h. A block that would take
+    // too many labels is searched after all. Only used by the depth
+    // first driver, without checkpoints or traces.
+    int dp;
+    // if not NULL, write a checkpoint to this file every
+    // `checkpoint_interval' seconds, and when the search times out
+    const char *checkpoint_path;
+    int checkpoint_interval;
+    // if not NULL, continue the search saved in this checkpoint file.
+    // The dag, machines and options must match the interrupted run.
+    const char *resume_path;
+    // if not NULL, write a binary trace of every search node and bound
+    // stage to this file, in the format of trace.h
+    const char *trace_path;
+} bbopts;
+
+// counters collected during a search.
+typedef struct bbstats {
+    // number of series blocks solved separately
+    unsigned long blocks;
+    // blocks closed without a search: there were at least as many
+    // machines as the block's width, or a heuristic schedule was as
+    // long as the critical path. Either way the critical path is
+    // optimal.
+    unsigned long width_closed;
+    unsigned long path_closed;
+    // blocks closed because the heuristic schedule met the strongest
+    // root lower bound, or because the search found a schedule that
+    // did and stopped early
+    unsigned long root_closed;
+    unsigned long gap_closed;
+    // blocks solved by dynamic programming, whose labels count as nodes
+    unsigned long dp_closed;
+    unsigned long nodes;
+    // number of limited discrepancy passes or restarts
+    unsigned long passes;
+    // per stage: how often it ran, pruned the node, or was skipped
+    // by the adaptive pipeline
+    unsigned long tries[N_STAGES];
+    unsigned long prunes[N_STAGES];
+    unsigned long skips[N_STAGES];
+} bbstats;
+
+// fills `opts' with the default options: the cheap bounds followed by
+// Fujita's bound. No checkpoints are written or resumed, nothing is
+// traced, small blocks are solved by dynamic programming, and the
+// search is depth first and forward, trying children in order of
+// level.
+void bbopts_init(bbopts *opts);
+
+// returns the name of the given stage.
+const char *bound_stage_name(bound_stage stage);
+
+// parses a comma separated list of stage names, or "none", into a
+// BOUND_* mask. Returns 0 on success and -1 on an unknown name.
+int bound_parse(const char *list, unsigned *bounds);
+
+// returns the name of the given branching policy.
+const char *branch_policy_name(branch_policy policy);
+
+// parses a branching policy name into `policy'. Returns 0 on success
+// and -1 on an unknown name.
+int branch_parse(const char *name, branch_policy *policy);
+
+// returns the name of the given search driver.
+const char *search_driver_name(search_driver driver);
+
+// parses a search driver name into `driver'. Returns 0 on success and
+// -1 on an unknown name.
+int driver_parse(const char *name, search_driver *driver);
+
+// returns the name of the given search direction.
+const char *search_direction_name(search_direction direction);
+
+// parses a search direction name into `direction'. Returns 0 on success
+// and -1 on an unknown name.
+int direction_parse(const char *name, search_direction *direction);
 
 // returns the makespan of the dag `g' run on `m' machines. Time out
 // after `timeout' seconds, or not at all if `timeout' is
 // negative. Returns the length of the optimal schedule if found, -1
-// on error, and -2 on time out.
+// on error, and -2 on time out. Unless the dag is very large, a copy
+// reduced by bbsearch_reduce is searched, so `g' keeps its edges.
 int bbsearch(dag *g, unsigned m, int timeout);
 
+// like bbsearch, but with the given options. If `stats' is not NULL
+// it is filled with the search's counters.
+int bbsearch_opts(dag *g, unsigned m, int timeout, const bbopts *opts,
+                  bbstats *stats);
+
+// a warm start for a search, typically from a solve of the same dag
+// before a few edits. It holds no lower bound: an edit that removed an
+// edge or lowered a weight may have lowered the optimum, so the search
+// only trusts bounds of its own.
+typedef struct bbwarm {
+    // an order of all of the dag's tasks, such as an earlier optimal
+    // schedule, or NULL. It is repaired into a valid schedule, keeping
+    // tasks in order wherever precedence allows, and becomes the first
+    // incumbent if it beats the greedy schedule.
+    const unsigned *order;
+} bbwarm;
+
+// like bbsearch_opts, but starts from `warm' if it is not NULL. If
+// `order' is not NULL and the search succeeds, it receives the order
+// of the tasks in a best schedule, dag_size(g) entries starting with
+// the source, which evaluates to the returned makespan. On time out it
+// receives the best schedule found so far instead, with the series
+// blocks that were not reached in id order. Blocks skipped by resuming
+// a checkpoint are missing from the order.
+int bbsearch_warm(dag *g, unsigned m, int timeout, const bbopts *opts,
+                  const bbwarm *warm, unsigned *order, bbstats *stats);
+
+// like bbsearch_opts, but on success also stores a new, complete
+// schedule of `g' with the returned makespan in `best', which the
+// caller must destroy. Its tasks' machines and start times come from
+// schedule_assign. Returns -1 if the best order the search found does
+// not evaluate to its makespan.
+int bbsearch_best(dag *g, unsigned m, int timeout, const bbopts *opts,
+                  schedule **best, bbstats *stats);
+
+// returns the makespan of the order of all tasks of `g' on `m'
+// machines, or -1 if it is not a valid order or on failure.
+int bbsearch_order_length(dag *g, unsigned m, const unsigned *order);
+
+// returns `g' if the searches take it as it is: when it already has
+// its closure, has no tasks, or is larger than CLOSURE_MAX_SIZE.
+// Otherwise returns a copy reduced with dag_closure, which the caller
+// must destroy, with the same vertex ids. Returns NULL on failure.
+dag *bbsearch_reduce(dag *g);
+
+// returns the strongest lower bound of all stages, whether enabled or
+// not, on the makespan of `g' on `m' machines, and at least its
+// critical path.
+unsigned bbsearch_root_bound(dag *g, unsigned m);
+
+// builds a schedule of `g' on `m' machines by beam search, without a
+// time limit. Starting from the source, every child of the `width'
+// best partial schedules of each depth is evaluated, and the `width'
+// best children, by the strongest of the options' bound stages and
+// then by length, are kept for the next depth. Children that hold the
+// same tasks and have the same bound and length are kept once. The
+// children are evaluated by opts->threads threads, and the result does
+// not depend on their number. Returns the length of the shorter of the
+// best complete schedule found and the greedy schedule, or -1 on
+// failure. If `order' is not NULL it receives that schedule's order,
+// and if `bound' is not NULL the strongest lower bound at the root, so
+// the result is at most `result - *bound' longer than optimal.
+// Does not compute the dag's closure, so it scales to large dags.
+int bbsearch_beam(dag *g, unsigned m, size_t width, const bbopts *opts,
+                  unsigned *order, unsigned *bound, bbstats *stats);
+
+// splits the search of `g' on `m' machines into at least `k'
+// independent shards, or fewer if the search tree is too small, by
+// expanding the shallowest nodes first. Each shard records the greedy
+// schedule's length as its incumbent and the strongest root bound. If
+// those already match, a single shard is returned. On success, stores
+// a malloc'd array of shards in `shards' and its length in `nshards'
+// and returns 0. Returns -1 on failure. Searches a reduced copy like
+// bbsearch.
+int bbsearch_split(dag *g, unsigned m, size_t k, shard **shards,
+                   size_t *nshards);
+
+// searches the subtree below a shard of `g'. If `incumbent_path' is
+// not NULL, the file there is polled for better makespans found
+// elsewhere, and the search only looks for schedules shorter than
+// those. Returns the shortest makespan known when the shard is done:
+// the best one found in its subtree, its incumbent, or the last
+// makespan read from the file, whichever is smallest. Returns -1 on
+// error and -2 on time out.
+int bbsearch_shard(dag *g, const shard *sh, int timeout,
+                   const char *incumbent_path, const bbopts *opts,
+                   bbstats *stats);
+
 #endif // BBSEARCH_H
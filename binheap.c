@@ -58,6 +58,14 @@ int binheap_put(binheap *heap, unsigned val, int w) {
     return 0;
 }
 
+unsigned binheap_peek(binheap *heap) {
+    assert(heap != NULL);
+    if (binheap_size(heap) == 0) {
+        return (unsigned) -1;
+    }
+    return heap->vec.data[0].v;
+}
+
 unsigned binheap_get(binheap *heap) {
     assert(heap != NULL);
     if (binheap_size(heap) == 0) {
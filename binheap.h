@@ -24,4 +24,7 @@ int binheap_put(binheap *heap, unsigned val, int w);
 // heap is empty.
 unsigned binheap_get(binheap *heap);
 
+// returns the value binheap_get would return, without removing it.
+unsigned binheap_peek(binheap *heap);
+
 #endif // BINHEAP_H
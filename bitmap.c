@@ -58,3 +58,75 @@ int bitmap_set(bitmap *bm, unsigned idx, int val) {
     bm->vec.data[cell_idx] |= (val ? 1 : 0) << bit_idx;
     return old_val;
 }
+
+int bitmap_or(bitmap *dst, bitmap *src) {
+    assert(dst != NULL);
+    assert(src != NULL);
+    while (dst->vec.size < src->vec.size) {
+        if (bvec_push(&dst->vec, 0) != 0) {
+            return -1;
+        }
+    }
+    for (size_t i = 0; i < src->vec.size; i++) {
+        dst->vec.data[i] |= src->vec.data[i];
+    }
+    return 0;
+}
+
+int bitmap_is_subset(bitmap *a, bitmap *b) {
+    assert(a != NULL);
+    assert(b != NULL);
+    for (size_t i = 0; i < a->vec.size; i++) {
+        cell b_cell = (i < b->vec.size) ? b->vec.data[i] : 0;
+        if ((a->vec.data[i] & ~b_cell) != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int bitmap_intersects(bitmap *a, bitmap *b) {
+    assert(a != NULL);
+    assert(b != NULL);
+    size_t size = (a->vec.size < b->vec.size) ? a->vec.size : b->vec.size;
+    for (size_t i = 0; i < size; i++) {
+        if ((a->vec.data[i] & b->vec.data[i]) != 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+size_t bitmap_count(bitmap *bm) {
+    assert(bm != NULL);
+    size_t count = 0;
+    for (size_t i = 0; i < bm->vec.size; i++) {
+        count += __builtin_popcount(bm->vec.data[i]);
+    }
+    return count;
+}
+
+long bitmap_next_diff(bitmap *a, bitmap *b, unsigned idx) {
+    assert(a != NULL);
+    assert(b != NULL);
+    for (size_t i = idx / CELL_WIDTH; i < a->vec.size; i++) {
+        cell c = a->vec.data[i];
+        if (i < b->vec.size) {
+            c &= ~b->vec.data[i];
+        }
+        if (i == idx / CELL_WIDTH) {
+            c &= ~(cell) 0 << (idx % CELL_WIDTH);
+        }
+        if (c != 0) {
+            return (long) (i * CELL_WIDTH + __builtin_ctz(c));
+        }
+    }
+    return -1;
+}
+
+void bitmap_clear(bitmap *bm) {
+    assert(bm != NULL);
+    for (size_t i = 0; i < bm->vec.size; i++) {
+        bm->vec.data[i] = 0;
+    }
+}
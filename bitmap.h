@@ -17,4 +17,25 @@ int bitmap_get(bitmap *bm, unsigned idx);
 // return the old value at idx, or -1 on error.
 int bitmap_set(bitmap *bm, unsigned idx, int val);
 
+// set every bit in `dst' that is set in `src'. Return 0 on success
+// and -1 on error.
+int bitmap_or(bitmap *dst, bitmap *src);
+
+// return 1 if every bit set in `a' is also set in `b', 0 otherwise.
+int bitmap_is_subset(bitmap *a, bitmap *b);
+
+// return 1 if some bit is set in both `a' and `b', 0 otherwise.
+int bitmap_intersects(bitmap *a, bitmap *b);
+
+// return the number of set bits.
+size_t bitmap_count(bitmap *bm);
+
+// return the smallest index from `idx' on that is set in `a' and not
+// in `b', or -1 if there is none. Whole cells without such a bit are
+// skipped at once.
+long bitmap_next_diff(bitmap *a, bitmap *b, unsigned idx);
+
+// unset every bit.
+void bitmap_clear(bitmap *bm);
+
 #endif // BITMAP_H
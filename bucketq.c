@@ -0,0 +1,163 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "vector.h"
+#include "bucketq.h"
+
+#define WORD_WIDTH (64)
+#define NONE ((unsigned) -1)
+typedef uint64_t word;
+
+// values in the same bucket form a singly linked list threaded
+// through the entry vector, so equal priorities come out FIFO.
+typedef struct entry {
+    unsigned v;
+    unsigned next;
+} entry;
+
+DECLARE_VECTOR(entry_vec, entry);
+DEFINE_VECTOR(entry_vec, entry);
+
+struct bucketq {
+    entry_vec entries;
+    unsigned *heads;
+    unsigned *tails;
+    // one bit per bucket, set iff the bucket is non-empty
+    word *occupied;
+    unsigned max_prio;
+    // no word of `occupied' above this index has a bit set
+    unsigned top_word;
+    size_t size;
+};
+
+bucketq *bucketq_create(unsigned max_prio) {
+    assert(max_prio != NONE);
+    bucketq *q = malloc(sizeof(*q));
+    if (q == NULL) {
+        return NULL;
+    }
+    size_t nbuckets = (size_t) max_prio + 1;
+    size_t nwords = nbuckets / WORD_WIDTH + 1;
+    if (entry_vec_init(&q->entries, 0) != 0) {
+        goto err1;
+    }
+    q->heads = malloc(nbuckets * sizeof(*q->heads));
+    q->tails = malloc(nbuckets * sizeof(*q->tails));
+    q->occupied = calloc(nwords, sizeof(*q->occupied));
+    if (q->heads == NULL || q->tails == NULL || q->occupied == NULL) {
+        goto err2;
+    }
+    memset(q->heads, -1, nbuckets * sizeof(*q->heads));
+    q->max_prio = max_prio;
+    q->top_word = 0;
+    q->size = 0;
+    return q;
+ err2:
+    free(q->heads);
+    free(q->tails);
+    free(q->occupied);
+    entry_vec_destroy(&q->entries);
+ err1:
+    free(q);
+    return NULL;
+}
+
+void bucketq_destroy(bucketq *q) {
+    assert(q != NULL);
+    entry_vec_destroy(&q->entries);
+    free(q->heads);
+    free(q->tails);
+    free(q->occupied);
+    free(q);
+}
+
+size_t bucketq_size(bucketq *q) {
+    assert(q != NULL);
+    return q->size;
+}
+
+unsigned bucketq_max_prio(bucketq *q) {
+    assert(q != NULL);
+    return q->max_prio;
+}
+
+int bucketq_put(bucketq *q, unsigned val, unsigned prio) {
+    assert(q != NULL);
+    assert(prio <= q->max_prio);
+    unsigned idx = q->entries.size;
+    if (entry_vec_push(&q->entries, (entry) {.v = val, .next = NONE}) != 0) {
+        return -1;
+    }
+    if (q->heads[prio] == NONE) {
+        q->heads[prio] = idx;
+        unsigned w = prio / WORD_WIDTH;
+        q->occupied[w] |= (word) 1 << (prio % WORD_WIDTH);
+        q->top_word = (w > q->top_word) ? w : q->top_word;
+    }
+    else {
+        q->entries.data[q->tails[prio]].next = idx;
+    }
+    q->tails[prio] = idx;
+    q->size++;
+    return 0;
+}
+
+unsigned bucketq_get(bucketq *q) {
+    assert(q != NULL);
+    if (q->size == 0) {
+        return NONE;
+    }
+    while (q->occupied[q->top_word] == 0) {
+        assert(q->top_word > 0);
+        q->top_word--;
+    }
+    word w = q->occupied[q->top_word];
+    unsigned prio = q->top_word * WORD_WIDTH +
+        (WORD_WIDTH - 1 - __builtin_clzll(w));
+    entry e = q->entries.data[q->heads[prio]];
+    q->heads[prio] = e.next;
+    if (e.next == NONE) {
+        q->occupied[q->top_word] &= ~((word) 1 << (prio % WORD_WIDTH));
+    }
+    // all buckets are empty, so the entry storage can be reused
+    if (--q->size == 0) {
+        q->entries.size = 0;
+    }
+    return e.v;
+}
+
+void bucketq_clear(bucketq *q) {
+    assert(q != NULL);
+    while (q->size > 0) {
+        bucketq_get(q);
+    }
+}
+
+size_t bucket_sort_unique(unsigned *vals, size_t n) {
+    assert(n == 0 || vals != NULL);
+    if (n == 0) {
+        return 0;
+    }
+    unsigned max_val = 0;
+    for (size_t i = 0; i < n; i++) {
+        max_val = (vals[i] > max_val) ? vals[i] : max_val;
+    }
+    size_t nwords = max_val / WORD_WIDTH + 1;
+    word *seen = calloc(nwords, sizeof(*seen));
+    if (seen == NULL) {
+        return (size_t) -1;
+    }
+    for (size_t i = 0; i < n; i++) {
+        seen[vals[i] / WORD_WIDTH] |= (word) 1 << (vals[i] % WORD_WIDTH);
+    }
+    size_t count = 0;
+    for (size_t i = 0; i < nwords; i++) {
+        for (word w = seen[i]; w != 0; w &= w - 1) {
+            vals[count++] = i * WORD_WIDTH + __builtin_ctzll(w);
+        }
+    }
+    free(seen);
+    return count;
+}
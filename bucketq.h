@@ -0,0 +1,43 @@
+#ifndef BUCKETQ_H
+#define BUCKETQ_H
+
+#include <stdlib.h>
+
+struct bucketq;
+typedef struct bucketq bucketq;
+
+// create and return a pointer to a bucket max-queue that holds
+// unsigneds as values with unsigned priorities no greater than
+// `max_prio'. Returns NULL on failure.
+bucketq *bucketq_create(unsigned max_prio);
+
+// clean up resources associated with the bucketq.
+void bucketq_destroy(bucketq *q);
+
+// returns the number of items in the bucketq.
+size_t bucketq_size(bucketq *q);
+
+// returns the largest priority the bucketq accepts.
+unsigned bucketq_max_prio(bucketq *q);
+
+// insert `val' into the queue with priority `prio', which must not be
+// greater than the queue's maximum priority. Return 0 on success and
+// -1 on failure.
+int bucketq_put(bucketq *q, unsigned val, unsigned prio);
+
+// returns the value with maximum priority or ((unsigned) -1) if the
+// queue is empty. Values with equal priority are returned in the
+// order they were inserted, so the output order is fully determined
+// by the sequence of puts.
+unsigned bucketq_get(bucketq *q);
+
+// remove all items from the queue.
+void bucketq_clear(bucketq *q);
+
+// sorts the `n' values in `vals' into ascending order and removes
+// duplicates using a counting sort over [0, max(vals)]. Returns the
+// number of distinct values left at the front of `vals', or
+// ((size_t) -1) on failure.
+size_t bucket_sort_unique(unsigned *vals, size_t n);
+
+#endif // BUCKETQ_H
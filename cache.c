@@ -0,0 +1,254 @@
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cache.h"
+
+// cache files are named <dag hash>-<m>-<config hash> and look like
+//
+// key 3f0c9a1d5e7b2468 4 bounds=5,adaptive=0,...
+// result optimal 26 26
+// time 60 0.125000
+// order 14 0 2 1 ...
+// stats 1 0 0 0 0 5123 ...
+//
+// where the result line holds the makespan and the lower bound, the
+// time line the timeout and the seconds taken, and the stats line the
+// bbstats counters in declaration order, with the per stage counters
+// last. The key line guards against collisions of the file names.
+
+void cache_entry_destroy(cache_entry *e) {
+    assert(e != NULL);
+    free(e->order);
+    e->order = NULL;
+    e->order_len = 0;
+}
+
+void cache_config(const bbopts *opts, char *buf, size_t len) {
+    assert(opts != NULL);
+    assert(buf != NULL);
+    snprintf(buf, len, "bounds=%u,adaptive=%d,branch=%s,search=%s,"
+             "seed=%llu,decompose=%d,direction=%s,portfolio=%d,dp=%d",
+             opts->bounds, opts->adaptive, branch_policy_name(opts->branch),
+             search_driver_name(opts->driver), opts->seed, opts->decompose,
+             search_direction_name(opts->direction), opts->portfolio,
+             opts->dp);
+}
+
+void cache_path(const char *dir, uint64_t hash, unsigned m,
+                const char *config, char *path, size_t len) {
+    assert(dir != NULL);
+    assert(config != NULL);
+    assert(path != NULL);
+    uint64_t config_hash = 0xcbf29ce484222325ull;
+    for (const char *c = config; *c != '\0'; c++) {
+        config_hash = (config_hash ^ (unsigned char) *c) * 0x100000001b3ull;
+    }
+    snprintf(path, len, "%s/%016" PRIx64 "-%u-%016" PRIx64, dir, hash, m,
+             config_hash);
+}
+
+int cache_lookup(const char *dir, uint64_t hash, unsigned m,
+                 const char *config, cache_entry *e) {
+    assert(dir != NULL);
+    assert(config != NULL);
+    assert(e != NULL);
+    size_t len = strlen(dir) + 64;
+    char path[len];
+    cache_path(dir, hash, m, config, path, len);
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        return -1;
+    }
+    e->order = NULL;
+    e->order_len = 0;
+    char status[16];
+    bbstats *st = &e->stats;
+    memset(st, 0, sizeof(*st));
+    if (fscanf(f, " key %" SCNx64 " %u %127s result %15s %u %u time %d %lf"
+               " order %zu", &e->hash, &e->m, e->config, status,
+               &e->makespan, &e->bound, &e->timeout, &e->seconds,
+               &e->order_len) != 9 ||
+        e->hash != hash || e->m != m || strcmp(e->config, config) != 0) {
+        goto err;
+    }
+    e->optimal = strcmp(status, "optimal") == 0;
+    e->order = malloc((e->order_len + 1) * sizeof(*e->order));
+    if (e->order == NULL) {
+        goto err;
+    }
+    for (size_t i = 0; i < e->order_len; i++) {
+        if (fscanf(f, "%u", &e->order[i]) != 1) {
+            goto err;
+        }
+    }
+    if (fscanf(f, " stats %lu %lu %lu %lu %lu %lu %lu %lu", &st->blocks,
+               &st->width_closed, &st->path_closed, &st->root_closed,
+               &st->gap_closed, &st->dp_closed, &st->nodes,
+               &st->passes) != 8) {
+        goto err;
+    }
+    for (int i = 0; i < N_STAGES; i++) {
+        if (fscanf(f, "%lu %lu %lu", &st->tries[i], &st->prunes[i],
+                   &st->skips[i]) != 3) {
+            goto err;
+        }
+    }
+    fclose(f);
+    return 0;
+ err:
+    cache_entry_destroy(e);
+    fclose(f);
+    return -1;
+}
+
+int cache_store(const char *dir, const cache_entry *e) {
+    assert(dir != NULL);
+    assert(e != NULL);
+    size_t len = strlen(dir) + 64;
+    char path[len];
+    char tmp[len + 4];
+    cache_path(dir, e->hash, e->m, e->config, path, len);
+    snprintf(tmp, len + 4, "%s.tmp", path);
+    FILE *f = fopen(tmp, "w");
+    if (f == NULL) {
+        return -1;
+    }
+    const bbstats *st = &e->stats;
+    fprintf(f, "key %016" PRIx64 " %u %s\n", e->hash, e->m, e->config);
+    fprintf(f, "result %s %u %u\n", e->optimal ? "optimal" : "timeout",
+            e->makespan, e->bound);
+    fprintf(f, "time %d %f\n", e->timeout, e->seconds);
+    fprintf(f, "order %zu", e->order_len);
+    for (size_t i = 0; i < e->order_len; i++) {
+        fprintf(f, " %u", e->order[i]);
+    }
+    fprintf(f, "\nstats %lu %lu %lu %lu %lu %lu %lu %lu", st->blocks,
+            st->width_closed, st->path_closed, st->root_closed,
+            st->gap_closed, st->dp_closed, st->nodes, st->passes);
+    for (int i = 0; i < N_STAGES; i++) {
+        fprintf(f, " %lu %lu %lu", st->tries[i], st->prunes[i],
+                st->skips[i]);
+    }
+    fprintf(f, "\n");
+    if (fclose(f) != 0 || rename(tmp, path) != 0) {
+        remove(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+// cache_solve for the dag `g' as bbsearch_reduce left it.
+static int solve_reduced(const char *dir, dag *g, unsigned m, int timeout,
+                         const bbopts *opts, unsigned *order,
+                         bbstats *stats, double *seconds,
+                         cache_status *status) {
+    size_t size = dag_size(g);
+    cache_entry e;
+    e.hash = dag_hash(g);
+    e.m = m;
+    cache_config(opts, e.config, sizeof(e.config));
+    cache_entry old;
+    int found = cache_lookup(dir, e.hash, m, e.config, &old) == 0;
+    if (found && old.order_len != size) {
+        cache_entry_destroy(&old);
+        found = 0;
+    }
+    // a time out is final unless this search may run for longer
+    if (found && (old.optimal ||
+                  (old.timeout >= 0 && timeout >= 0 &&
+                   timeout <= old.timeout))) {
+        if (order != NULL) {
+            memcpy(order, old.order, size * sizeof(*order));
+        }
+        if (stats != NULL) {
+            *stats = old.stats;
+        }
+        if (seconds != NULL) {
+            *seconds = old.seconds;
+        }
+        if (status != NULL) {
+            *status = CACHE_HIT;
+        }
+        int result = old.optimal ? (int) old.makespan : -2;
+        cache_entry_destroy(&old);
+        return result;
+    }
+
+    e.order_len = size;
+    e.order = malloc(size * sizeof(*e.order));
+    if (e.order == NULL) {
+        if (found) {
+            cache_entry_destroy(&old);
+        }
+        return -1;
+    }
+    bbwarm warm = {.order = NULL};
+    if (found) {
+        warm.order = old.order;
+    }
+    clock_t start = clock();
+    int result = bbsearch_warm(g, m, timeout, opts, found ? &warm : NULL,
+                               e.order, &e.stats);
+    e.seconds = ((double) clock() - (double) start) / CLOCKS_PER_SEC;
+    e.timeout = timeout;
+    if (result >= 0) {
+        e.optimal = 1;
+        e.makespan = result;
+        e.bound = result;
+    }
+    else if (result == -2) {
+        // the closure the search took keeps the order valid
+        int length = bbsearch_order_length(g, m, e.order);
+        unsigned bound = bbsearch_root_bound(g, m);
+        e.optimal = 0;
+        e.makespan = length;
+        e.bound = (found && old.bound > bound) ? old.bound : bound;
+        if (length < 0) {
+            result = -1;
+        }
+    }
+    if ((result >= 0 || result == -2) && cache_store(dir, &e) != 0) {
+        result = -1;
+    }
+    if (order != NULL && result != -1) {
+        memcpy(order, e.order, size * sizeof(*order));
+    }
+    if (stats != NULL) {
+        *stats = e.stats;
+    }
+    if (seconds != NULL) {
+        *seconds = e.seconds;
+    }
+    if (status != NULL) {
+        *status = found ? CACHE_WARM : CACHE_MISS;
+    }
+    if (found) {
+        cache_entry_destroy(&old);
+    }
+    cache_entry_destroy(&e);
+    return result;
+}
+
+int cache_solve(const char *dir, dag *g, unsigned m, int timeout,
+                const bbopts *opts, unsigned *order, bbstats *stats,
+                double *seconds, cache_status *status) {
+    assert(dir != NULL);
+    assert(g != NULL);
+    assert(opts != NULL);
+    // key on the reduced dag, which the search takes anyway, so that
+    // redundant edges do not change the key
+    dag *reduced = bbsearch_reduce(g);
+    if (reduced == NULL) {
+        return -1;
+    }
+    int result = solve_reduced(dir, reduced, m, timeout, opts, order, stats,
+                               seconds, status);
+    if (reduced != g) {
+        dag_destroy(reduced);
+    }
+    return result;
+}
@@ -0,0 +1,82 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "bbsearch.h"
+#include "dag.h"
+
+// A directory of solved instances, one small text file per instance,
+// keyed by the dag's content hash, the number of machines and the
+// options that change the search. Proven optima are answered from it
+// without searching. Timed out searches keep their best schedule and
+// lower bound, and a later search with a longer timeout starts from
+// them.
+typedef struct cache_entry {
+    // the instance: dag_hash of the reduced dag, machines and the
+    // cache_config string of the options
+    uint64_t hash;
+    unsigned m;
+    char config[128];
+    // 1 if `makespan' is optimal, and 0 if the search timed out and it
+    // is the best makespan found
+    int optimal;
+    unsigned makespan;
+    // a lower bound on the makespan, equal to it if optimal
+    unsigned bound;
+    // the search's timeout, negative for none, and the seconds it took
+    int timeout;
+    double seconds;
+    // an order of all tasks that evaluates to `makespan'
+    size_t order_len;
+    unsigned *order;
+    bbstats stats;
+} cache_entry;
+
+// how cache_solve answered.
+typedef enum cache_status {
+    // the instance was searched from scratch
+    CACHE_MISS,
+    // the result came from the cache without a search
+    CACHE_HIT,
+    // a timed out entry was searched again, starting from its best
+    // schedule and bound
+    CACHE_WARM,
+} cache_status;
+
+// clean up the order owned by the entry.
+void cache_entry_destroy(cache_entry *e);
+
+// writes the options that change a search's result or statistics into
+// `buf', which holds `len' bytes, as a string without spaces.
+void cache_config(const bbopts *opts, char *buf, size_t len);
+
+// reads the entry for an instance from the cache in `dir' into `e',
+// which owns its order afterwards. Returns 0 on success and -1 if
+// there is none or it cannot be read.
+int cache_lookup(const char *dir, uint64_t hash, unsigned m,
+                 const char *config, cache_entry *e);
+
+// writes the path of an instance's file in the cache in `dir' to
+// `path', which holds `len' bytes.
+void cache_path(const char *dir, uint64_t hash, unsigned m,
+                const char *config, char *path, size_t len);
+
+// writes the entry to the cache in `dir', replacing the instance's
+// previous entry atomically. Returns 0 on success and -1 on failure.
+int cache_store(const char *dir, const cache_entry *e);
+
+// solves `g' like bbsearch_warm without a warm start, but through the
+// cache in `dir', which must exist. A proven optimum in the cache is
+// returned as is, as is a time out of a search that had at least
+// `timeout' seconds. Any other time out is searched again from its
+// best schedule and bound. Whatever the search finds is stored.
+// `seconds' receives the time of the search, or of the cached search,
+// `status' how the result was found, and `order' and `stats' the order
+// and counters, each if not NULL.
+int cache_solve(const char *dir, dag *g, unsigned m, int timeout,
+                const bbopts *opts, unsigned *order, bbstats *stats,
+                double *seconds, cache_status *status);
+
+#endif // CACHE_H
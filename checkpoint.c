@@ -0,0 +1,122 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "checkpoint.h"
+
+// checkpoint files look like
+//
+// m 4
+// block 0 0
+// incumbent 26 4 0 2 1 3
+// path 2 0 2
+// stats 1 0 0 0 0 0 5123 1 ...
+//
+// where the incumbent line holds the makespan, then the order's
+// length and tasks, and the stats line holds the bbstats counters in
+// declaration order, with the per stage counters last.
+
+void checkpoint_destroy(checkpoint *cp) {
+    assert(cp != NULL);
+    free(cp->order);
+    free(cp->path);
+    cp->order = NULL;
+    cp->path = NULL;
+    cp->order_len = 0;
+    cp->len = 0;
+}
+
+static void write_ids(FILE *f, const unsigned *ids, size_t len) {
+    fprintf(f, " %zu", len);
+    for (size_t i = 0; i < len; i++) {
+        fprintf(f, " %u", ids[i]);
+    }
+    fprintf(f, "\n");
+}
+
+// reads a length and that many ids into a new array. Returns 0 on
+// success and -1 on failure.
+static int read_ids(FILE *f, unsigned **ids, size_t *len) {
+    if (fscanf(f, "%zu", len) != 1) {
+        return -1;
+    }
+    *ids = malloc((*len + 1) * sizeof(**ids));
+    if (*ids == NULL) {
+        return -1;
+    }
+    for (size_t i = 0; i < *len; i++) {
+        if (fscanf(f, "%u", &(*ids)[i]) != 1) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int checkpoint_write(const char *path, const checkpoint *cp) {
+    assert(path != NULL);
+    assert(cp != NULL);
+    size_t len = strlen(path) + 5;
+    char tmp[len];
+    snprintf(tmp, len, "%s.tmp", path);
+    FILE *f = fopen(tmp, "w");
+    if (f == NULL) {
+        return -1;
+    }
+    const bbstats *st = &cp->stats;
+    fprintf(f, "m %u\n", cp->m);
+    fprintf(f, "block %u %u\n", cp->block, cp->done);
+    fprintf(f, "incumbent %u", cp->incumbent);
+    write_ids(f, cp->order, cp->order_len);
+    fprintf(f, "path");
+    write_ids(f, cp->path, cp->len);
+    fprintf(f, "stats %lu %lu %lu %lu %lu %lu %lu %lu", st->blocks,
+            st->width_closed, st->path_closed, st->root_closed,
+            st->gap_closed, st->dp_closed, st->nodes, st->passes);
+    for (int i = 0; i < N_STAGES; i++) {
+        fprintf(f, " %lu %lu %lu", st->tries[i], st->prunes[i],
+                st->skips[i]);
+    }
+    fprintf(f, "\n");
+    if (fclose(f) != 0 || rename(tmp, path) != 0) {
+        remove(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+int checkpoint_read(const char *path, checkpoint *cp) {
+    assert(path != NULL);
+    assert(cp != NULL);
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        return -1;
+    }
+    cp->order = NULL;
+    cp->path = NULL;
+    char word[8];
+    bbstats *st = &cp->stats;
+    if (fscanf(f, " m %u block %u %u incumbent %u", &cp->m, &cp->block,
+               &cp->done, &cp->incumbent) != 4 ||
+        read_ids(f, &cp->order, &cp->order_len) != 0 ||
+        fscanf(f, " %7s", word) != 1 || strcmp(word, "path") != 0 ||
+        read_ids(f, &cp->path, &cp->len) != 0 ||
+        fscanf(f, " stats %lu %lu %lu %lu %lu %lu %lu %lu", &st->blocks,
+               &st->width_closed, &st->path_closed, &st->root_closed,
+               &st->gap_closed, &st->dp_closed, &st->nodes,
+               &st->passes) != 8) {
+        goto err;
+    }
+    for (int i = 0; i < N_STAGES; i++) {
+        if (fscanf(f, "%lu %lu %lu", &st->tries[i], &st->prunes[i],
+                   &st->skips[i]) != 3) {
+            goto err;
+        }
+    }
+    fclose(f);
+    return 0;
+ err:
+    checkpoint_destroy(cp);
+    fclose(f);
+    return -1;
+}
@@ -0,0 +1,41 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdlib.h>
+
+#include "bbsearch.h"
+
+// The state of an interrupted search. Children are always tried in
+// the same order, so the path to the node being searched when the
+// checkpoint was written is all that is needed to continue: at each
+// depth, the children before the path's task have been fully
+// searched, and those after it have not been started.
+typedef struct checkpoint {
+    unsigned m;
+    // the series block being searched, and the sum of the makespans
+    // of the blocks before it
+    unsigned block;
+    unsigned done;
+    // the best schedule of the block found so far, as a task order
+    unsigned incumbent;
+    size_t order_len;
+    unsigned *order;
+    // the path to the current node, starting with the source
+    size_t len;
+    unsigned *path;
+    bbstats stats;
+} checkpoint;
+
+// clean up the arrays owned by the checkpoint.
+void checkpoint_destroy(checkpoint *cp);
+
+// write the checkpoint to the file at `path', replacing it
+// atomically so an interrupted write leaves the previous checkpoint
+// intact. Return 0 on success and -1 on failure.
+int checkpoint_write(const char *path, const checkpoint *cp);
+
+// read the checkpoint stored in the file at `path' into `cp', which
+// owns its arrays afterwards. Return 0 on success and -1 on failure.
+int checkpoint_read(const char *path, checkpoint *cp);
+
+#endif // CHECKPOINT_H
@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -41,6 +42,10 @@ DEFINE_VECTOR(node_vec, node);
 struct dag {
     node_vec nodes;
     int built;
+    // descendants of each vertex, or NULL before dag_closure
+    bitmap **descs;
+    // cached result of dag_width, or 0 if not computed yet
+    size_t width;
 };
 
 dag *dag_create(void) {
@@ -60,6 +65,8 @@ dag *dag_create(void) {
         goto err3;
     }
     g->built = 0;
+    g->descs = NULL;
+    g->width = 0;
     return g;
  err3:
     node_destroy(&s);
@@ -74,7 +81,11 @@ void dag_destroy(dag *g) {
     assert(g != NULL);
     for (size_t i = 0, size = dag_size(g); i < size; i++) {
         node_destroy(&g->nodes.data[i]);
+        if (g->descs != NULL) {
+            bitmap_destroy(g->descs[i]);
+        }
     }
+    free(g->descs);
     node_vec_destroy(&g->nodes);
     free(g);
 }
@@ -112,33 +123,18 @@ unsigned dag_vertex(dag *g, int weight, size_t n_deps, unsigned *deps) {
     return idx;
 }
 
-// calculate lvl
-static void lvl_visit(dag *g, unsigned idx, idx_vec *lvl_ready,
-                      bitmap *lvl_finished) {
-    size_t npreds = dag_npreds(g, idx);
-    unsigned preds[npreds];
-    dag_preds(g, idx, preds);
-    for (size_t i = 0; i < npreds; i++) {
-        unsigned pred = preds[i];
-        size_t nsuccs = dag_nsuccs(g, pred);
-        unsigned succs[nsuccs];
-        dag_succs(g, pred, succs);
-        int succs_complete = 1;
+// computes the level of every vertex of a dag with a sink.
+static void compute_levels(dag *g) {
+    // ids are a topological order, so sweeping them backwards visits
+    // every vertex after all of its successors
+    for (size_t i = g->nodes.size; i-- > 0;) {
+        node *n = &g->nodes.data[i];
         unsigned max_level = 0;
-        for (size_t j = 0; j < nsuccs; j++) {
-            if (bitmap_get(lvl_finished, succs[j]) != 1) {
-                succs_complete = 0;
-                break;
-            }
-            max_level = (g->nodes.data[succs[j]].level > max_level) ?
-                g->nodes.data[succs[j]].level : max_level;
-        }
-        // all successors have calculated levels
-        if (succs_complete) {
-            g->nodes.data[pred].level = dag_weight(g, pred) + max_level;
-            bitmap_set(lvl_finished, pred, 1);
-            idx_vec_push(lvl_ready, pred);
+        for (size_t j = 0; j < n->succs.size; j++) {
+            unsigned level = g->nodes.data[n->succs.data[j]].level;
+            max_level = (level > max_level) ? level : max_level;
         }
+        n->level = n->weight + max_level;
     }
 }
 
@@ -154,32 +150,515 @@ int dag_build(dag *g) {
             }
         }
         // construct sink node
-        dag_vertex(g, 0, exit_nodes.size, exit_nodes.data);
+        unsigned sink = dag_vertex(g, 0, exit_nodes.size, exit_nodes.data);
         idx_vec_destroy(&exit_nodes);
-
-        // calculate level of each vertex
-        idx_vec lvl_ready;
-        if (idx_vec_init(&lvl_ready, 0) != 0) {
+        if (sink == (unsigned) -1) {
             return -1;
         }
-        bitmap *lvl_finished = bitmap_create(dag_size(g));
-        if (lvl_finished == NULL) {
+        compute_levels(g);
+    }
+    g->built = 1;
+    return 0;
+}
+
+// pushes the ids in `from', each mapped to `size - 1 - id', onto `to'.
+// Returns 0 on success and -1 on failure.
+static int push_mirrored(idx_vec *to, const idx_vec *from, size_t size) {
+    for (size_t i = 0; i < from->size; i++) {
+        if (idx_vec_push(to, size - 1 - from->data[i]) != 0) {
             return -1;
         }
-        idx_vec_push(&lvl_ready, dag_sink(g));
-        bitmap_set(lvl_finished, dag_sink(g), 1);
-        while (lvl_ready.size > 0) {
-            unsigned idx;
-            idx_vec_pop(&lvl_ready, &idx);
-            lvl_visit(g, idx, &lvl_ready, lvl_finished);
+    }
+    return 0;
+}
+
+dag *dag_reverse(dag *g) {
+    assert(g != NULL);
+    assert(g->built);
+    size_t size = dag_size(g);
+    dag *r = dag_create();
+    if (r == NULL) {
+        return NULL;
+    }
+    // the source dag_create made stands in for the sink
+    for (size_t i = 0; i < size; i++) {
+        node *from = &g->nodes.data[size - 1 - i];
+        node n;
+        if (i > 0 && node_init(&n, from->weight) != 0) {
+            goto err;
+        }
+        if (i > 0 && node_vec_push(&r->nodes, n) != 0) {
+            node_destroy(&n);
+            goto err;
+        }
+        node *to = &r->nodes.data[i];
+        if (push_mirrored(&to->preds, &from->succs, size) != 0 ||
+            push_mirrored(&to->succs, &from->preds, size) != 0) {
+            goto err;
         }
-        idx_vec_destroy(&lvl_ready);
-        bitmap_destroy(lvl_finished);
     }
-    g->built = 1;
+    compute_levels(r);
+    r->built = 1;
+    return r;
+ err:
+    dag_destroy(r);
+    return NULL;
+}
+
+// remove the first occurrence of `val' from `vec', keeping the order
+// of the remaining items.
+static void idx_vec_remove(idx_vec *vec, unsigned val) {
+    for (size_t i = 0; i < vec->size; i++) {
+        if (vec->data[i] == val) {
+            memmove(&vec->data[i], &vec->data[i + 1],
+                    (vec->size - i - 1) * sizeof(unsigned));
+            vec->size--;
+            return;
+        }
+    }
+}
+
+// returns 1 if `vec' contains `val', 0 otherwise.
+static int idx_vec_contains(idx_vec *vec, unsigned val) {
+    for (size_t i = 0; i < vec->size; i++) {
+        if (vec->data[i] == val) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// recomputes the level of `id', and of its ancestors as long as levels
+// change. Successors have larger ids, so visiting vertices in
+// decreasing id order sees every vertex after all of its successors.
+static int update_levels(dag *g, unsigned id) {
+    binheap *heap = binheap_create();
+    bitmap *queued = bitmap_create(dag_size(g));
+    if (heap == NULL || queued == NULL || binheap_put(heap, id, id) != 0) {
+        goto err;
+    }
+    bitmap_set(queued, id, 1);
+    while (binheap_size(heap) > 0) {
+        unsigned v = binheap_get(heap);
+        node *n = &g->nodes.data[v];
+        unsigned max_level = 0;
+        for (size_t i = 0; i < n->succs.size; i++) {
+            unsigned level = g->nodes.data[n->succs.data[i]].level;
+            max_level = (level > max_level) ? level : max_level;
+        }
+        unsigned level = n->weight + max_level;
+        if (level == n->level && v != id) {
+            continue;
+        }
+        n->level = level;
+        for (size_t i = 0; i < n->preds.size; i++) {
+            unsigned pred = n->preds.data[i];
+            if (bitmap_get(queued, pred) != 1) {
+                bitmap_set(queued, pred, 1);
+                if (binheap_put(heap, pred, pred) != 0) {
+                    goto err;
+                }
+            }
+        }
+    }
+    binheap_destroy(heap);
+    bitmap_destroy(queued);
+    return 0;
+ err:
+    if (heap != NULL) {
+        binheap_destroy(heap);
+    }
+    if (queued != NULL) {
+        bitmap_destroy(queued);
+    }
+    return -1;
+}
+
+// frees the closure, which no longer matches the edges.
+static void drop_closure(dag *g) {
+    if (g->descs == NULL) {
+        return;
+    }
+    for (size_t i = 0, size = dag_size(g); i < size; i++) {
+        bitmap_destroy(g->descs[i]);
+    }
+    free(g->descs);
+    g->descs = NULL;
+    g->width = 0;
+}
+
+static int push_edge(dag *g, unsigned from, unsigned to) {
+    if (idx_vec_push(&g->nodes.data[from].succs, to) != 0) {
+        return -1;
+    }
+    if (idx_vec_push(&g->nodes.data[to].preds, from) != 0) {
+        idx_vec_remove(&g->nodes.data[from].succs, to);
+        return -1;
+    }
+    return 0;
+}
+
+static void pop_edge(dag *g, unsigned from, unsigned to) {
+    idx_vec_remove(&g->nodes.data[from].succs, to);
+    idx_vec_remove(&g->nodes.data[to].preds, from);
+}
+
+int dag_set_weight(dag *g, unsigned id, int weight) {
+    assert(g != NULL);
+    assert(g->built);
+    assert(id < dag_size(g));
+    assert(weight >= 0);
+    g->nodes.data[id].weight = weight;
+    return update_levels(g, id);
+}
+
+int dag_add_edge(dag *g, unsigned from, unsigned to) {
+    assert(g != NULL);
+    assert(g->built);
+    if (from >= to || to >= dag_size(g)) {
+        return -1;
+    }
+    node *tail = &g->nodes.data[from];
+    if (idx_vec_contains(&tail->succs, to)) {
+        return 0;
+    }
+    if (push_edge(g, from, to) != 0) {
+        return -1;
+    }
+    // `from' is no longer an exit, and `to' no longer an entry
+    unsigned sink = dag_sink(g);
+    if (to != sink && idx_vec_contains(&tail->succs, sink)) {
+        pop_edge(g, from, sink);
+    }
+    unsigned source = dag_source(g);
+    if (from != source &&
+        idx_vec_contains(&g->nodes.data[to].preds, source)) {
+        pop_edge(g, source, to);
+    }
+    drop_closure(g);
+    return update_levels(g, from);
+}
+
+int dag_remove_edge(dag *g, unsigned from, unsigned to) {
+    assert(g != NULL);
+    assert(g->built);
+    if (from >= to || to >= dag_size(g) ||
+        !idx_vec_contains(&g->nodes.data[from].succs, to)) {
+        return -1;
+    }
+    pop_edge(g, from, to);
+    unsigned sink = dag_sink(g);
+    unsigned source = dag_source(g);
+    if (g->nodes.data[from].succs.size == 0 && push_edge(g, from, sink) != 0) {
+        return -1;
+    }
+    int new_entry = g->nodes.data[to].preds.size == 0;
+    if (new_entry && push_edge(g, source, to) != 0) {
+        return -1;
+    }
+    drop_closure(g);
+    if (update_levels(g, from) != 0) {
+        return -1;
+    }
+    return new_entry ? update_levels(g, source) : 0;
+}
+
+int dag_closure(dag *g) {
+    assert(g != NULL);
+    assert(g->built);
+    if (g->descs != NULL) {
+        return 0;
+    }
+    size_t size = dag_size(g);
+    bitmap **descs = calloc(size, sizeof(*descs));
+    if (descs == NULL) {
+        return -1;
+    }
+    // predecessors always have smaller ids than their successors, so
+    // visiting ids in decreasing order visits successors first
+    for (size_t i = size; i-- > 0;) {
+        descs[i] = bitmap_create(size);
+        if (descs[i] == NULL) {
+            goto err;
+        }
+        idx_vec *succs = &g->nodes.data[i].succs;
+        for (size_t j = 0; j < succs->size; j++) {
+            bitmap_set(descs[i], succs->data[j], 1);
+            if (bitmap_or(descs[i], descs[succs->data[j]]) != 0) {
+                goto err;
+            }
+        }
+    }
+    // an edge is redundant if its head is reachable through another
+    // successor of its tail
+    for (size_t i = 0; i < size; i++) {
+        idx_vec *succs = &g->nodes.data[i].succs;
+        for (size_t j = 0; j < succs->size;) {
+            unsigned succ = succs->data[j];
+            int redundant = 0;
+            for (size_t k = 0; k < succs->size; k++) {
+                if (k != j && (succs->data[k] == succ ||
+                               bitmap_get(descs[succs->data[k]], succ))) {
+                    redundant = 1;
+                    break;
+                }
+            }
+            if (redundant) {
+                idx_vec_remove(succs, succ);
+                idx_vec_remove(&g->nodes.data[succ].preds, i);
+            }
+            else {
+                j++;
+            }
+        }
+    }
+    g->descs = descs;
+    return 0;
+ err:
+    for (size_t i = 0; i < size; i++) {
+        if (descs[i] != NULL) {
+            bitmap_destroy(descs[i]);
+        }
+    }
+    free(descs);
+    return -1;
+}
+
+int dag_has_closure(dag *g) {
+    assert(g != NULL);
+    return g->descs != NULL;
+}
+
+static int id_cmp(const void *a, const void *b) {
+    unsigned x = *(const unsigned *) a;
+    unsigned y = *(const unsigned *) b;
+    return (x > y) - (x < y);
+}
+
+// mixes the word `v' into the hash `h', FNV-1a style.
+static uint64_t hash_word(uint64_t h, uint64_t v) {
+    return (h ^ v) * 0x100000001b3ull;
+}
+
+uint64_t dag_hash(dag *g) {
+    assert(g != NULL);
+    uint64_t h = hash_word(0xcbf29ce484222325ull, g->nodes.size);
+    for (size_t i = 0; i < g->nodes.size; i++) {
+        node *n = &g->nodes.data[i];
+        h = hash_word(h, (uint32_t) n->weight);
+        h = hash_word(h, n->preds.size);
+        unsigned preds[n->preds.size + 1];
+        memcpy(preds, n->preds.data, n->preds.size * sizeof(*preds));
+        qsort(preds, n->preds.size, sizeof(*preds), id_cmp);
+        for (size_t j = 0; j < n->preds.size; j++) {
+            h = hash_word(h, preds[j]);
+        }
+    }
+    // spread the last words over all bits
+    h ^= h >> 31;
+    h *= 0x7fb5d329728ea185ull;
+    h ^= h >> 27;
+    return h;
+}
+
+int dag_reaches(dag *g, unsigned from, unsigned to) {
+    assert(g != NULL);
+    assert(g->descs != NULL);
+    assert(from < dag_size(g));
+    assert(to < dag_size(g));
+    return bitmap_get(g->descs[from], to);
+}
+
+int dag_descs_subset(dag *g, unsigned a, unsigned b) {
+    assert(g != NULL);
+    assert(g->descs != NULL);
+    assert(a < dag_size(g));
+    assert(b < dag_size(g));
+    return bitmap_is_subset(g->descs[a], g->descs[b]);
+}
+
+size_t dag_ndescs(dag *g, unsigned id) {
+    assert(g != NULL);
+    assert(g->descs != NULL);
+    assert(id < dag_size(g));
+    return bitmap_count(g->descs[id]);
+}
+
+#define UNMATCHED ((unsigned) -1)
+
+// state of the Hopcroft-Karp matching in dag_width: left vertex u is
+// joined to right vertex v wherever u reaches v.
+typedef struct {
+    dag *g;
+    // right partner of each left vertex and left partner of each right
+    // vertex, or UNMATCHED
+    unsigned *left;
+    unsigned *right;
+    // BFS layer of each left vertex, and the layer ending at a free
+    // right vertex
+    unsigned *layer;
+    unsigned free_layer;
+    unsigned *queue;
+    // right vertices already reached in this phase
+    bitmap *seen;
+} matching;
+
+// lays the left vertices out in layers of alternating paths from the
+// free ones. Returns whether a free right vertex can be reached.
+static int match_layers(matching *m) {
+    size_t size = dag_size(m->g);
+    size_t head = 0, tail = 0;
+    for (unsigned u = 0; u < size; u++) {
+        m->layer[u] = UNMATCHED;
+        if (m->left[u] == UNMATCHED) {
+            m->layer[u] = 0;
+            m->queue[tail++] = u;
+        }
+    }
+    m->free_layer = UNMATCHED;
+    bitmap_clear(m->seen);
+    while (head < tail) {
+        unsigned u = m->queue[head++];
+        if (m->layer[u] >= m->free_layer) {
+            break;
+        }
+        long v = bitmap_next_diff(m->g->descs[u], m->seen, 0);
+        for (; v >= 0; v = bitmap_next_diff(m->g->descs[u], m->seen, v + 1)) {
+            bitmap_set(m->seen, v, 1);
+            unsigned w = m->right[v];
+            if (w == UNMATCHED) {
+                m->free_layer = m->layer[u] + 1;
+            } else if (m->layer[w] == UNMATCHED) {
+                m->layer[w] = m->layer[u] + 1;
+                m->queue[tail++] = w;
+            }
+        }
+    }
+    return m->free_layer != UNMATCHED;
+}
+
+// augments along a shortest path from the left vertex `u' through the
+// layers. A right vertex on the next layer is tried at most once per
+// phase: if it fails, so does its partner from any other vertex.
+static int match_augment(matching *m, unsigned u) {
+    unsigned next = m->layer[u] + 1;
+    long v = bitmap_next_diff(m->g->descs[u], m->seen, 0);
+    for (; v >= 0; v = bitmap_next_diff(m->g->descs[u], m->seen, v + 1)) {
+        unsigned w = m->right[v];
+        if (w == UNMATCHED ? next != m->free_layer : m->layer[w] != next) {
+            continue;
+        }
+        bitmap_set(m->seen, v, 1);
+        if (w == UNMATCHED || match_augment(m, w)) {
+            m->left[u] = v;
+            m->right[v] = u;
+            return 1;
+        }
+    }
+    m->layer[u] = UNMATCHED;
     return 0;
 }
 
+size_t dag_width(dag *g) {
+    assert(g != NULL);
+    assert(g->descs != NULL);
+    if (g->width != 0) {
+        return g->width;
+    }
+    // by Dilworth's theorem, the width is the number of vertices minus a
+    // maximum matching between the vertices and their descendants
+    size_t size = dag_size(g);
+    matching m = {
+        .g = g,
+        .left = malloc(size * sizeof(*m.left)),
+        .right = malloc(size * sizeof(*m.right)),
+        .layer = malloc(size * sizeof(*m.layer)),
+        .queue = malloc(size * sizeof(*m.queue)),
+        .seen = bitmap_create(size),
+    };
+    size_t matched = (size_t) -1;
+    if (m.left == NULL || m.right == NULL || m.layer == NULL
+            || m.queue == NULL || m.seen == NULL) {
+        goto out;
+    }
+    memset(m.left, -1, size * sizeof(*m.left));
+    memset(m.right, -1, size * sizeof(*m.right));
+    // each phase augments along a maximal set of disjoint shortest
+    // paths, and there are O(sqrt(size)) phases
+    matched = 0;
+    while (match_layers(&m)) {
+        bitmap_clear(m.seen);
+        for (unsigned u = 0; u < size; u++) {
+            if (m.left[u] == UNMATCHED) {
+                matched += match_augment(&m, u);
+            }
+        }
+    }
+    g->width = size - matched;
+ out:
+    free(m.left);
+    free(m.right);
+    free(m.layer);
+    free(m.queue);
+    if (m.seen != NULL) {
+        bitmap_destroy(m.seen);
+    }
+    return matched == (size_t) -1 ? (size_t) -1 : g->width;
+}
+
+size_t dag_series_blocks(dag *g, unsigned *ends) {
+    assert(g != NULL);
+    assert(g->descs != NULL);
+    assert(ends != NULL);
+    size_t nblocks = 0;
+    unsigned last = dag_sink(g) - 1;
+    // the vertices up to `reach' have a non-descendant among the later
+    // vertices, so no block can end before it
+    unsigned reach = 0;
+    for (unsigned i = 1; i <= last; i++) {
+        for (unsigned j = last; j > reach && j > i; j--) {
+            if (!bitmap_get(g->descs[i], j)) {
+                reach = j;
+                break;
+            }
+        }
+        if (reach <= i) {
+            ends[nblocks++] = i;
+        }
+    }
+    return nblocks;
+}
+
+dag *dag_subgraph(dag *g, unsigned first, unsigned last) {
+    assert(g != NULL);
+    assert(first > dag_source(g));
+    assert(first <= last);
+    assert(last < dag_sink(g));
+    dag *sub = dag_create();
+    if (sub == NULL) {
+        return NULL;
+    }
+    for (unsigned i = first; i <= last; i++) {
+        idx_vec *preds = &g->nodes.data[i].preds;
+        unsigned deps[preds->size + 1];
+        size_t ndeps = 0;
+        for (size_t j = 0; j < preds->size; j++) {
+            if (preds->data[j] >= first) {
+                deps[ndeps++] = preds->data[j] - first + 1;
+            }
+        }
+        if (dag_vertex(sub, dag_weight(g, i), ndeps, deps) == (unsigned) -1) {
+            dag_destroy(sub);
+            return NULL;
+        }
+    }
+    if (dag_build(sub) != 0) {
+        dag_destroy(sub);
+        return NULL;
+    }
+    return sub;
+}
+
 unsigned dag_source(dag *g) {
     assert(g != NULL);
     return 0;
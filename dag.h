@@ -1,6 +1,9 @@
 #ifndef DAG_H
 #define DAG_H
 
+#include <stdint.h>
+#include <stdlib.h>
+
 struct dag;
 typedef struct dag dag;
 
@@ -15,7 +18,11 @@ size_t dag_size(dag *g);
 
 // returns the index of the new vertex, or ((unsigned) -1) on
 // failure. `g' must not be NULL, and `deps' may only be NULL if `n'
-// is 0. `deps' is not modified or freed.
+// is 0. `deps' is not modified or freed. Since dependencies must
+// already exist, vertex ids are a topological order: every edge goes
+// from a smaller id to a larger one, so a pass over increasing
+// (decreasing) ids visits each vertex after all of its predecessors
+// (successors).
 unsigned dag_vertex(dag *g, int weight, size_t n, unsigned *n_deps);
 
 // performs preprocessing on the dag. New vertices should not be added
@@ -45,4 +52,73 @@ int dag_weight(dag *g, unsigned id);
 // only be called after dag_build.
 int dag_level(dag *g, unsigned id);
 
+// set the weight of the vertex with the given `id' in a built dag,
+// updating the levels of its ancestors. Returns 0 on success, -1
+// otherwise.
+int dag_set_weight(dag *g, unsigned id, int weight);
+
+// adds (removes) the edge `from' -> `to' in a built dag, updating the
+// levels of `from' and its ancestors. Vertex ids stay a topological
+// order, so edges can only be added from a smaller to a larger id.
+// The source and sink stay connected to the vertices without
+// predecessors (successors). Drops the closure, which must be computed
+// again if needed; note that it removed redundant edges. Adding an
+// existing edge is a no-op. Returns 0 on success and -1 if the edge
+// would go backwards (does not exist) or on failure.
+int dag_add_edge(dag *g, unsigned from, unsigned to);
+int dag_remove_edge(dag *g, unsigned from, unsigned to);
+
+// removes edges implied by transitivity from a built dag and
+// precomputes the descendant set of every vertex. Levels are not
+// affected. Calling it again is a no-op. Returns 0 on success, -1
+// otherwise.
+int dag_closure(dag *g);
+
+// returns 1 if dag_closure has been run on `g', 0 otherwise.
+int dag_has_closure(dag *g);
+
+// returns a 64 bit hash of the dag's weights and edges, which does not
+// depend on the order edges were added in. dag_closure drops redundant
+// edges and so changes the hash.
+uint64_t dag_hash(dag *g);
+
+// returns 1 if there is a nonempty path from `from' to `to', 0
+// otherwise. This should only be called after dag_closure.
+int dag_reaches(dag *g, unsigned from, unsigned to);
+
+// returns 1 if every descendant of `a' is also a descendant of `b', 0
+// otherwise. This should only be called after dag_closure.
+int dag_descs_subset(dag *g, unsigned a, unsigned b);
+
+// returns the number of descendants of the vertex with the given
+// `id'. This should only be called after dag_closure.
+size_t dag_ndescs(dag *g, unsigned id);
+
+// returns the width of the dag: the size of its largest set of
+// pairwise incomparable vertices, computed as the number of vertices
+// minus a maximum matching in the reachability relation (Dilworth's
+// theorem). Returns ((size_t) -1) on failure. This should only be
+// called after dag_closure.
+size_t dag_width(dag *g);
+
+// splits the vertices other than the source and sink into blocks of
+// consecutive ids such that every vertex of a block is an ancestor of
+// every vertex in later blocks, using as many blocks as possible.
+// Stores the last id of each block in `ends', which must have room for
+// dag_size(g) entries, and returns the number of blocks. This should
+// only be called after dag_closure.
+size_t dag_series_blocks(dag *g, unsigned *ends);
+
+// returns a new, built dag holding the vertices with ids in [first,
+// last] and the edges between them, or NULL on failure. Vertex `id'
+// of `g' becomes vertex `id - first + 1' of the new dag.
+dag *dag_subgraph(dag *g, unsigned first, unsigned last);
+
+// returns a new, built dag with the edges of the built dag `g'
+// reversed, or NULL on failure. Vertex `id' of `g' becomes vertex
+// `dag_size(g) - 1 - id', which keeps ids a topological order and
+// swaps the source and sink. Every schedule of one, run backwards in
+// time, is a schedule of the other of the same length.
+dag *dag_reverse(dag *g);
+
 #endif // DAG_H
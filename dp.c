@@ -0,0 +1,425 @@
+#include <assert.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dp.h"
+#include "profile.h"
+#include "vector.h"
+
+// labels expanded between checks of the time and the cancel flag
+#define DP_POLL (1 << 10)
+
+// the end of a list of labels, and the parent of the first step
+#define NONE UINT32_MAX
+
+// how a label was reached: the step of the label it was expanded
+// from, and the task added
+typedef struct dpstep {
+    uint32_t parent;
+    uint32_t task;
+} dpstep;
+
+DECLARE_VECTOR(step_vec, dpstep);
+DEFINE_VECTOR(step_vec, dpstep);
+
+// a label of a downset
+typedef struct dplabel {
+    uint32_t step;
+    // the downset's next label, or NONE
+    uint32_t next;
+    // where the label's times start in the layer's pool: the machines'
+    // free times in increasing order, then the earliest start of each
+    // task outside the downset with a predecessor in it, as far as
+    // those predecessors go, in id order
+    size_t times;
+} dplabel;
+
+DECLARE_VECTOR(label_vec, dplabel);
+DEFINE_VECTOR(label_vec, dplabel);
+
+// the downsets of one size and their labels
+typedef struct dplayer {
+    // an open addressing table of the downsets, where 0 marks a free
+    // slot as every downset holds the source, and the first label of
+    // each
+    uint64_t *sets;
+    uint32_t *heads;
+    size_t cap;
+    size_t count;
+    label_vec labels;
+    idx_vec pool;
+} dplayer;
+
+// the state of one dp_solve call
+typedef struct dpctx {
+    unsigned m;
+    size_t size;
+    uint64_t all;
+    // the predecessors and successors of each task as bitmasks
+    uint64_t *preds;
+    uint64_t *succs;
+    unsigned *weights;
+    unsigned *levels;
+    unsigned long long work;
+    const dplimits *limits;
+    profile *p;
+    step_vec steps;
+    // the shortest complete schedule found, or the bound to beat, and
+    // the step that ends it
+    unsigned best;
+    uint32_t best_step;
+    unsigned long expanded;
+} dpctx;
+
+static int layer_init(dplayer *l) {
+    l->cap = 1 << 10;
+    l->count = 0;
+    l->sets = calloc(l->cap, sizeof(*l->sets));
+    l->heads = malloc(l->cap * sizeof(*l->heads));
+    int err = label_vec_init(&l->labels, l->cap);
+    err |= idx_vec_init(&l->pool, l->cap);
+    return (l->sets == NULL || l->heads == NULL || err != 0) ? -1 : 0;
+}
+
+static void layer_destroy(dplayer *l) {
+    free(l->sets);
+    free(l->heads);
+    label_vec_destroy(&l->labels);
+    idx_vec_destroy(&l->pool);
+}
+
+static void layer_clear(dplayer *l) {
+    memset(l->sets, 0, l->cap * sizeof(*l->sets));
+    l->count = 0;
+    l->labels.size = 0;
+    l->pool.size = 0;
+}
+
+// returns the slot of `set' in the table, or the free slot it would
+// take.
+static size_t layer_find(const dplayer *l, uint64_t set) {
+    uint64_t hash = set * 0x9e3779b97f4a7c15ull;
+    size_t i = (hash ^ (hash >> 29)) & (l->cap - 1);
+    while (l->sets[i] != 0 && l->sets[i] != set) {
+        i = (i + 1) & (l->cap - 1);
+    }
+    return i;
+}
+
+// doubles the table. Returns 0 on success and -1 on failure.
+static int layer_grow(dplayer *l) {
+    dplayer old = *l;
+    l->cap *= 2;
+    l->sets = calloc(l->cap, sizeof(*l->sets));
+    l->heads = malloc(l->cap * sizeof(*l->heads));
+    if (l->sets == NULL || l->heads == NULL) {
+        free(l->sets);
+        free(l->heads);
+        l->sets = old.sets;
+        l->heads = old.heads;
+        l->cap = old.cap;
+        return -1;
+    }
+    for (size_t i = 0; i < old.cap; i++) {
+        if (old.sets[i] != 0) {
+            size_t slot = layer_find(l, old.sets[i]);
+            l->sets[slot] = old.sets[i];
+            l->heads[slot] = old.heads[i];
+        }
+    }
+    free(old.sets);
+    free(old.heads);
+    return 0;
+}
+
+// adds the label `times', of `len' entries, to downset `set', unless
+// one of its labels is no later in every entry. Drops the labels the
+// new one beats. Returns 0 on success, -1 on failure and -3 if there
+// are too many labels.
+static int insert(dpctx *ctx, dplayer *l, uint64_t set,
+                  const unsigned *times, size_t len, uint32_t parent,
+                  unsigned task) {
+    size_t slot = layer_find(l, set);
+    if (l->sets[slot] == 0) {
+        if (2 * (l->count + 1) > l->cap) {
+            if (layer_grow(l) != 0) {
+                return -1;
+            }
+            slot = layer_find(l, set);
+        }
+        l->sets[slot] = set;
+        l->heads[slot] = NONE;
+        l->count++;
+    }
+    for (uint32_t *link = &l->heads[slot]; *link != NONE;) {
+        dplabel *other = &l->labels.data[*link];
+        const unsigned *o = &l->pool.data[other->times];
+        int no_later = 1;
+        int no_earlier = 1;
+        for (size_t i = 0; i < len && (no_later || no_earlier); i++) {
+            no_later &= o[i] <= times[i];
+            no_earlier &= o[i] >= times[i];
+        }
+        if (no_later) {
+            return 0;
+        }
+        if (no_earlier) {
+            *link = other->next;
+        }
+        else {
+            link = &other->next;
+        }
+    }
+    if (ctx->steps.size >= ctx->limits->max_labels) {
+        return -3;
+    }
+    dpstep step = {.parent = parent, .task = task};
+    dplabel label = {
+        .step = ctx->steps.size,
+        .next = l->heads[slot],
+        .times = l->pool.size,
+    };
+    if (step_vec_push(&ctx->steps, step) != 0) {
+        return -1;
+    }
+    l->heads[slot] = l->labels.size;
+    if (label_vec_push(&l->labels, label) != 0) {
+        return -1;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (idx_vec_push(&l->pool, times[i]) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// runs task `t' after the label `times' of downset `set', whose
+// tasks take `work' in total and after which the tasks in `waiting'
+// can start at `release', and adds the result to `to' unless it cannot
+// beat the best schedule. Returns 0 on success, -1 on failure and -3
+// if there are too many labels.
+static int expand_task(dpctx *ctx, dplayer *to, uint64_t set,
+                       unsigned long long work, uint64_t waiting,
+                       const unsigned *times, const unsigned *release,
+                       uint32_t step, unsigned t) {
+    unsigned m = ctx->m;
+    profile_set_times(ctx->p, times);
+    unsigned end = profile_place(ctx->p, release[t], ctx->weights[t]) +
+        ctx->weights[t];
+    uint64_t next = set | (1ull << t);
+    unsigned child[m + DP_MAX_SIZE];
+    profile_times(ctx->p, child);
+    // the latest machine, the work left over all machines, and every
+    // path that is left
+    unsigned bound = child[m - 1];
+    unsigned long long left = ctx->work - work - ctx->weights[t];
+    unsigned spread = (profile_load(ctx->p) + left + m - 1) / m;
+    bound = (spread > bound) ? spread : bound;
+    for (uint64_t rest = ctx->all & ~next; rest != 0; rest &= rest - 1) {
+        unsigned path = child[0] + ctx->levels[__builtin_ctzll(rest)];
+        bound = (path > bound) ? path : bound;
+    }
+    size_t len = m;
+    unsigned first_release = UINT_MAX;
+    uint64_t next_waiting = (waiting | ctx->succs[t]) & ~next;
+    for (uint64_t rest = next_waiting; rest != 0; rest &= rest - 1) {
+        unsigned i = __builtin_ctzll(rest);
+        unsigned r = (waiting & (1ull << i)) ? release[i] : 0;
+        if ((ctx->succs[t] & (1ull << i)) && end > r) {
+            r = end;
+        }
+        unsigned path = r + ctx->levels[i];
+        bound = (path > bound) ? path : bound;
+        first_release = (r < first_release) ? r : first_release;
+        child[len++] = r;
+    }
+    if (bound >= ctx->best) {
+        return 0;
+    }
+    if (next == ctx->all) {
+        if (ctx->steps.size >= ctx->limits->max_labels) {
+            return -3;
+        }
+        dpstep last = {.parent = step, .task = t};
+        if (step_vec_push(&ctx->steps, last) != 0) {
+            return -1;
+        }
+        ctx->best = bound;
+        ctx->best_step = ctx->steps.size - 1;
+        return 0;
+    }
+    // every task left waits for a machine and, through its own
+    // predecessors if need be, for a task of the downset, so none
+    // starts before `floor' and earlier times all act like it. Raising
+    // them lets more labels match.
+    unsigned floor = (first_release > child[0]) ? first_release : child[0];
+    for (size_t i = 0; i < len; i++) {
+        child[i] = (child[i] < floor) ? floor : child[i];
+    }
+    return insert(ctx, to, next, child, len, step, t);
+}
+
+// expands every label of `from' by every task that can run next into
+// `to'. Returns 0 on success, -1 on failure, -2 on time out and -3 if
+// there are too many labels.
+static int expand(dpctx *ctx, dplayer *from, dplayer *to) {
+    const dplimits *limits = ctx->limits;
+    unsigned release[DP_MAX_SIZE];
+    for (size_t slot = 0; slot < from->cap; slot++) {
+        uint64_t set = from->sets[slot];
+        if (set == 0) {
+            continue;
+        }
+        // the tasks outside the downset with a predecessor in it, and
+        // those whose predecessors are all in it
+        uint64_t waiting = 0;
+        unsigned long long work = 0;
+        for (uint64_t rest = set; rest != 0; rest &= rest - 1) {
+            unsigned i = __builtin_ctzll(rest);
+            work += ctx->weights[i];
+            waiting |= ctx->succs[i];
+        }
+        waiting &= ~set;
+        uint64_t ready = 0;
+        for (uint64_t rest = waiting; rest != 0; rest &= rest - 1) {
+            unsigned i = __builtin_ctzll(rest);
+            if ((ctx->preds[i] & ~set) == 0) {
+                ready |= 1ull << i;
+            }
+        }
+        for (uint32_t l = from->heads[slot]; l != NONE;
+             l = from->labels.data[l].next) {
+            if (++ctx->expanded % DP_POLL == 0 &&
+                ((limits->do_timeout && clock() >= limits->end_time) ||
+                 (limits->cancel != NULL &&
+                  atomic_load_explicit(limits->cancel,
+                                       memory_order_relaxed)))) {
+                return -2;
+            }
+            const dplabel *label = &from->labels.data[l];
+            const unsigned *times = &from->pool.data[label->times];
+            size_t j = ctx->m;
+            for (uint64_t rest = waiting; rest != 0; rest &= rest - 1) {
+                release[__builtin_ctzll(rest)] = times[j++];
+            }
+            for (uint64_t rest = ready; rest != 0; rest &= rest - 1) {
+                int err = expand_task(ctx, to, set, work, waiting, times,
+                                      release, label->step,
+                                      __builtin_ctzll(rest));
+                if (err != 0) {
+                    return err;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+// fills the context's masks, weights and levels. Returns 0 on success
+// and -1 on failure.
+static int ctx_init(dpctx *ctx, dag *g) {
+    size_t size = ctx->size;
+    ctx->preds = calloc(2 * size, sizeof(*ctx->preds));
+    ctx->weights = malloc(2 * size * sizeof(*ctx->weights));
+    if (ctx->preds == NULL || ctx->weights == NULL) {
+        return -1;
+    }
+    ctx->succs = ctx->preds + size;
+    ctx->levels = ctx->weights + size;
+    unsigned buf[size];
+    for (unsigned i = 0; i < size; i++) {
+        size_t npreds = dag_npreds(g, i);
+        dag_preds(g, i, buf);
+        for (size_t j = 0; j < npreds; j++) {
+            ctx->preds[i] |= 1ull << buf[j];
+            ctx->succs[buf[j]] |= 1ull << i;
+        }
+        ctx->weights[i] = dag_weight(g, i);
+        ctx->levels[i] = dag_level(g, i);
+        ctx->work += ctx->weights[i];
+    }
+    return 0;
+}
+
+// runs the program for schedules shorter than ctx->best, one layer of
+// downsets after another in `layers'. Returns 0 on success, -1 on
+// failure, -2 on time out and -3 if there are too many labels.
+static int run(dpctx *ctx, dplayer *layers) {
+    // the source runs first, at time 0 on any machine, and its
+    // successors can start at once
+    unsigned source = 0;
+    unsigned first[ctx->m + DP_MAX_SIZE];
+    memset(first, 0, sizeof(first));
+    int err = insert(ctx, &layers[0], 1ull << source, first,
+                     ctx->m + __builtin_popcountll(ctx->succs[source]),
+                     NONE, source);
+    dplayer *from = &layers[0];
+    dplayer *to = &layers[1];
+    for (size_t k = 1; err == 0 && k < ctx->size && from->count > 0; k++) {
+        layer_clear(to);
+        err = expand(ctx, from, to);
+        dplayer *done = from;
+        from = to;
+        to = done;
+    }
+    return err;
+}
+
+int dp_solve(dag *g, unsigned m, unsigned upper, const dplimits *limits,
+             unsigned *order, unsigned long *labels) {
+    assert(g != NULL);
+    assert(m > 0);
+    assert(limits != NULL);
+    assert(order != NULL);
+    size_t size = dag_size(g);
+    assert(size >= 2 && size <= DP_MAX_SIZE);
+    assert(dag_source(g) == 0);
+    dpctx ctx = {
+        .m = m,
+        .size = size,
+        .all = (size == 64) ? ~0ull : (1ull << size) - 1,
+        .limits = limits,
+        .p = profile_create(m),
+        .best = upper,
+        .best_step = NONE,
+    };
+    dplayer layers[2];
+    int result = -1;
+    int err = ctx_init(&ctx, g);
+    err |= step_vec_init(&ctx.steps, 1 << 10);
+    err |= layer_init(&layers[0]);
+    err |= layer_init(&layers[1]);
+    if (err != 0 || ctx.p == NULL) {
+        goto out;
+    }
+    if ((result = run(&ctx, layers)) != 0) {
+        goto out;
+    }
+    result = upper;
+    if (ctx.best_step != NONE) {
+        size_t i = size;
+        for (uint32_t s = ctx.best_step; s != NONE;
+             s = ctx.steps.data[s].parent) {
+            assert(i > 0);
+            order[--i] = ctx.steps.data[s].task;
+        }
+        assert(i == 0);
+        result = ctx.best;
+    }
+ out:
+    if (labels != NULL) {
+        *labels += ctx.expanded;
+    }
+    free(ctx.preds);
+    free(ctx.weights);
+    if (ctx.p != NULL) {
+        profile_destroy(ctx.p);
+    }
+    step_vec_destroy(&ctx.steps);
+    layer_destroy(&layers[0]);
+    layer_destroy(&layers[1]);
+    return result;
+}
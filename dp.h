@@ -0,0 +1,48 @@
+#ifndef DP_H
+#define DP_H
+
+#include <stdatomic.h>
+#include <time.h>
+
+#include "dag.h"
+
+// An exact solver for small dags by dynamic programming over the sets
+// of tasks a schedule can start with: the downsets, or order ideals,
+// of the dag. Every order passes through a chain of downsets, one task
+// at a time, and what its remaining tasks can achieve only depends on
+// the machines' free times and on how early each task outside the
+// downset can start as far as its predecessors in it go. These times
+// make up a label.
+// A downset keeps only the labels that no other label of it beats in
+// every time, so orders that differ in ways that cannot matter later
+// are merged, and those that cannot beat the incumbent are dropped.
+// The downsets of one size are expanded together, in a hash table
+// keyed by their bitmask.
+
+// dags with at most this many vertices, source and sink included, fit
+// the bitmasks of dp_solve
+#define DP_MAX_SIZE (64)
+
+// when dp_solve gives up
+typedef struct dplimits {
+    // the processor time to stop at, if `do_timeout' is set
+    int do_timeout;
+    clock_t end_time;
+    // set by another thread to stop as if timed out, or NULL
+    atomic_int *cancel;
+    // the most labels to create before giving up
+    size_t max_labels;
+} dplimits;
+
+// finds the shortest schedule of `g', of at most DP_MAX_SIZE vertices,
+// on `m' machines, among those shorter than `upper'. Labels that cannot
+// beat `upper' are dropped, so a tight one keeps them few. If there is
+// a schedule, stores its order, dag_size(g) tasks starting with the
+// source, in `order' and returns its length. Returns `upper' if there
+// is none, -1 on failure, -2 on time out and -3 if it would take more
+// than limits->max_labels labels. If `labels' is not NULL, the number
+// of labels expanded is added to it.
+int dp_solve(dag *g, unsigned m, unsigned upper, const dplimits *limits,
+             unsigned *order, unsigned long *labels);
+
+#endif // DP_H
@@ -1,19 +1,18 @@
+import importlib
+import re
 import subprocess
 import sys
+import tempfile
 
 n_dags = 30
 small_machines = [4,8,16]
 timeout = 60
-bounds = {"Fujita": [],
-          "Fernandez": ["FB=1"]}
-
-def make_clean():
-    clean = subprocess.run(["make", "clean"],
-                           stdout=subprocess.DEVNULL,
-                           stderr=subprocess.DEVNULL)
-    if clean.returncode != 0:
-        print("make clean failed")
-        sys.exit(1)
+# a directory to keep results in across runs, as for bbexps --cache, or
+# None to solve everything afresh
+cache = None
+# both bounds run from one build, chosen per solve
+bounds = {"Fujita": "cheap,fujita",
+          "Fernandez": "cheap,fernandez"}
 
 def make(args=[]):
     make = subprocess.run(["make"] + args,
@@ -24,48 +23,179 @@ def make(args=[]):
         print("make failed")
         sys.exit(1)
 
-def bbexps(path, m, t):
-    result = subprocess.run(
-        ["./bbexps", path, str(m), str(t)],
-        stdout=subprocess.PIPE,
-        encoding="utf-8")
-    return result
+# the in-process solver, loaded once the library is built
+bbsched = None
+
+def load_solver():
+    global bbsched
+    if bbsched is None:
+        make(["libbbsched.so"])
+        bbsched = importlib.import_module("bbsched")
+    return bbsched
 
+def result_line(path, dag, m, result):
+    # the output line of bbexps: file, # nodes, m, schedule length,
+    # scheduling time
+    return "{}, {}, {}, {}, {:f}".format(path, len(dag), m,
+                                         result.makespan, result.seconds)
 
 def runSmall():
+    load_solver()
     n_dags = 30
     machines = [4,8,16]
     timeout_skip = 12
     sizes = list(range(12,26))
     for bound in bounds:
-        make_clean()
-        make(bounds[bound])
         for size in sizes:
-            for m in machines:
-                n_timeouts = 0
-                for dag in range(n_dags):
-                    path = "series/data{}01/Pat{}.rcp".format(size, dag)
-                    result = bbexps(path, m, timeout)
-                    print("{}, {}".format(result.stdout[:-1], bound))
-                    if "-2" in result.stdout:
-                        n_timeouts += 1
-                    else:
-                        n_timeouts = 0
-                    if n_timeouts >= timeout_skip:
-                        break
+            # consecutive time outs per number of machines
+            n_timeouts = {m: 0 for m in machines}
+            for dag_id in range(n_dags):
+                path = "series/data{}01/Pat{}.rcp".format(size, dag_id)
+                with bbsched.Dag.load(path) as dag:
+                    for m in machines:
+                        if n_timeouts[m] >= timeout_skip:
+                            continue
+                        result = dag.solve(m, timeout, bounds=bounds[bound],
+                                           cache=cache)
+                        line = result_line(path, dag, m, result)
+                        print("{}, {}".format(line, bound))
+                        if result.makespan == -2:
+                            n_timeouts[m] += 1
+                        else:
+                            n_timeouts[m] = 0
 
 def runLarge():
+    load_solver()
     n_dags = 16
     machines = [24, 28, 32, 36, 40]
     for bound in bounds:
-        make_clean()
-        make(bounds[bound])
         for size in range(100, 155, 5):
+            for dag_id in range(n_dags):
+                path = "large_data/data{}01/Pat{}.rcp".format(size, dag_id)
+                with bbsched.Dag.load(path) as dag:
+                    for m in machines:
+                        result = dag.solve(m, timeout, bounds=bounds[bound],
+                                           cache=cache)
+                        line = result_line(path, dag, m, result)
+                        print("{}, {}".format(line, bound))
+
+def runMachines():
+    # scaling in the number of machines, far past the width of the DAGs
+    load_solver()
+    n_dags = 4
+    machines = [24, 40, 100, 250, 500, 1000]
+    for dag_id in range(n_dags):
+        path = "large_data/data15001/Pat{}.rcp".format(dag_id)
+        with bbsched.Dag.load(path) as dag:
             for m in machines:
-                for dag in range(n_dags):
-                    path = "large_data/data{}01/Pat{}.rcp".format(size, dag)
-                    result = bbexps(path, m, timeout)
-                    print("{}, {}".format(result.stdout[:-1], bound))
+                result = dag.solve(m, timeout, cache=cache)
+                print("{}, Fujita".format(result_line(path, dag, m, result)))
+
+datasets = {"series": ["series/data{}01/Pat{}.rcp".format(size, dag)
+                       for size in range(12, 26) for dag in range(30)],
+            "large_data": ["large_data/data{}01/Pat{}.rcp".format(size, dag)
+                           for size in range(100, 155, 5)
+                           for dag in range(16)]}
+dataset_machines = {"series": [4, 8, 16], "large_data": [24, 40]}
+
+def runClosures():
+    # how often each shortcut closes a solve
+    load_solver()
+    closures = ["width_closed", "path_closed", "root_closed", "gap_closed",
+                "dp_closed"]
+    for name in datasets:
+        machines = dataset_machines[name]
+        tally = {m: {key: 0 for key in closures} for m in machines}
+        for path in datasets[name]:
+            with bbsched.Dag.load(path) as dag:
+                for m in machines:
+                    result = dag.solve(m, timeout, cache=cache)
+                    for key in closures:
+                        tally[m][key] += getattr(result, key)
+        for m in machines:
+            for key in closures:
+                print("{}, {}, {}, {}, {}".format(name, m, len(datasets[name]),
+                                                  key, tally[m][key]))
+
+def runBranching():
+    # search nodes and times of each branching order
+    load_solver()
+    policies = ["level", "weight", "succs", "slack", "bound"]
+    for name in datasets:
+        for path in datasets[name]:
+            with bbsched.Dag.load(path) as dag:
+                for m in dataset_machines[name]:
+                    for policy in policies:
+                        result = dag.solve(m, timeout, branch=policy,
+                                           cache=cache)
+                        print("{}, {}, {}".format(
+                            result_line(path, dag, m, result), policy,
+                            result.nodes))
+
+# what runTuning compares, as the options of a rule of bbexps --rules,
+# and the buckets of features it picks one for
+tuning_configs = ["search=dfs dp=1", "search=dfs dp=0",
+                  "search=dfs bounds=cheap,fernandez dp=0", "search=lds",
+                  "search=lds threads=3", "engine=heuristic"]
+tuning_sizes = ["..62", "63..199", "200..999", "1000.."]
+tuning_strengths = ["..0.5", "0.5..0.8", "0.8.."]
+
+def in_range(value, text):
+    lo, hi = text.split("..")
+    return (lo == "" or value >= float(lo)) and (hi == "" or value <= float(hi))
+
+def runTuning():
+    # solves every instance with each configuration through a one rule
+    # table, and prints the table that picks the configuration proving
+    # the most optima, then scheduling the most, then the fastest, in
+    # each bucket of size and order strength
+    make(["bbexps"])
+    scores = {}
+    for name in datasets:
+        for path in datasets[name]:
+            for m in dataset_machines[name]:
+                for config in tuning_configs:
+                    with tempfile.NamedTemporaryFile("w") as rules:
+                        rules.write(config + "\n")
+                        rules.flush()
+                        run = subprocess.run(
+                            ["./bbexps", path, str(m), str(timeout),
+                             "--rules", rules.name, "--threads", "3"],
+                            stdout=subprocess.PIPE, stderr=subprocess.PIPE,
+                            encoding="utf-8")
+                    log = re.search(r"auto: n (\d+), width (\d+), "
+                                    r"order strength ([\d.]+), "
+                                    r"m/width ([\d.]+)", run.stderr)
+                    fields = run.stdout.strip().split(", ")
+                    if log is None or len(fields) < 5:
+                        continue
+                    n, strength, ratio = (int(log.group(1)),
+                                          float(log.group(3)),
+                                          float(log.group(4)))
+                    if ratio >= 1:
+                        # the width shortcut closes these anyway
+                        continue
+                    makespan = int(fields[3])
+                    # a list schedule is only proved optimal by the bound
+                    proved = makespan >= 0 and (len(fields) < 7 or
+                                                float(fields[6]) == 0)
+                    bucket = next((size, band) for size in tuning_sizes
+                                  for band in tuning_strengths
+                                  if in_range(n, size) and
+                                  in_range(strength, band))
+                    score = scores.setdefault(bucket, {}).setdefault(
+                        config, [0, 0, 0.0])
+                    score[0] += proved
+                    score[1] += makespan >= 0
+                    score[2] -= float(fields[4])
+    print("ratio=1..")
+    for size in tuning_sizes:
+        for band in tuning_strengths:
+            if (size, band) in scores:
+                results = scores[(size, band)]
+                best = max(results, key=lambda config: results[config])
+                print("n={} strength={} {}".format(size, band, best))
+    print(tuning_configs[0])
 
 def main():
     runLarge()
@@ -0,0 +1,153 @@
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vector.h"
+#include "gen.h"
+
+void genopts_init(genopts *opts) {
+    assert(opts != NULL);
+    opts->n = 100;
+    opts->width = 10;
+    opts->density = 0.2;
+    opts->min_weight = 1;
+    opts->max_weight = 10;
+    opts->seed = 1;
+}
+
+size_t gen_width(size_t n, double os) {
+    if (n <= 1 || os >= 1) {
+        return 1;
+    }
+    if (os <= 0) {
+        return n;
+    }
+    // with a path between every pair of tasks in different layers,
+    // only the pairs within a layer are unordered: about
+    // n (width - 1) / 2 of the n (n - 1) / 2 pairs
+    size_t width = (size_t) (1 + (1 - os) * (n - 1) + 0.5);
+    return (width > n) ? n : width;
+}
+
+// splitmix64, which is fast and passes the usual statistical tests.
+static uint64_t next_rand(uint64_t *state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// returns a uniform random number in (0, 1].
+static double next_unit(uint64_t *state) {
+    return ((next_rand(state) >> 11) + 1) * 0x1.0p-53;
+}
+
+// returns the number of failed trials before the next success, at most
+// `limit', where `scale' is 1 / log(1 - p) for success probability p.
+// Drawing the gaps between edges this way takes time linear in the
+// number of edges rather than in the number of candidate pairs.
+static size_t next_skip(uint64_t *state, double scale, size_t limit) {
+    if (scale == 0) {
+        return 0;
+    }
+    double skip = log(next_unit(state)) * scale;
+    return (skip < limit) ? (size_t) skip : limit;
+}
+
+int gen_patterson(FILE *f, const genopts *opts) {
+    assert(f != NULL);
+    assert(opts != NULL);
+    assert(opts->width > 0);
+    assert(opts->min_weight <= opts->max_weight);
+    size_t n = opts->n;
+    size_t width = (opts->width < n) ? opts->width : n;
+    unsigned sink = n + 2;
+    uint64_t state = opts->seed;
+    int random_edges = opts->density > 0;
+    double scale = 0;
+    if (random_edges && opts->density < 1) {
+        scale = 1 / log1p(-opts->density);
+    }
+    unsigned nweights = opts->max_weight - opts->min_weight + 1;
+
+    // the predecessor every task of the next layer is guaranteed,
+    // and those tasks bucketed by it in increasing order
+    unsigned *owner = malloc((width + 1) * sizeof(*owner));
+    unsigned *ends = malloc((width + 1) * sizeof(*ends));
+    unsigned *guaranteed = malloc((width + 1) * sizeof(*guaranteed));
+    idx_vec succs;
+    int err = -1;
+    if (owner == NULL || ends == NULL || guaranteed == NULL ||
+        idx_vec_init(&succs, 0) != 0) {
+        goto out1;
+    }
+
+    fprintf(f, "%zu 0\n\n", n + 2);
+    fprintf(f, "0 %zu", (n > 0) ? width : 1);
+    for (size_t i = 0; i < width; i++) {
+        fprintf(f, " %zu", i + 2);
+    }
+    fprintf(f, (n > 0) ? "\n" : " %u\n", sink);
+
+    for (size_t first = 0; first < n; first += width) {
+        size_t len = (n - first < width) ? n - first : width;
+        size_t next = first + len;
+        size_t next_len = (n - next < width) ? n - next : width;
+        memset(ends, 0, (len + 1) * sizeof(*ends));
+        for (size_t y = 0; y < next_len; y++) {
+            owner[y] = next_rand(&state) % len;
+            ends[owner[y] + 1]++;
+        }
+        for (size_t x = 0; x < len; x++) {
+            ends[x + 1] += ends[x];
+        }
+        // placing each task at the start of its bucket leaves ends[x]
+        // at the end of bucket x
+        for (size_t y = 0; y < next_len; y++) {
+            guaranteed[ends[owner[y]]++] = y;
+        }
+
+        for (size_t x = 0; x < len; x++) {
+            succs.size = 0;
+            size_t k = (x > 0) ? ends[x - 1] : 0;
+            size_t r = next_len;
+            if (random_edges) {
+                r = next_skip(&state, scale, next_len);
+            }
+            // merge the random successors with the guaranteed ones
+            while (r < next_len || k < ends[x]) {
+                size_t y = r;
+                if (k < ends[x] && (r >= next_len || guaranteed[k] <= r)) {
+                    y = guaranteed[k++];
+                }
+                if (y == r) {
+                    r += 1 + next_skip(&state, scale, next_len);
+                }
+                if (idx_vec_push(&succs, next + y + 2) != 0) {
+                    goto out2;
+                }
+            }
+            if (succs.size == 0 && idx_vec_push(&succs, sink) != 0) {
+                goto out2;
+            }
+            unsigned weight = opts->min_weight + next_rand(&state) % nweights;
+            fprintf(f, "%u %zu", weight, succs.size);
+            for (size_t i = 0; i < succs.size; i++) {
+                fprintf(f, " %u", succs.data[i]);
+            }
+            fprintf(f, "\n");
+        }
+    }
+    fprintf(f, "0 0\n");
+    err = ferror(f) ? -1 : 0;
+ out2:
+    idx_vec_destroy(&succs);
+ out1:
+    free(owner);
+    free(ends);
+    free(guaranteed);
+    return err;
+}
@@ -0,0 +1,40 @@
+#ifndef GEN_H
+#define GEN_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// parameters of a random layered dag. Tasks are split into layers of
+// `width' consecutive tasks, the last one possibly shorter. Edges only
+// join consecutive layers, and every task after the first layer has at
+// least one predecessor in the layer before it.
+typedef struct genopts {
+    // number of tasks, excluding the source and sink
+    size_t n;
+    size_t width;
+    // probability of each other edge between consecutive layers. With
+    // density 1 every task precedes every task of later layers.
+    double density;
+    // task weights are drawn uniformly from [min_weight, max_weight]
+    unsigned min_weight;
+    unsigned max_weight;
+    unsigned long long seed;
+} genopts;
+
+// fills `opts' with the defaults: 100 tasks in layers of 10, density
+// 0.2, weights from 1 to 10 and seed 1.
+void genopts_init(genopts *opts);
+
+// returns the layer width for which a dag of `n' tasks with density 1
+// has an order strength, the fraction of task pairs joined by a path,
+// of about `os'. Lower densities leave some pairs of layers
+// unordered, which lowers the order strength.
+size_t gen_width(size_t n, double os);
+
+// writes a random dag drawn from `opts' to `f' in Patterson format.
+// Only one layer is held in memory, so the time and memory taken are
+// linear in the number of tasks and edges. The same options always
+// give the same dag. Returns 0 on success and -1 on failure.
+int gen_patterson(FILE *f, const genopts *opts);
+
+#endif // GEN_H
@@ -0,0 +1,187 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "binheap.h"
+#include "dag.h"
+#include "listsched.h"
+#include "vector.h"
+
+static const char *rule_names[N_LIST_RULES] = {
+    [LIST_LEVEL] = "level",
+    [LIST_WEIGHT] = "weight",
+    [LIST_SUCCS] = "succs",
+};
+
+const char *list_rule_name(list_rule rule) {
+    assert(rule < N_LIST_RULES);
+    return rule_names[rule];
+}
+
+int list_rule_parse(const char *name, list_rule *rule) {
+    assert(name != NULL);
+    assert(rule != NULL);
+    for (int i = 0; i < N_LIST_RULES; i++) {
+        if (strcmp(name, rule_names[i]) == 0) {
+            *rule = i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// the state of one list_schedule call
+typedef struct lsctx {
+    dag *g;
+    list_rule rule;
+    // the number of predecessors of each task that have not ended yet
+    unsigned *waiting;
+    // the ready tasks by priority, and the tasks without work that are
+    // ready but not yet done
+    binheap *ready;
+    idx_vec instant;
+    // a buffer for the successors of any task
+    unsigned *succs;
+    unsigned *starts;
+    unsigned *machines;
+} lsctx;
+
+// returns the priority of task `id' under the rule. Higher priorities
+// start first.
+static int priority(lsctx *ctx, unsigned id) {
+    switch (ctx->rule) {
+    case LIST_WEIGHT:
+        return dag_weight(ctx->g, id);
+    case LIST_SUCCS:
+        return dag_nsuccs(ctx->g, id);
+    default:
+        return dag_level(ctx->g, id);
+    }
+}
+
+// ends task `id' at time `now', and readies its successors whose
+// predecessors have all ended. Tasks without work end at once, along
+// with those they ready in turn. Returns 0 on success and -1 on
+// failure.
+static int finish(lsctx *ctx, unsigned id, unsigned now) {
+    if (idx_vec_push(&ctx->instant, id) != 0) {
+        return -1;
+    }
+    while (ctx->instant.size > 0) {
+        idx_vec_pop(&ctx->instant, &id);
+        size_t nsuccs = dag_nsuccs(ctx->g, id);
+        dag_succs(ctx->g, id, ctx->succs);
+        for (size_t i = 0; i < nsuccs; i++) {
+            unsigned succ = ctx->succs[i];
+            if (--ctx->waiting[succ] > 0) {
+                continue;
+            }
+            int err;
+            if (dag_weight(ctx->g, succ) == 0) {
+                ctx->starts[succ] = now;
+                ctx->machines[succ] = 0;
+                err = idx_vec_push(&ctx->instant, succ);
+            }
+            else {
+                err = binheap_put(ctx->ready, succ, priority(ctx, succ));
+            }
+            if (err != 0) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int list_schedule(dag *g, unsigned m, list_rule rule, unsigned *starts,
+                  unsigned *machines) {
+    assert(g != NULL);
+    assert(m > 0);
+    assert(starts != NULL);
+    assert(machines != NULL);
+    size_t size = dag_size(g);
+    size_t max_succs = 0;
+    for (size_t i = 0; i < size; i++) {
+        max_succs = (dag_nsuccs(g, i) > max_succs) ? dag_nsuccs(g, i) :
+            max_succs;
+    }
+    lsctx ctx = {
+        .g = g,
+        .rule = rule,
+        .waiting = malloc(size * sizeof(*ctx.waiting)),
+        .ready = binheap_create(),
+        .succs = malloc((max_succs + 1) * sizeof(*ctx.succs)),
+        .starts = starts,
+        .machines = machines,
+    };
+    // the busy machines by the time they become free, and the idle ones
+    binheap *busy = binheap_create();
+    unsigned *idle = malloc(m * sizeof(*idle));
+    int result = -1;
+    if (idx_vec_init(&ctx.instant, 0) != 0) {
+        goto out;
+    }
+    if (ctx.waiting == NULL || ctx.ready == NULL || ctx.succs == NULL ||
+        busy == NULL || idle == NULL) {
+        goto out_instant;
+    }
+    for (size_t i = 0; i < size; i++) {
+        ctx.waiting[i] = dag_npreds(g, i);
+    }
+    // machine 0 is taken first
+    unsigned nidle = m;
+    for (unsigned i = 0; i < m; i++) {
+        idle[i] = m - 1 - i;
+    }
+    unsigned now = 0;
+    unsigned source = dag_source(g);
+    starts[source] = 0;
+    machines[source] = 0;
+    if (finish(&ctx, source, 0) != 0) {
+        goto out_instant;
+    }
+    while (1) {
+        while (nidle > 0 && binheap_size(ctx.ready) > 0) {
+            unsigned id = binheap_get(ctx.ready);
+            unsigned machine = idle[--nidle];
+            starts[id] = now;
+            machines[id] = machine;
+            if (binheap_put(busy, id, -(int) (now + dag_weight(g, id))) !=
+                0) {
+                goto out_instant;
+            }
+        }
+        if (binheap_size(busy) == 0) {
+            break;
+        }
+        // the next task to end, and every other task that ends with it
+        unsigned next = binheap_peek(busy);
+        now = starts[next] + dag_weight(g, next);
+        do {
+            binheap_get(busy);
+            idle[nidle++] = machines[next];
+            if (finish(&ctx, next, now) != 0) {
+                goto out_instant;
+            }
+            next = binheap_peek(busy);
+        } while (next != (unsigned) -1 &&
+                 starts[next] + dag_weight(g, next) == now);
+    }
+    // every task ran unless the dag has a cycle, which dag_build rules
+    // out
+    assert(binheap_size(ctx.ready) == 0);
+    result = starts[dag_sink(g)];
+ out_instant:
+    idx_vec_destroy(&ctx.instant);
+ out:
+    free(ctx.waiting);
+    if (ctx.ready != NULL) {
+        binheap_destroy(ctx.ready);
+    }
+    free(ctx.succs);
+    if (busy != NULL) {
+        binheap_destroy(busy);
+    }
+    free(idle);
+    return result;
+}
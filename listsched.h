@@ -0,0 +1,40 @@
+#ifndef LISTSCHED_H
+#define LISTSCHED_H
+
+#include "dag.h"
+
+// A list scheduler for dags far too large to search: whenever a
+// machine is free, it starts the ready task that comes first under a
+// priority rule. Time only advances from one task's end to the next,
+// with the ready tasks and the busy machines' free times each in a
+// heap, so a dag of n tasks and e edges takes O((n + e) log n) time
+// and memory linear in n plus m.
+
+// the priority rules of list_schedule. Ties go to either task.
+typedef enum list_rule {
+    // highest level first, the longest path from the task to the sink
+    LIST_LEVEL,
+    // heaviest task first
+    LIST_WEIGHT,
+    // most immediate successors first
+    LIST_SUCCS,
+    N_LIST_RULES
+} list_rule;
+
+// returns the name of the given rule.
+const char *list_rule_name(list_rule rule);
+
+// parses a rule name into `rule'. Returns 0 on success and -1 on an
+// unknown name.
+int list_rule_parse(const char *name, list_rule *rule);
+
+// schedules every task of `g' on `m' machines by the rule, and stores
+// each task's start time and machine in `starts' and `machines', which
+// hold dag_size(g) entries. Tasks without work, such as the source and
+// the sink, start as soon as their predecessors end and take machine
+// 0 without occupying it, as in schedule_verify. Returns the makespan,
+// or -1 on failure.
+int list_schedule(dag *g, unsigned m, list_rule rule, unsigned *starts,
+                  unsigned *machines);
+
+#endif // LISTSCHED_H
@@ -16,59 +16,94 @@ int parse_patterson(const char *fp, dag **ret_g) {
 
     int n_nodes;
     int n_resources;
-    fscanf(f, "%d %d", &n_nodes, &n_resources);
+    if (fscanf(f, "%d %d", &n_nodes, &n_resources) != 2) {
+        fprintf(stderr, "Missing header line\n");
+        fclose(f);
+        return -1;
+    }
 
     if (n_resources != 0) {
         fprintf(stderr, "Resource constrained problems not supported\n");
         fclose(f);
         return -1;
     }
-    if (n_nodes < 0) {
+    if (n_nodes < 2) {
         fprintf(stderr, "Illegal number of vertices specified\n");
         fclose(f);
         return -1;
     }
 
-    unsigned node_lens[n_nodes];
-    idx_vec node_preds[n_nodes];
-    for (size_t i = 0; i < n_nodes; i++) {
-        if (idx_vec_init(&node_preds[i], 0) != 0) {
-            return -1;
+    // generated files can have millions of vertices, too many for the
+    // stack
+    int err = -1;
+    dag *g = NULL;
+    size_t n_init = 0;
+    unsigned *node_lens = malloc(n_nodes * sizeof(*node_lens));
+    idx_vec *node_preds = malloc(n_nodes * sizeof(*node_preds));
+    if (node_lens == NULL || node_preds == NULL) {
+        goto out;
+    }
+    for (; n_init < n_nodes; n_init++) {
+        if (idx_vec_init(&node_preds[n_init], 0) != 0) {
+            goto out;
         }
     }
 
     // read data lines
     for (size_t i = 0; i < n_nodes; i++) {
         int n_succs;
-        fscanf(f, "%d %d", &node_lens[i], &n_succs);
+        if (fscanf(f, "%u %d", &node_lens[i], &n_succs) != 2) {
+            fprintf(stderr, "Missing vertex %zu\n", i + 1);
+            goto out;
+        }
         for (size_t j = 0; j < n_succs; j++) {
             unsigned succ_id;
-            fscanf(f, "%d", &succ_id);
+            if (fscanf(f, "%u", &succ_id) != 1) {
+                fprintf(stderr, "Missing successor of vertex %zu\n", i + 1);
+                goto out;
+            }
             succ_id--;
-            if (succ_id > 0) {
-                idx_vec_push(&node_preds[succ_id], i);
+            // vertex ids must be a topological order
+            if (succ_id <= i || succ_id >= n_nodes) {
+                fprintf(stderr, "Illegal successor %u of vertex %zu\n",
+                        succ_id + 1, i + 1);
+                goto out;
+            }
+            if (idx_vec_push(&node_preds[succ_id], i) != 0) {
+                goto out;
             }
         }
     }
 
-    fclose(f);
-
-    dag *g = dag_create();
+    g = dag_create();
     if (g == NULL) {
-        return -1;
+        goto out;
     }
 
     for (size_t i = 1; i < n_nodes - 1; i++) {
-        dag_vertex(g, node_lens[i], node_preds[i].size, node_preds[i].data);
+        if (dag_vertex(g, node_lens[i], node_preds[i].size,
+                       node_preds[i].data) == (unsigned) -1) {
+            goto out;
+        }
     }
 
-    for (size_t i = 0; i < n_nodes; i++) {
-        idx_vec_destroy(&node_preds[i]);
+    if (dag_build(g) != 0) {
+        goto out;
     }
-
-    dag_build(g);
     *ret_g = g;
-    return 0;
+    g = NULL;
+    err = 0;
+ out:
+    fclose(f);
+    if (g != NULL) {
+        dag_destroy(g);
+    }
+    for (size_t i = 0; i < n_init; i++) {
+        idx_vec_destroy(&node_preds[i]);
+    }
+    free(node_lens);
+    free(node_preds);
+    return err;
 }
 
 void print_dot(dag *g, const char *name) {
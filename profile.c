@@ -0,0 +1,215 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "profile.h"
+
+// profiles with at most this many runs are searched linearly
+#define SCAN_MAX (32)
+
+struct profile {
+    unsigned m;
+    size_t nruns;
+    // runs sorted by increasing time, with distinct times and nonzero
+    // counts. Stored as separate arrays so scans over the times
+    // vectorize.
+    unsigned *times;
+    unsigned *counts;
+    unsigned load;
+};
+
+profile *profile_create(unsigned m) {
+    assert(m > 0);
+    profile *p = malloc(sizeof(*p));
+    if (p == NULL) {
+        return NULL;
+    }
+    // placing a task may briefly need one run more than machines
+    p->times = malloc((m + 1) * sizeof(*p->times));
+    p->counts = malloc((m + 1) * sizeof(*p->counts));
+    if (p->times == NULL || p->counts == NULL) {
+        free(p->times);
+        free(p->counts);
+        free(p);
+        return NULL;
+    }
+    p->m = m;
+    profile_reset(p);
+    return p;
+}
+
+void profile_destroy(profile *p) {
+    assert(p != NULL);
+    free(p->times);
+    free(p->counts);
+    free(p);
+}
+
+void profile_reset(profile *p) {
+    assert(p != NULL);
+    p->nruns = 1;
+    p->times[0] = 0;
+    p->counts[0] = p->m;
+    p->load = 0;
+}
+
+void profile_copy(profile *dst, profile *src) {
+    assert(dst != NULL);
+    assert(src != NULL);
+    assert(dst->m == src->m);
+    memcpy(dst->times, src->times, src->nruns * sizeof(*src->times));
+    memcpy(dst->counts, src->counts, src->nruns * sizeof(*src->counts));
+    dst->nruns = src->nruns;
+    dst->load = src->load;
+}
+
+void profile_times(profile *p, unsigned *times) {
+    assert(p != NULL);
+    assert(times != NULL);
+    for (size_t i = 0; i < p->nruns; i++) {
+        for (unsigned j = 0; j < p->counts[i]; j++) {
+            *times++ = p->times[i];
+        }
+    }
+}
+
+void profile_set_times(profile *p, const unsigned *times) {
+    assert(p != NULL);
+    assert(times != NULL);
+    p->nruns = 0;
+    p->load = 0;
+    for (unsigned i = 0; i < p->m; i++) {
+        assert(i == 0 || times[i - 1] <= times[i]);
+        if (p->nruns > 0 && p->times[p->nruns - 1] == times[i]) {
+            p->counts[p->nruns - 1]++;
+        }
+        else {
+            p->times[p->nruns] = times[i];
+            p->counts[p->nruns++] = 1;
+        }
+        p->load += times[i];
+    }
+}
+
+unsigned profile_m(profile *p) {
+    assert(p != NULL);
+    return p->m;
+}
+
+unsigned profile_earliest(profile *p) {
+    assert(p != NULL);
+    return p->times[0];
+}
+
+unsigned profile_latest(profile *p) {
+    assert(p != NULL);
+    return p->times[p->nruns - 1];
+}
+
+unsigned profile_load(profile *p) {
+    assert(p != NULL);
+    return p->load;
+}
+
+size_t profile_nruns(profile *p) {
+    assert(p != NULL);
+    return p->nruns;
+}
+
+// returns the number of runs with times no later than `t'.
+static size_t count_le(profile *p, unsigned t) {
+    if (p->nruns <= SCAN_MAX) {
+        size_t count = 0;
+        for (size_t i = 0; i < p->nruns; i++) {
+            count += p->times[i] <= t;
+        }
+        return count;
+    }
+    size_t low = 0;
+    size_t high = p->nruns;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (p->times[mid] <= t) {
+            low = mid + 1;
+        }
+        else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+unsigned profile_place(profile *p, unsigned ready, unsigned len) {
+    assert(p != NULL);
+    unsigned start = (ready > p->times[0]) ? ready : p->times[0];
+    unsigned end = start + len;
+    size_t run = count_le(p, start) - 1;
+    p->load += end - p->times[run];
+    if (--p->counts[run] == 0) {
+        memmove(&p->times[run], &p->times[run + 1],
+                (p->nruns - run - 1) * sizeof(*p->times));
+        memmove(&p->counts[run], &p->counts[run + 1],
+                (p->nruns - run - 1) * sizeof(*p->counts));
+        p->nruns--;
+    }
+    size_t pos = count_le(p, end);
+    if (pos > 0 && p->times[pos - 1] == end) {
+        p->counts[pos - 1]++;
+    }
+    else {
+        memmove(&p->times[pos + 1], &p->times[pos],
+                (p->nruns - pos) * sizeof(*p->times));
+        memmove(&p->counts[pos + 1], &p->counts[pos],
+                (p->nruns - pos) * sizeof(*p->counts));
+        p->times[pos] = end;
+        p->counts[pos] = 1;
+        p->nruns++;
+    }
+    return start;
+}
+
+uint64_t profile_hash(profile *p) {
+    assert(p != NULL);
+    // FNV-1a over the runs
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < p->nruns; i++) {
+        hash = (hash ^ p->times[i]) * 1099511628211ULL;
+        hash = (hash ^ p->counts[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+int profile_equal(profile *a, profile *b) {
+    assert(a != NULL);
+    assert(b != NULL);
+    return a->m == b->m && a->nruns == b->nruns &&
+        memcmp(a->times, b->times, a->nruns * sizeof(*a->times)) == 0 &&
+        memcmp(a->counts, b->counts, a->nruns * sizeof(*a->counts)) == 0;
+}
+
+int profile_dominates(profile *a, profile *b) {
+    assert(a != NULL);
+    assert(b != NULL);
+    assert(a->m == b->m);
+    // walk both sorted sequences of free times machine by machine
+    size_t i = 0;
+    size_t j = 0;
+    unsigned left_a = a->counts[0];
+    unsigned left_b = b->counts[0];
+    while (i < a->nruns) {
+        if (a->times[i] > b->times[j]) {
+            return 0;
+        }
+        unsigned step = (left_a < left_b) ? left_a : left_b;
+        left_a -= step;
+        left_b -= step;
+        if (left_a == 0 && ++i < a->nruns) {
+            left_a = a->counts[i];
+        }
+        if (left_b == 0 && ++j < b->nruns) {
+            left_b = b->counts[j];
+        }
+    }
+    return 1;
+}
@@ -0,0 +1,69 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+// The availability of a set of identical machines: the times at which
+// each machine becomes free, as runs of (time, number of machines)
+// sorted by time. Machines are interchangeable, so two profiles that
+// describe the same multiset of times are identical, and can be hashed
+// and compared directly.
+struct profile;
+typedef struct profile profile;
+
+// create a profile of `m' machines that are all free at time 0, or
+// return NULL on failure.
+profile *profile_create(unsigned m);
+
+// clean up resources associated with the profile.
+void profile_destroy(profile *p);
+
+// make all machines free at time 0 again.
+void profile_reset(profile *p);
+
+// copy the contents of `src' into `dst', which must have the same
+// number of machines.
+void profile_copy(profile *dst, profile *src);
+
+// store the free times of the machines in `times', one per machine
+// in increasing order.
+void profile_times(profile *p, unsigned *times);
+
+// make the machines free at the given times, one per machine in
+// increasing order.
+void profile_set_times(profile *p, const unsigned *times);
+
+unsigned profile_m(profile *p);
+
+// returns the time at which the first machine becomes free.
+unsigned profile_earliest(profile *p);
+
+// returns the time at which the last machine becomes free.
+unsigned profile_latest(profile *p);
+
+// returns the sum of the times at which the machines become free.
+unsigned profile_load(profile *p);
+
+// returns the number of distinct free times.
+size_t profile_nruns(profile *p);
+
+// run a task of length `len' that cannot start before `ready' on the
+// machine that becomes free last at or before the time the task can
+// start, keeping earlier machines free for other tasks. Returns the
+// task's start time. The machine is found with a binary search over
+// the runs, or a vectorizable scan when there are only a few.
+unsigned profile_place(profile *p, unsigned ready, unsigned len);
+
+// returns a hash of the profile's free times.
+uint64_t profile_hash(profile *p);
+
+// returns 1 if the profiles hold the same free times, 0 otherwise.
+int profile_equal(profile *a, profile *b);
+
+// returns 1 if, with both profiles' free times sorted, each of `a's
+// is no later than the corresponding one of `b', 0 otherwise. Any task
+// sequence then finishes no later on `a' than on `b'.
+int profile_dominates(profile *a, profile *b);
+
+#endif // PROFILE_H
@@ -1,12 +1,14 @@
 #include <assert.h>
 #include <limits.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
 #include "vector.h"
 #include "bitmap.h"
-#include "binheap.h"
+#include "bucketq.h"
+#include "profile.h"
 #include "schedule.h"
 
 struct schedule {
@@ -14,11 +16,61 @@ struct schedule {
     bitmap* contents;
     dag *g;
     unsigned m;
+    // when each machine becomes free, as of the last schedule_build,
+    // and a copy of it to try out placements on
+    profile *machines;
+    profile *scratch;
     unsigned length;
+    // sum of the machines' end times and of the scheduled weights
+    unsigned load;
+    unsigned work;
+    unsigned total_work;
     unsigned *max_starts;
     unsigned *min_ends;
+    // when each scheduled task ends, as of the last schedule_build
+    unsigned *ends;
+    // if zero, schedule_build leaves max_starts and min_ends alone
+    int windows;
+    // the max_start and min_end times and weights of all tasks in 16
+    // bits, padded with empty windows to `pack_cap' tasks, the size of
+    // a density variant. Chosen once by dag size; NULL and 0 if the dag
+    // is too large for any variant.
+    int16_t *pack;
+    size_t pack_cap;
 };
 
+// defines NAME, which returns the work of CAP packed time windows that
+// must run between times `ci' and `cj', see work_density. Since the trip
+// count is a constant and the windows are 16 bits wide, the compiler
+// unrolls and vectorizes the loop without a remainder. Padding
+// windows, and windows that miss [ci, cj), have a case below 1 and
+// add nothing.
+#define DEFINE_DENSITY(NAME, CAP)                                       \
+    static int NAME(const int16_t *restrict starts,                     \
+                    const int16_t *restrict ends,                       \
+                    const int16_t *restrict weights,                    \
+                    int16_t ci, int16_t cj) {                           \
+        int16_t len = cj - ci;                                          \
+        int density = 0;                                                \
+        for (size_t k = 0; k < (CAP); k++) {                            \
+            int16_t case1 = ends[k] - ci;                               \
+            int16_t case3 = cj - starts[k];                             \
+            int16_t min1 = (case1 < weights[k]) ? case1 : weights[k];   \
+            int16_t min2 = (case3 < len) ? case3 : len;                 \
+            int16_t d = (min1 < min2) ? min1 : min2;                    \
+            density += (d > 0) ? d : 0;                                 \
+        }                                                               \
+        return density;                                                 \
+    }
+
+DEFINE_DENSITY(density_64, 64)
+DEFINE_DENSITY(density_128, 128)
+DEFINE_DENSITY(density_256, 256)
+
+// the dag sizes with a density variant, smallest first. work_density
+// switches on them, so each call site inlines its variant.
+static const size_t density_caps[] = { 64, 128, 256 };
+
 schedule *schedule_create(dag *g, unsigned m) {
     assert(g != NULL);
     assert(m > 0);
@@ -33,21 +85,67 @@ schedule *schedule_create(dag *g, unsigned m) {
     s->contents = bitmap_create(0);
     if (s->contents == NULL) {
         idx_vec_destroy(&s->order);
+        free(s);
+        return NULL;
+    }
+    s->machines = profile_create(m);
+    s->scratch = profile_create(m);
+    s->ends = malloc(dag_size(g) * sizeof(*s->ends));
+    if (s->machines == NULL || s->scratch == NULL || s->ends == NULL) {
+        if (s->machines != NULL) {
+            profile_destroy(s->machines);
+        }
+        if (s->scratch != NULL) {
+            profile_destroy(s->scratch);
+        }
+        free(s->ends);
+        bitmap_destroy(s->contents);
+        idx_vec_destroy(&s->order);
+        free(s);
         return NULL;
     }
     s->g = g;
     s->m = m;
     s->length = 0;
+    s->load = 0;
+    s->work = 0;
+    s->total_work = 0;
+    for (size_t i = 0, size = dag_size(g); i < size; i++) {
+        s->total_work += dag_weight(g, i);
+    }
     s->max_starts = NULL;
     s->min_ends = NULL;
+    s->pack = NULL;
+    s->windows = 1;
+    s->pack_cap = 0;
+    size_t nvariants = sizeof(density_caps) / sizeof(*density_caps);
+    for (size_t i = 0; i < nvariants; i++) {
+        if (dag_size(g) <= density_caps[i]) {
+            s->pack_cap = density_caps[i];
+            break;
+        }
+    }
+    // without a variant the bounds use the general loop
+    if (s->pack_cap > 0) {
+        s->pack = malloc(3 * s->pack_cap * sizeof(*s->pack));
+        if (s->pack == NULL) {
+            schedule_destroy(s);
+            return NULL;
+        }
+    }
     return s;
 }
 
 void schedule_destroy(schedule *s) {
     assert(s != NULL);
     idx_vec_destroy(&s->order);
+    bitmap_destroy(s->contents);
+    profile_destroy(s->machines);
+    profile_destroy(s->scratch);
     free(s->max_starts);
     free(s->min_ends);
+    free(s->ends);
+    free(s->pack);
     free(s);
 }
 
@@ -130,181 +228,187 @@ int schedule_is_valid(schedule *s) {
 static int schedule_compute(schedule *s, unsigned *task_ends) {
     assert(s != NULL);
     assert(task_ends != NULL);
-    unsigned assignments[dag_size(s->g)];
-    unsigned end_times[s->m];
-    unsigned cur_items[s->m];
     memset(task_ends, 0, schedule_size(s) * sizeof(*task_ends));
-    memset(assignments, -1, dag_size(s->g) * sizeof(*assignments));
-    memset(end_times, 0, s->m * sizeof(unsigned));
-    memset(cur_items, 0, s->m * sizeof(unsigned));
+    profile_reset(s->machines);
+    s->work = 0;
     for (size_t i = 0; i < s->order.size; i++) {
-        unsigned cur_time = UINT_MAX;
-        unsigned cur_m = 0;
-        for (size_t i = 0; i < s->m; i++) {
-            if (end_times[i] < cur_time) {
-                cur_time = end_times[i];
-                cur_m = i;
-            }
-        }
         unsigned idx = s->order.data[i];
         size_t npreds = dag_npreds(s->g, idx);
         unsigned preds[npreds];
         dag_preds(s->g, idx, preds);
         unsigned max_pred_end = 0;
-        unsigned max_pred_m = 0;
         for (size_t i = 0; i < npreds; i++) {
             if (task_ends[preds[i]] > max_pred_end) {
                 max_pred_end = task_ends[preds[i]];
-                max_pred_m = assignments[preds[i]];
             }
         }
-        if (max_pred_end > cur_time) {
-            cur_m = max_pred_m;
-            cur_time = max_pred_end;
+        unsigned weight = dag_weight(s->g, idx);
+        task_ends[idx] = profile_place(s->machines, max_pred_end, weight) +
+            weight;
+        s->work += weight;
+    }
+    s->load = profile_load(s->machines);
+    return profile_latest(s->machines);
+}
+
+int schedule_assign(schedule *s, unsigned *starts, unsigned *machines) {
+    assert(s != NULL);
+    assert(starts != NULL);
+    assert(machines != NULL);
+    // the same placement as profile_place, but with the machines kept
+    // apart so each task's machine is known
+    unsigned *free_at = calloc(s->m, sizeof(*free_at));
+    if (free_at == NULL) {
+        return -1;
+    }
+    for (size_t i = 0; i < s->order.size; i++) {
+        unsigned idx = s->order.data[i];
+        size_t npreds = dag_npreds(s->g, idx);
+        unsigned preds[npreds + 1];
+        dag_preds(s->g, idx, preds);
+        unsigned ready = 0;
+        for (size_t j = 0; j < npreds; j++) {
+            unsigned end = starts[preds[j]] + dag_weight(s->g, preds[j]);
+            ready = (end > ready) ? end : ready;
         }
-        assignments[idx] = cur_m;
-        task_ends[idx] = cur_time + dag_weight(s->g, idx);
-        end_times[cur_m] = cur_time + dag_weight(s->g, idx);
-    }
-    unsigned final_time = 0;
-    for (size_t i = 0; i < s->m; i++) {
-        final_time = (end_times[i] > final_time) ? end_times[i] : final_time;
-    }
-    return final_time;
-}
-
-// calculate min_end
-static void end_visit(dag *g, unsigned idx, idx_vec *end_ready,
-                      bitmap *end_finished, unsigned *min_ends) {
-    size_t nsuccs = dag_nsuccs(g, idx);
-    unsigned succs[nsuccs];
-    dag_succs(g, idx, succs);
-    for (size_t i = 0; i < nsuccs; i++) {
-        unsigned succ = succs[i];
-        if (bitmap_get(end_finished, succ)) {
-            continue;
+        unsigned earliest = free_at[0];
+        for (unsigned k = 1; k < s->m; k++) {
+            earliest = (free_at[k] < earliest) ? free_at[k] : earliest;
         }
-        size_t npreds = dag_npreds(g, succ);
-        unsigned preds[npreds];
-        dag_preds(g, succ, preds);
-        int preds_complete = 1;
-        unsigned max_min_end = 0;
-        for (size_t j = 0; j < npreds; j++) {
-            if (bitmap_get(end_finished, preds[j]) != 1) {
-                preds_complete = 0;
-                break;
+        unsigned start = (ready > earliest) ? ready : earliest;
+        unsigned best = 0;
+        for (unsigned k = 0; k < s->m; k++) {
+            if (free_at[k] <= start &&
+                (free_at[best] > start || free_at[k] > free_at[best])) {
+                best = k;
             }
-            max_min_end = (min_ends[preds[j]] > max_min_end) ?
-                min_ends[preds[j]] : max_min_end;
-        }
-        // all predecessors have calculated min_ends
-        if (preds_complete) {
-            min_ends[succ] = dag_weight(g, succ) + max_min_end;
-            bitmap_set(end_finished, succ, 1);
-            idx_vec_push(end_ready, succ);
         }
+        starts[idx] = start;
+        machines[idx] = best;
+        free_at[best] = start + dag_weight(s->g, idx);
     }
+    free(free_at);
+    return 0;
 }
 
-// calculate max_start
-static void start_visit(dag *g, unsigned idx, idx_vec *start_ready,
-                        bitmap *start_finished, unsigned *max_starts,
-                        unsigned total_time) {
-    size_t npreds = dag_npreds(g, idx);
-    unsigned preds[npreds];
-    dag_preds(g, idx, preds);
-    for (size_t i = 0; i < npreds; i++) {
-        unsigned pred = preds[i];
-        if (bitmap_get(start_finished, pred)) {
-            continue;
-        }
-        size_t nsuccs = dag_nsuccs(g, pred);
-        unsigned succs[nsuccs];
-        dag_succs(g, pred, succs);
-        int succs_complete = 1;
-        unsigned min_max_start = INT_MAX;
-        for (size_t j = 0; j < nsuccs; j++) {
-            if (bitmap_get(start_finished, succs[j]) != 1) {
-                succs_complete = 0;
-                break;
-            }
-            min_max_start = (max_starts[succs[j]] < min_max_start) ?
-                max_starts[succs[j]] : min_max_start;
-        }
-        // all successors have calculated max_starts
-        if (succs_complete) {
-            max_starts[pred] =
-                (min_max_start - dag_weight(g, pred) < total_time) ?
-                min_max_start - dag_weight(g, pred) : total_time;
-            bitmap_set(start_finished, pred, 1);
-            idx_vec_push(start_ready, pred);
-        }
+typedef struct slot {
+    unsigned machine;
+    unsigned start;
+    unsigned end;
+} slot;
+
+static int slot_cmp(const void *a, const void *b) {
+    const slot *x = a;
+    const slot *y = b;
+    if (x->machine != y->machine) {
+        return (x->machine < y->machine) ? -1 : 1;
     }
+    return (x->start > y->start) - (x->start < y->start);
 }
 
-static int schedule_min_ends(schedule *s, unsigned *min_ends,
-                             unsigned *sched_ends) {
+int schedule_verify(schedule *s, const unsigned *starts,
+                    const unsigned *machines) {
     assert(s != NULL);
-    assert(min_ends != NULL);
-    idx_vec end_ready;
-    if (idx_vec_init(&end_ready, 0) != 0) {
-        return -1;
+    assert(starts != NULL);
+    assert(machines != NULL);
+    if (!schedule_is_complete(s) || !schedule_is_valid(s)) {
+        return 0;
     }
-    bitmap *end_finished = bitmap_create(dag_size(s->g));
-    if (end_finished == NULL) {
+    size_t size = dag_size(s->g);
+    slot *slots = malloc(size * sizeof(*slots));
+    if (slots == NULL) {
         return -1;
     }
-    for (size_t i = 0, nodes = schedule_size(s); i < nodes; i++) {
-        unsigned idx = s->order.data[i];
-        bitmap_set(end_finished, idx, 1);
-        min_ends[idx] = sched_ends[idx];
-        idx_vec_push(&end_ready, idx);
+    size_t nslots = 0;
+    int valid = 1;
+    for (unsigned i = 0; i < size && valid; i++) {
+        size_t npreds = dag_npreds(s->g, i);
+        unsigned preds[npreds + 1];
+        dag_preds(s->g, i, preds);
+        for (size_t j = 0; j < npreds; j++) {
+            if (starts[preds[j]] + dag_weight(s->g, preds[j]) > starts[i]) {
+                valid = 0;
+            }
+        }
+        // tasks without work occupy no machine
+        unsigned weight = dag_weight(s->g, i);
+        if (weight > 0) {
+            valid &= machines[i] < s->m;
+            slots[nslots++] = (slot) {machines[i], starts[i],
+                                      starts[i] + weight};
+        }
     }
-    while (end_ready.size > 0) {
-        unsigned idx;
-        idx_vec_pop(&end_ready, &idx);
-        end_visit(s->g, idx, &end_ready, end_finished, min_ends);
+    qsort(slots, nslots, sizeof(*slots), slot_cmp);
+    for (size_t i = 1; i < nslots && valid; i++) {
+        if (slots[i].machine == slots[i - 1].machine &&
+            slots[i].start < slots[i - 1].end) {
+            valid = 0;
+        }
     }
-    idx_vec_destroy(&end_ready);
-    bitmap_destroy(end_finished);
-    return 0;
+    free(slots);
+    return valid;
 }
 
-static int schedule_max_starts(schedule *s, unsigned *max_starts,
-                               unsigned total_time, unsigned *sched_ends) {
+// fills `min_ends' with the end time of each scheduled task, and the
+// earliest possible end time of every other task given those. Tasks
+// are visited in increasing id order, which is topological.
+static void schedule_min_ends(schedule *s, unsigned *min_ends,
+                              unsigned *sched_ends) {
     assert(s != NULL);
-    assert(max_starts != NULL);
-    idx_vec start_ready;
-    if (idx_vec_init(&start_ready, 0) != 0) {
-        return -1;
-    }
-    bitmap *start_finished = bitmap_create(dag_size(s->g));
-    if (start_finished == NULL) {
-        return -1;
-    }
-    for (size_t i = 0, nodes = schedule_size(s); i < nodes; i++) {
-        unsigned idx = s->order.data[i];
-        bitmap_set(start_finished, idx, 1);
-        max_starts[idx] = sched_ends[idx] - dag_weight(s->g, idx);
+    assert(min_ends != NULL);
+    dag *g = s->g;
+    for (size_t i = 0, size = dag_size(g); i < size; i++) {
+        if (bitmap_get(s->contents, i)) {
+            min_ends[i] = sched_ends[i];
+            continue;
+        }
+        size_t npreds = dag_npreds(g, i);
+        unsigned preds[npreds];
+        dag_preds(g, i, preds);
+        unsigned max_min_end = 0;
+        for (size_t j = 0; j < npreds; j++) {
+            max_min_end = (min_ends[preds[j]] > max_min_end) ?
+                min_ends[preds[j]] : max_min_end;
+        }
+        min_ends[i] = dag_weight(g, i) + max_min_end;
     }
+}
 
-    max_starts[dag_sink(s->g)] = total_time;
-    bitmap_set(start_finished, dag_sink(s->g), 1);
-    idx_vec_push(&start_ready, dag_sink(s->g));
-    while (start_ready.size > 0) {
-        unsigned idx;
-        idx_vec_pop(&start_ready, &idx);
-        start_visit(s->g, idx, &start_ready, start_finished, max_starts,
-                    total_time);
+// fills `max_starts' with the start time of each scheduled task, and
+// the latest start time of every other task that lets the sink start
+// at `total_time', then shifts them all by `total_time' less the
+// critical path. Tasks are visited in decreasing id order.
+static void schedule_max_starts(schedule *s, unsigned *max_starts,
+                                unsigned total_time, unsigned *sched_ends) {
+    assert(s != NULL);
+    assert(max_starts != NULL);
+    dag *g = s->g;
+    size_t size = dag_size(g);
+    for (size_t i = size; i-- > 0;) {
+        if (i == dag_sink(g)) {
+            max_starts[i] = total_time;
+            continue;
+        }
+        if (bitmap_get(s->contents, i)) {
+            max_starts[i] = sched_ends[i] - dag_weight(g, i);
+            continue;
+        }
+        size_t nsuccs = dag_nsuccs(g, i);
+        unsigned succs[nsuccs];
+        dag_succs(g, i, succs);
+        unsigned min_max_start = INT_MAX;
+        for (size_t j = 0; j < nsuccs; j++) {
+            min_max_start = (max_starts[succs[j]] < min_max_start) ?
+                max_starts[succs[j]] : min_max_start;
+        }
+        max_starts[i] = (min_max_start - dag_weight(g, i) < total_time) ?
+            min_max_start - dag_weight(g, i) : total_time;
     }
-    idx_vec_destroy(&start_ready);
-    bitmap_destroy(start_finished);
 
-    int diff = total_time - dag_level(s->g, dag_source(s->g));
-    for (size_t i = 0; i < dag_size(s->g); i++) {
+    int diff = total_time - dag_level(g, dag_source(g));
+    for (size_t i = 0; i < size; i++) {
         max_starts[i] += diff;
     }
-    return 0;
 }
 
 int schedule_build(schedule *s, unsigned total_time) {
@@ -312,9 +416,11 @@ int schedule_build(schedule *s, unsigned total_time) {
     if (total_time == 0) {
         total_time = dag_level(s->g, dag_source(s->g));
     }
-    unsigned sched_ends[dag_size(s->g)];
+    unsigned *sched_ends = s->ends;
     s->length = schedule_compute(s, sched_ends);
-#ifdef FUJITA
+    if (!s->windows) {
+        return 0;
+    }
     if (s->max_starts == NULL || s->min_ends == NULL) {
         s->max_starts = malloc(sizeof(*s->max_starts) * dag_size(s->g));
         s->min_ends = malloc(sizeof(*s->min_ends) * dag_size(s->g));
@@ -324,13 +430,8 @@ int schedule_build(schedule *s, unsigned total_time) {
             return -1;
         }
     }
-    if (schedule_max_starts(s, s->max_starts, total_time, sched_ends) != 0) {
-        return -1;
-    }
-    if (schedule_min_ends(s, s->min_ends, sched_ends) != 0) {
-        return -1;
-    }
-#endif
+    schedule_max_starts(s, s->max_starts, total_time, sched_ends);
+    schedule_min_ends(s, s->min_ends, sched_ends);
     return 0;
 }
 
@@ -339,46 +440,227 @@ unsigned schedule_length(schedule *s) {
     return s->length;
 }
 
+// returns the time the last predecessor of `id' ends.
+static unsigned preds_end(schedule *s, unsigned id) {
+    size_t npreds = dag_npreds(s->g, id);
+    unsigned preds[npreds + 1];
+    dag_preds(s->g, id, preds);
+    unsigned end = 0;
+    for (size_t i = 0; i < npreds; i++) {
+        assert(schedule_contains(s, preds[i]));
+        end = (s->ends[preds[i]] > end) ? s->ends[preds[i]] : end;
+    }
+    return end;
+}
+
+unsigned schedule_earliest_start(schedule *s, unsigned id) {
+    assert(s != NULL);
+    assert(!schedule_contains(s, id));
+    unsigned start = profile_earliest(s->machines);
+    unsigned end = preds_end(s, id);
+    return (end > start) ? end : start;
+}
+
+unsigned schedule_next_free(schedule *s, unsigned id) {
+    assert(s != NULL);
+    assert(!schedule_contains(s, id));
+    profile_copy(s->scratch, s->machines);
+    profile_place(s->scratch, preds_end(s, id), dag_weight(s->g, id));
+    return profile_earliest(s->scratch);
+}
+
+// completes the schedule by repeatedly adding the ready task with the
+// highest priority, ties going to the task that became ready first.
+// Priorities are the levels if `prio' is NULL.
+static int complete_by(schedule *s, const unsigned *prio, unsigned max_prio) {
+    dag *g = s->g;
+    size_t size = dag_size(g);
+    // number of unscheduled predecessors of each task
+    unsigned *waiting = calloc(size, sizeof(*waiting));
+    bucketq *ready = bucketq_create(max_prio);
+    if (waiting == NULL || ready == NULL) {
+        goto err;
+    }
+    for (unsigned i = 0; i < size; i++) {
+        if (schedule_contains(s, i)) {
+            continue;
+        }
+        size_t npreds = dag_npreds(g, i);
+        unsigned preds[npreds + 1];
+        dag_preds(g, i, preds);
+        for (size_t j = 0; j < npreds; j++) {
+            waiting[i] += !schedule_contains(s, preds[j]);
+        }
+        unsigned p = (prio != NULL) ? prio[i] : dag_level(g, i);
+        if (waiting[i] == 0 && bucketq_put(ready, i, p) != 0) {
+            goto err;
+        }
+    }
+    while (bucketq_size(ready) > 0) {
+        unsigned idx = bucketq_get(ready);
+        if (schedule_add(s, idx) != 0) {
+            goto err;
+        }
+        size_t nsuccs = dag_nsuccs(g, idx);
+        unsigned succs[nsuccs + 1];
+        dag_succs(g, idx, succs);
+        for (size_t j = 0; j < nsuccs; j++) {
+            unsigned succ = succs[j];
+            unsigned p = (prio != NULL) ? prio[succ] : dag_level(g, succ);
+            if (--waiting[succ] == 0 && bucketq_put(ready, succ, p) != 0) {
+                goto err;
+            }
+        }
+    }
+    bucketq_destroy(ready);
+    free(waiting);
+    return 0;
+ err:
+    if (ready != NULL) {
+        bucketq_destroy(ready);
+    }
+    free(waiting);
+    return -1;
+}
+
+int schedule_complete_greedy(schedule *s) {
+    assert(s != NULL);
+    return complete_by(s, NULL, dag_level(s->g, dag_source(s->g)));
+}
+
+int schedule_complete_ordered(schedule *s, const unsigned *order) {
+    assert(s != NULL);
+    assert(order != NULL);
+    size_t size = dag_size(s->g);
+    // earlier tasks get higher priorities
+    unsigned *prio = malloc(size * sizeof(*prio));
+    if (prio == NULL) {
+        return -1;
+    }
+    memset(prio, -1, size * sizeof(*prio));
+    for (size_t i = 0; i < size; i++) {
+        if (order[i] >= size || prio[order[i]] != (unsigned) -1) {
+            free(prio);
+            return -1;
+        }
+        prio[order[i]] = size - 1 - i;
+    }
+    int err = complete_by(s, prio, size - 1);
+    free(prio);
+    return err;
+}
+
+int schedule_work_bound(schedule *s) {
+    assert(s != NULL);
+    // machines only ever append work, so all remaining work runs after
+    // the machines' current end times
+    unsigned total = s->load + (s->total_work - s->work);
+    unsigned bound = total / s->m + (total % s->m != 0);
+    return (bound > s->length) ? bound : s->length;
+}
+
+void schedule_set_windows(schedule *s, int windows) {
+    assert(s != NULL);
+    s->windows = windows;
+}
+
 unsigned schedule_max_start(schedule *s, unsigned id) {
     assert(s != NULL);
+    assert(s->windows);
     assert(id < dag_size(s->g));
     return s->max_starts[id];
 }
 
 unsigned schedule_min_end(schedule *s, unsigned id) {
     assert(s != NULL);
+    assert(s->windows);
     assert(id < dag_size(s->g));
     return s->min_ends[id];
 }
 
-static void get_comp_list(schedule *s, idx_vec *comp_list) {
-    binheap *sorter = binheap_create();
-    for (size_t i = 0; i < dag_size(s->g); i++) {
-        unsigned max_start = schedule_max_start(s, i);
-        unsigned min_end = schedule_min_end(s, i);
-        binheap_put(sorter, max_start, -((int) max_start));
-        binheap_put(sorter, min_end, -((int) min_end));
+int schedule_path_bound(schedule *s) {
+    assert(s != NULL);
+    unsigned bound = s->length;
+    for (size_t i = 0, n_nodes = dag_size(s->g); i < n_nodes; i++) {
+        unsigned path = schedule_min_end(s, i) - dag_weight(s->g, i) +
+            dag_level(s->g, i);
+        bound = (path > bound) ? path : bound;
     }
-    idx_vec_push(comp_list, binheap_get(sorter));
-    while (binheap_size(sorter) > 0) {
-        unsigned c = binheap_get(sorter);
-        if (c != comp_list->data[comp_list->size - 1]) {
-            idx_vec_push(comp_list, c);
+    return bound;
+}
+
+// fills `comp_list' with the distinct max_start and min_end times in
+// ascending order.
+static int get_comp_list(schedule *s, idx_vec *comp_list) {
+    size_t n_nodes = dag_size(s->g);
+    for (size_t i = 0; i < n_nodes; i++) {
+        if (idx_vec_push(comp_list, schedule_max_start(s, i)) != 0 ||
+            idx_vec_push(comp_list, schedule_min_end(s, i)) != 0) {
+            return -1;
         }
     }
-    binheap_destroy(sorter);
+    size_t n = bucket_sort_unique(comp_list->data, comp_list->size);
+    if (n == (size_t) -1) {
+        return -1;
+    }
+    comp_list->size = n;
+    return 0;
 }
 
-static int work_density(schedule *s, unsigned ci, unsigned cj) {
+// copies the time windows into the schedule's packed arrays. Returns
+// 1 if the density variant can be used, and 0 if the dag has no
+// variant or some time does not fit in 16 bits.
+static int pack_windows(schedule *s) {
+    if (s->pack == NULL) {
+        return 0;
+    }
+    int16_t *starts = s->pack;
+    int16_t *ends = s->pack + s->pack_cap;
+    int16_t *weights = s->pack + 2 * s->pack_cap;
+    size_t size = dag_size(s->g);
+    for (size_t k = 0; k < size; k++) {
+        unsigned start = s->max_starts[k];
+        unsigned end = s->min_ends[k];
+        if (start > INT16_MAX || end > INT16_MAX) {
+            return 0;
+        }
+        starts[k] = start;
+        ends[k] = end;
+        weights[k] = dag_weight(s->g, k);
+    }
+    for (size_t k = size; k < s->pack_cap; k++) {
+        starts[k] = INT16_MAX;
+        ends[k] = 0;
+        weights[k] = 0;
+    }
+    return 1;
+}
+
+// returns the work that must run between times `ci' and `cj' given the
+// tasks' time windows, from the packed windows if `packed' is set.
+static int work_density(schedule *s, int packed, unsigned ci,
+                        unsigned cj) {
     assert(s != NULL);
+    const int16_t *starts = s->pack;
+    const int16_t *ends = s->pack + s->pack_cap;
+    const int16_t *weights = s->pack + 2 * s->pack_cap;
+    switch (packed ? s->pack_cap : 0) {
+    case 64:
+        return density_64(starts, ends, weights, ci, cj);
+    case 128:
+        return density_128(starts, ends, weights, ci, cj);
+    case 256:
+        return density_256(starts, ends, weights, ci, cj);
+    default:
+        break;
+    }
     int work_density = 0;
     // TODO: Compute this is constant time
     for (size_t k = 0, n_nodes = dag_size(s->g); k < n_nodes; k++) {
-        if (schedule_max_start(s, k) < cj &&
-            schedule_min_end(s, k) > ci) {
-            int case1 = schedule_min_end(s, k) - ci;
+        if (s->max_starts[k] < cj && s->min_ends[k] > ci) {
+            int case1 = s->min_ends[k] - ci;
             int case2 = dag_weight(s->g, k);
-            int case3 = cj - schedule_max_start(s, k);
+            int case3 = cj - s->max_starts[k];
             int case4 = cj - ci;
             int min1 = (case1 < case2) ? case1 : case2;
             int min2 = (case3 < case4) ? case3 : case4;
@@ -391,13 +673,20 @@ static int work_density(schedule *s, unsigned ci, unsigned cj) {
 int schedule_fernandez_bound(schedule *s) {
     assert(s != NULL);
     idx_vec comp_list;
-    idx_vec_init(&comp_list, 0);
-    get_comp_list(s, &comp_list);
+    int crit_path = dag_level(s->g, dag_source(s->g));
+    if (idx_vec_init(&comp_list, 0) != 0) {
+        return crit_path;
+    }
+    if (get_comp_list(s, &comp_list) != 0) {
+        idx_vec_destroy(&comp_list);
+        return crit_path;
+    }
 
+    int packed = pack_windows(s);
     int max_q = INT_MIN;
     for (size_t i = 0; i < comp_list.size - 1; i++) {
         for (size_t j = i + 1; j < comp_list.size; j++) {
-            int w_density = work_density(s, comp_list.data[i],
+            int w_density = work_density(s, packed, comp_list.data[i],
                                          comp_list.data[j]);
             int cur_q = (comp_list.data[i] - comp_list.data[j]) +
                 w_density / s->m + (w_density % s->m != 0);
@@ -405,20 +694,25 @@ int schedule_fernandez_bound(schedule *s) {
         }
     }
     idx_vec_destroy(&comp_list);
-    int crit_path = dag_level(s->g, dag_source(s->g));
     return (max_q > 0) ? crit_path + max_q : crit_path;
 }
 
 int schedule_machine_bound(schedule *s) {
     assert(s != NULL);
     idx_vec comp_list;
-    idx_vec_init(&comp_list, 0);
-    get_comp_list(s, &comp_list);
+    if (idx_vec_init(&comp_list, 0) != 0) {
+        return 0;
+    }
+    if (get_comp_list(s, &comp_list) != 0) {
+        idx_vec_destroy(&comp_list);
+        return 0;
+    }
 
+    int packed = pack_windows(s);
     int max_m = INT_MIN;
     for (size_t i = 0; i < comp_list.size - 1; i++) {
         for (size_t j = i + 1; j < comp_list.size; j++) {
-            int w_density = work_density(s, comp_list.data[i],
+            int w_density = work_density(s, packed, comp_list.data[i],
                                          comp_list.data[j]);
             int interval = (comp_list.data[j] - comp_list.data[i]);
             int cur_m = w_density / interval + (w_density % interval != 0);
@@ -41,18 +41,69 @@ int schedule_is_valid(schedule *s);
 // `total_time' is 0, the critical path length is used instead.
 int schedule_build(schedule *s, unsigned total_time);
 
+// sets whether schedule_build computes the min_end and max_start
+// times, which are on by default. Without them the schedule's length
+// and end times are still built, but none of the bounds below that
+// schedule_work_bound may be used.
+void schedule_set_windows(schedule *s, int windows);
+
 unsigned schedule_length(schedule *s);
 
-#ifdef FUJITA
+// returns the time the unscheduled task `id', whose predecessors must
+// all be scheduled, would start if it were added next, as of the last
+// schedule_build.
+unsigned schedule_earliest_start(schedule *s, unsigned id);
+
+// returns the time the first machine would become free if the
+// unscheduled task `id', whose predecessors must all be scheduled,
+// were added next, as of the last schedule_build. No other task can
+// start before then.
+unsigned schedule_next_free(schedule *s, unsigned id);
+
+// stores the start time and machine, from 0 to m - 1, of every
+// scheduled task in `starts' and `machines', indexed by task, as
+// placed by the list scheduling of schedule_build. Returns 0 on
+// success and -1 on failure.
+int schedule_assign(schedule *s, unsigned *starts, unsigned *machines);
+
+// returns 1 if the complete schedule `s', with the given start times
+// and machines of every task, is feasible: its order is valid, no task
+// starts before its predecessors end, and no two tasks overlap on a
+// machine. Returns 0 if not and -1 on failure. The times and machines
+// need not come from schedule_assign.
+int schedule_verify(schedule *s, const unsigned *starts,
+                    const unsigned *machines);
+
+// completes the schedule by repeatedly adding the ready task with the
+// highest level, ties going to the task that became ready first. The
+// result is a quick heuristic schedule, not an optimal one. Returns 0
+// on success and -1 on failure.
+int schedule_complete_greedy(schedule *s);
+
+// completes the schedule like schedule_complete_greedy, but prefers
+// the ready task that comes first in `order', a permutation of the
+// dag's tasks. Tasks keep their relative order wherever precedence
+// allows, which repairs a schedule of a slightly different dag into a
+// valid one. Returns 0 on success and -1 if `order' is not a
+// permutation or on failure.
+int schedule_complete_ordered(schedule *s, const unsigned *order);
+
+// returns a lower bound on the length of any completion of the
+// schedule from spreading the remaining work over all machines.
+int schedule_work_bound(schedule *s);
+
 unsigned schedule_max_start(schedule *s, unsigned id);
 unsigned schedule_min_end(schedule *s, unsigned id);
 
+// returns a lower bound on the length of any completion of the
+// schedule from the longest path through each task, starting no
+// earlier than its min_end allows.
+int schedule_path_bound(schedule *s);
+
 // calculate and return the Fernandez bound
 int schedule_fernandez_bound(schedule *s);
 
 // use Fujita's binary search method
 int schedule_machine_bound(schedule *s);
 
-#endif // FUJITA
-
 #endif // SCHEDULE_H
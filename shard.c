@@ -0,0 +1,82 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "shard.h"
+
+// shard files look like
+//
+// m 4
+// incumbent 37
+// bound 35
+// prefix 3 0 5 2
+//
+// where the prefix line starts with its length.
+
+void shard_destroy(shard *sh) {
+    assert(sh != NULL);
+    free(sh->prefix);
+    sh->prefix = NULL;
+    sh->len = 0;
+}
+
+int shard_write(const char *path, const shard *sh) {
+    assert(path != NULL);
+    assert(sh != NULL);
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        return -1;
+    }
+    fprintf(f, "m %u\n", sh->m);
+    fprintf(f, "incumbent %u\n", sh->incumbent);
+    fprintf(f, "bound %u\n", sh->bound);
+    fprintf(f, "prefix %zu", sh->len);
+    for (size_t i = 0; i < sh->len; i++) {
+        fprintf(f, " %u", sh->prefix[i]);
+    }
+    fprintf(f, "\n");
+    return (fclose(f) == 0) ? 0 : -1;
+}
+
+int shard_read(const char *path, shard *sh) {
+    assert(path != NULL);
+    assert(sh != NULL);
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        return -1;
+    }
+    sh->prefix = NULL;
+    if (fscanf(f, " m %u incumbent %u bound %u prefix %zu", &sh->m,
+               &sh->incumbent, &sh->bound, &sh->len) != 4 ||
+        sh->m == 0 || sh->len == 0) {
+        goto err;
+    }
+    sh->prefix = malloc(sh->len * sizeof(*sh->prefix));
+    if (sh->prefix == NULL) {
+        goto err;
+    }
+    for (size_t i = 0; i < sh->len; i++) {
+        if (fscanf(f, "%u", &sh->prefix[i]) != 1) {
+            goto err;
+        }
+    }
+    fclose(f);
+    return 0;
+ err:
+    free(sh->prefix);
+    sh->prefix = NULL;
+    fclose(f);
+    return -1;
+}
+
+int incumbent_read(const char *path, unsigned *incumbent) {
+    assert(path != NULL);
+    assert(incumbent != NULL);
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        return -1;
+    }
+    int ok = fscanf(f, "%u", incumbent) == 1;
+    fclose(f);
+    return ok ? 0 : -1;
+}
@@ -0,0 +1,39 @@
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <stdlib.h>
+
+// An independent piece of a search: the subtree below a fixed
+// sequence of scheduled tasks. Shards are written to and read from
+// small text files, so they can be solved by separate processes or
+// machines that share nothing but a file system.
+typedef struct shard {
+    // the number of machines
+    unsigned m;
+    // the best makespan known when the shard was split off, which is
+    // the length of an actual schedule
+    unsigned incumbent;
+    // a lower bound on the makespan of the whole dag
+    unsigned bound;
+    // the tasks scheduled first, starting with the dag's source
+    size_t len;
+    unsigned *prefix;
+} shard;
+
+// clean up the prefix owned by the shard.
+void shard_destroy(shard *sh);
+
+// write the shard to the file at `path'. Return 0 on success and -1
+// on failure.
+int shard_write(const char *path, const shard *sh);
+
+// read the shard stored in the file at `path' into `sh', which owns
+// the prefix afterwards. Return 0 on success and -1 on failure.
+int shard_read(const char *path, shard *sh);
+
+// read an incumbent makespan, a single number, from the file at
+// `path'. Return 0 on success and -1 on failure, which includes a
+// missing file.
+int incumbent_read(const char *path, unsigned *incumbent);
+
+#endif // SHARD_H
@@ -0,0 +1,89 @@
+"""Solve one DAG by splitting its search into shards run as separate
+processes, which share the best makespan through a file.
+
+usage: python3 shard.py <file> m k [jobs] [timeout]
+"""
+
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+def write_incumbent(path, value):
+    # readers poll the file, so replace it atomically
+    tmp = path + ".tmp"
+    with open(tmp, "w") as f:
+        f.write("{}\n".format(value))
+    os.replace(tmp, path)
+
+def read_shard(path):
+    with open(path) as f:
+        fields = f.read().split()
+    return int(fields[3]), int(fields[5])
+
+def split(path, m, k, base):
+    result = subprocess.run(
+        ["./bbexps", path, str(m), "-1", "--split", str(k), base],
+        stdout=subprocess.PIPE,
+        encoding="utf-8")
+    if result.returncode != 0:
+        print(result.stdout, end="")
+        sys.exit(1)
+    return result.stdout.split()
+
+def solve(path, m, k, jobs, timeout):
+    start = time.time()
+    with tempfile.TemporaryDirectory() as tmpdir:
+        shards = split(path, m, k, os.path.join(tmpdir, "shard"))
+        best, bound = read_shard(shards[0])
+        incumbent = os.path.join(tmpdir, "incumbent")
+        write_incumbent(incumbent, best)
+        pending = list(shards)
+        running = []
+        timed_out = False
+        while pending or running:
+            while pending and len(running) < jobs and best > bound:
+                shard = pending.pop(0)
+                running.append(subprocess.Popen(
+                    ["./bbexps", path, str(m), str(timeout),
+                     "--solve-shard", shard, "--incumbent", incumbent],
+                    stdout=subprocess.PIPE,
+                    encoding="utf-8"))
+            if not running:
+                break
+            time.sleep(0.01)
+            for proc in [p for p in running if p.poll() is not None]:
+                running.remove(proc)
+                value = int(proc.stdout.read().split(",")[3])
+                if value == -2:
+                    timed_out = True
+                elif value < 0:
+                    print("shard failed")
+                    sys.exit(1)
+                elif value < best:
+                    best = value
+                    write_incumbent(incumbent, best)
+            if best <= bound:
+                # optimal, the remaining shards cannot improve on it
+                for proc in running:
+                    proc.kill()
+                    proc.wait()
+                running = []
+        with open(path) as f:
+            n = int(f.read().split()[0]) - 2
+        result = -2 if timed_out and best > bound else best
+        print("{}, {}, {}, {}, {:f}".format(path, n, m, result,
+                                            time.time() - start))
+
+def main():
+    if len(sys.argv) < 4:
+        print(__doc__)
+        sys.exit(1)
+    path, m, k = sys.argv[1], int(sys.argv[2]), int(sys.argv[3])
+    jobs = int(sys.argv[4]) if len(sys.argv) > 4 else os.cpu_count()
+    timeout = int(sys.argv[5]) if len(sys.argv) > 5 else -1
+    solve(path, m, k, jobs, timeout)
+
+if __name__ == "__main__":
+    main()
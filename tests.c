@@ -2,15 +2,30 @@
 #pragma GCC diagnostic ignored "-Wunused-variable"
 
 #include <assert.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "dag.h"
+#include "bbsched.h"
 #include "bbsearch.h"
 #include "schedule.h"
 #include "bitmap.h"
 #include "binheap.h"
+#include "bucketq.h"
+#include "cache.h"
+#include "checkpoint.h"
+#include "dp.h"
+#include "gen.h"
+#include "listsched.h"
 #include "parser.h"
+#include "profile.h"
+#include "shard.h"
+#include "trace.h"
+#include "tuning.h"
 
 /*
 A --> B         I
@@ -86,7 +101,120 @@ void test_dag(void) {
     assert(h_preds[0] == f || h_preds[1] == f);
     assert(h_preds[0] == g || h_preds[1] == g);
 
+    assert(!dag_has_closure(graph));
+    int err = dag_closure(graph);
+    assert(err == 0);
+    assert(dag_has_closure(graph));
+    assert(dag_reaches(graph, a, k));
+    assert(dag_reaches(graph, g, dag_sink(graph)));
+    assert(!dag_reaches(graph, k, a));
+    assert(!dag_reaches(graph, g, i));
+    assert(!dag_reaches(graph, a, a));
+    assert(dag_ndescs(graph, f) == 5);
+    assert(dag_ndescs(graph, dag_source(graph)) == 12);
+    assert(dag_descs_subset(graph, h, f));
+    assert(!dag_descs_subset(graph, f, h));
+    assert(dag_level(graph, dag_source(graph)) == 48);
+
+    // the reverse turns ids around and swaps predecessors and
+    // successors, keeping the critical path
+    dag *rev = dag_reverse(graph);
+    assert(rev != NULL);
+    assert(dag_size(rev) == 13);
+    assert(dag_weight(rev, 12 - e) == 5);
+    assert(dag_level(rev, dag_source(rev)) == 48);
+    assert(dag_level(rev, 12 - a) == 1);
+    assert(dag_nsuccs(rev, dag_source(rev)) == 1);
+    assert(dag_npreds(rev, dag_sink(rev)) == 3);
+    assert(dag_npreds(rev, 12 - f) == 2);
+    unsigned f_rev_preds[2] = {};
+    dag_preds(rev, 12 - f, f_rev_preds);
+    assert(f_rev_preds[0] == 12 - i || f_rev_preds[1] == 12 - i);
+    assert(f_rev_preds[0] == 12 - h || f_rev_preds[1] == 12 - h);
+    dag_destroy(rev);
+
+    dag_destroy(graph);
+
+    // transitive reduction drops x -> z
+    graph = dag_create();
+    unsigned x = dag_vertex(graph, 1, 0, NULL);
+    unsigned y = dag_vertex(graph, 1, 1, &x);
+    unsigned z_deps[] = {x, y};
+    unsigned z = dag_vertex(graph, 1, 2, z_deps);
+    dag_build(graph);
+    assert(dag_npreds(graph, z) == 2);
+    err = dag_closure(graph);
+    assert(err == 0);
+    assert(dag_npreds(graph, z) == 1);
+    assert(dag_nsuccs(graph, x) == 1);
+    assert(dag_reaches(graph, x, z));
+    assert(dag_level(graph, x) == 3);
+    assert(dag_width(graph) == 1);
+    // edits keep the levels up to date
+    err = dag_set_weight(graph, z, 4);
+    assert(err == 0);
+    assert(dag_level(graph, x) == 6);
+    assert(dag_level(graph, dag_source(graph)) == 6);
+    err = dag_remove_edge(graph, y, z);
+    assert(err == 0);
+    assert(!dag_has_closure(graph));
+    assert(dag_level(graph, x) == 2);
+    assert(dag_level(graph, dag_source(graph)) == 4);
+    assert(dag_npreds(graph, z) == 1);
+    assert(dag_nsuccs(graph, y) == 1);
+    err = dag_add_edge(graph, x, z);
+    assert(err == 0);
+    assert(dag_level(graph, x) == 5);
+    assert(dag_npreds(graph, z) == 1);
+    err = dag_add_edge(graph, z, y);
+    assert(err == -1);
+    err = dag_remove_edge(graph, y, z);
+    assert(err == -1);
     dag_destroy(graph);
+
+    // series blocks {a, b}, {c}, {d, e}
+    graph = dag_create();
+    a = dag_vertex(graph, 3, 0, NULL);
+    b = dag_vertex(graph, 2, 0, NULL);
+    unsigned c_deps[] = {a, b};
+    c = dag_vertex(graph, 1, 2, c_deps);
+    d = dag_vertex(graph, 4, 1, &c);
+    e = dag_vertex(graph, 5, 1, &c);
+    dag_build(graph);
+    dag_closure(graph);
+    unsigned ends[dag_size(graph)];
+    size_t nblocks = dag_series_blocks(graph, ends);
+    assert(nblocks == 3);
+    assert(ends[0] == b);
+    assert(ends[1] == c);
+    assert(ends[2] == e);
+    assert(dag_width(graph) == 2);
+    dag *sub = dag_subgraph(graph, d, e);
+    assert(sub != NULL);
+    assert(dag_size(sub) == 4);
+    assert(dag_weight(sub, 1) == 4);
+    assert(dag_npreds(sub, 2) == 1);
+    assert(dag_level(sub, dag_source(sub)) == 5);
+    dag_destroy(sub);
+    dag_destroy(graph);
+    (void) nblocks;
+
+    // a long chain of diamonds, where every join is reached through
+    // both of its branches
+    graph = dag_create();
+    unsigned join = dag_vertex(graph, 1, 0, NULL);
+    for (int i = 0; i < 1000; i++) {
+        unsigned branches[2];
+        branches[0] = dag_vertex(graph, 1, 1, &join);
+        branches[1] = dag_vertex(graph, 2, 1, &join);
+        join = dag_vertex(graph, 1, 2, branches);
+    }
+    err = dag_build(graph);
+    assert(err == 0);
+    assert(dag_level(graph, dag_source(graph)) == 3001);
+    assert(dag_level(graph, join) == 1);
+    dag_destroy(graph);
+    (void) err;
 }
 
 void test_schedule(void) {
@@ -140,6 +268,11 @@ void test_schedule(void) {
 
     schedule_build(perm2, 0);
     assert(schedule_length(perm2) == 12);
+    // machines end at 3 and 12, 51 units of work remain
+    assert(schedule_work_bound(perm2) == 33);
+    // g only waits for a machine, f also waits for e
+    assert(schedule_earliest_start(perm2, g) == 3);
+    assert(schedule_earliest_start(perm2, f) == 12);
 
     schedule_add(perm2, g);
     schedule_add(perm2, f);
@@ -157,16 +290,18 @@ void test_schedule(void) {
     schedule_build(perm2, 0);
     assert(schedule_length(perm2) == 48);
 
-#ifdef FUJITA
     assert(schedule_min_end(perm2, dag_sink(graph)) == 48);
     assert(schedule_min_end(perm2, g) == 10);
     assert(schedule_min_end(perm2, i) == 27);
     assert(schedule_min_end(perm2, h) == 26);
-#endif
+
+    // without the windows only the length and end times are built
+    schedule_set_windows(perm2, 0);
+    schedule_build(perm2, 0);
+    assert(schedule_length(perm2) == 48);
 
     schedule_destroy(perm2);
 
-#ifdef FUJITA
     // test min ends
     schedule *perm3 = schedule_create(graph, m);
     assert(perm3 != NULL);
@@ -189,7 +324,6 @@ void test_schedule(void) {
     assert(schedule_max_start(perm3, dag_sink(graph)) == 48);
 
     schedule_destroy(perm3);
-#endif
 
     // test validity check
     schedule *perm5 = schedule_create(graph, m);
@@ -199,6 +333,37 @@ void test_schedule(void) {
     assert(!schedule_is_valid(perm5));
     schedule_destroy(perm5);
 
+    // the greedy completion of a partial schedule keeps its prefix
+    schedule *perm7 = schedule_create(graph, m);
+    assert(perm7 != NULL);
+    schedule_add(perm7, dag_source(graph));
+    schedule_add(perm7, g);
+    int err = schedule_complete_greedy(perm7);
+    assert(err == 0);
+    assert(schedule_is_complete(perm7));
+    assert(schedule_is_valid(perm7));
+    assert(schedule_get(perm7, 1) == g);
+    schedule_build(perm7, 0);
+    assert(schedule_length(perm7) >= 48);
+    schedule_destroy(perm7);
+
+    // an order that breaks precedence is repaired
+    schedule *perm8 = schedule_create(graph, m);
+    assert(perm8 != NULL);
+    unsigned backwards[dag_size(graph)];
+    for (size_t idx = 0; idx < dag_size(graph); idx++) {
+        backwards[idx] = dag_size(graph) - 1 - idx;
+    }
+    schedule_add(perm8, dag_source(graph));
+    err = schedule_complete_ordered(perm8, backwards);
+    assert(err == 0);
+    (void) backwards;
+    assert(schedule_is_complete(perm8));
+    assert(schedule_is_valid(perm8));
+    // g is the last task without predecessors
+    assert(schedule_get(perm8, 1) == g);
+    schedule_destroy(perm8);
+
     dag_destroy(graph);
 
     // test Fernandez bound (from Fujita)
@@ -212,15 +377,14 @@ void test_schedule(void) {
     dag_vertex(graph, 2, 0, NULL);
     dag_build(graph);
 
-#ifdef FUJITA
     schedule *perm6 = schedule_create(graph, 2);
     schedule_add(perm6, dag_source(graph));
-    int err = schedule_build(perm6, 0);
+    err = schedule_build(perm6, 0);
     assert(err == 0);
     assert(schedule_fernandez_bound(perm6) == 8);
     schedule_destroy(perm6);
     dag_destroy(graph);
-#endif
+    (void) err;
 }
 
 void test_bbsearch(void) {
@@ -252,6 +416,58 @@ void test_bbsearch(void) {
 
     dag_build(graph);
     assert(bbsearch(graph, 2, -1) == 48);
+    // every branching policy finds the same makespan
+    for (int policy = 0; policy < N_BRANCH_POLICIES; policy++) {
+        bbopts opts;
+        bbopts_init(&opts);
+        opts.branch = policy;
+        int result = bbsearch_opts(graph, 2, -1, &opts, NULL);
+        assert(result == 48);
+        result = bbsearch_opts(graph, 3, -1, &opts, NULL);
+        assert(result == bbsearch(graph, 3, -1));
+        (void) result;
+    }
+    // and so does every direction, alone or as a portfolio, with a
+    // schedule of the dag itself. Portfolios do not race.
+    for (int direction = 0; direction < N_SEARCH_DIRECTIONS; direction++) {
+        for (int portfolio = 0; portfolio < 2; portfolio++) {
+            bbopts opts;
+            bbopts_init(&opts);
+            opts.direction = direction;
+            opts.portfolio = portfolio;
+            schedule *best = NULL;
+            int result = bbsearch_best(graph, 2, -1, &opts, &best, NULL);
+            if (portfolio && direction == DIRECTION_RACE) {
+                assert(result == -1);
+                continue;
+            }
+            assert(result == 48);
+            assert(best != NULL && schedule_dag(best) == graph);
+            assert(schedule_is_valid(best) && schedule_length(best) == 48);
+            schedule_destroy(best);
+        }
+    }
+    dag_destroy(graph);
+
+    // the weight and succs policies rank tasks by two numbers. Packed
+    // into one priority they would need billions of queue buckets.
+    graph = dag_create();
+    assert(graph != NULL);
+    unsigned heavy = dag_vertex(graph, 5 << 13, 0, NULL);
+    for (int idx = 0; idx < 5; idx++) {
+        dag_vertex(graph, 2 << 13, 1, &heavy);
+    }
+    dag_build(graph);
+    for (int policy = BRANCH_WEIGHT; policy <= BRANCH_SUCCS; policy++) {
+        bbopts opts;
+        bbopts_init(&opts);
+        opts.branch = policy;
+        // without a bound stronger than the cheap ones the search runs
+        opts.bounds = 0;
+        int result = bbsearch_opts(graph, 2, -1, &opts, NULL);
+        assert(result == 11 << 13);
+        (void) result;
+    }
     dag_destroy(graph);
 
     graph = dag_create();
@@ -267,7 +483,490 @@ void test_bbsearch(void) {
     assert(bbsearch(graph, 2, -1) == 8);
     assert(bbsearch(graph, 3, -1) == 6);
     assert(bbsearch(graph, 4, -1) == 5);
+
+    // every bound pipeline finds the same makespan
+    const char *pipelines[] = {"none", "cheap", "fernandez", "fujita",
+                               "cheap,fernandez,fujita"};
+    for (size_t p = 0; p < 5; p++) {
+        for (int adaptive = 0; adaptive < 2; adaptive++) {
+            bbopts opts;
+            bbopts_init(&opts);
+            int err = bound_parse(pipelines[p], &opts.bounds);
+            assert(err == 0);
+            opts.adaptive = adaptive;
+            bbstats stats;
+            int result = bbsearch_opts(graph, 3, -1, &opts, &stats);
+            assert(result == 6);
+            result = bbsearch_opts(graph, 2, -1, &opts, &stats);
+            assert(result == 8);
+            // the greedy schedule meets the root bound
+            assert(stats.root_closed == 1);
+            assert(stats.nodes == 0);
+            (void) err;
+            (void) result;
+        }
+    }
+    // the greedy schedule on four machines meets the critical path
+    bbstats path_stats;
+    bbopts path_opts;
+    bbopts_init(&path_opts);
+    int path_len = bbsearch_opts(graph, 4, -1, &path_opts, &path_stats);
+    assert(path_len == 5);
+    assert(path_stats.path_closed == 1);
+    assert(path_stats.width_closed == 0);
+    assert(path_stats.nodes == 0);
+    (void) path_len;
+    dag_destroy(graph);
+
+    // greedy runs both 3s first and needs 7, the search stops as soon
+    // as it finds 6, the work bound
+    graph = dag_create();
+    assert(graph != NULL);
+    dag_vertex(graph, 3, 0, NULL);
+    dag_vertex(graph, 3, 0, NULL);
+    dag_vertex(graph, 2, 0, NULL);
+    dag_vertex(graph, 2, 0, NULL);
+    dag_vertex(graph, 2, 0, NULL);
+    dag_build(graph);
+    path_len = bbsearch_opts(graph, 2, -1, &path_opts, &path_stats);
+    assert(path_len == 6);
+    assert(path_stats.root_closed == 0);
+    assert(path_stats.gap_closed == 1);
+    assert(path_stats.nodes > 0);
+
+    // a traced search has one terminal event per node
+    path_opts.trace_path = "trace_test.tmp";
+    int traced = bbsearch_opts(graph, 2, -1, &path_opts, &path_stats);
+    assert(traced == 6);
+    path_opts.trace_path = NULL;
+    FILE *trace = fopen("trace_test.tmp", "rb");
+    assert(trace != NULL);
+    char magic[8];
+    uint32_t event_size;
+    size_t header = fread(magic, 8, 1, trace);
+    header += fread(&event_size, sizeof(event_size), 1, trace);
+    assert(header == 2);
+    assert(memcmp(magic, "BBTRACE1", 8) == 0);
+    assert(event_size == sizeof(trace_event));
+    unsigned long kinds[N_TRACE_KINDS] = {0};
+    unsigned long stage_prunes[N_STAGES] = {0};
+    trace_event event;
+    while (fread(&event, sizeof(event), 1, trace) == 1) {
+        kinds[event.kind]++;
+        if (event.kind == TRACE_PRUNE) {
+            stage_prunes[event.stage]++;
+        }
+        if (event.kind == TRACE_INCUMBENT) {
+            assert(event.value == 6);
+        }
+    }
+    fclose(trace);
+    remove("trace_test.tmp");
+    assert(kinds[TRACE_EXPAND] + kinds[TRACE_PRUNE] + kinds[TRACE_LEAF] ==
+           path_stats.nodes);
+    assert(kinds[TRACE_INCUMBENT] == 1);
+    for (int stage = 0; stage < N_STAGES; stage++) {
+        assert(stage_prunes[stage] == path_stats.prunes[stage]);
+    }
+    (void) traced;
+    (void) magic;
+    (void) event_size;
+    (void) header;
+
+    // every driver proves the optimum. The first limited discrepancy
+    // pass only follows the greedy path, which gives 7.
+    unsigned long passes[N_SEARCH_DRIVERS];
+    for (int driver = 0; driver < N_SEARCH_DRIVERS; driver++) {
+        path_opts.driver = driver;
+        path_len = bbsearch_opts(graph, 2, -1, &path_opts, &path_stats);
+        assert(path_len == 6);
+        passes[driver] = path_stats.passes;
+    }
+    path_opts.driver = SEARCH_DFS;
+    assert(passes[SEARCH_DFS] == 0);
+    assert(passes[SEARCH_LDS] > 1);
+    assert(passes[SEARCH_RESTARTS] == 1);
+    (void) passes;
+
+    // the shards together find the optimum, and survive a round trip
+    // through a file
+    shard *shards;
+    size_t nshards;
+    int err = bbsearch_split(graph, 2, 4, &shards, &nshards);
+    assert(err == 0);
+    (void) err;
+    assert(nshards >= 4);
+    assert(shards[0].incumbent == 7);
+    assert(shards[0].bound == 6);
+    int best = INT_MAX;
+    for (size_t i = 0; i < nshards; i++) {
+        err = shard_write("shard_test.tmp", &shards[i]);
+        assert(err == 0);
+        shard sh;
+        err = shard_read("shard_test.tmp", &sh);
+        assert(err == 0);
+        assert(sh.len == shards[i].len);
+        assert(memcmp(sh.prefix, shards[i].prefix,
+                      sh.len * sizeof(*sh.prefix)) == 0);
+        int result = bbsearch_shard(graph, &sh, -1, NULL, &path_opts, NULL);
+        assert(result == 6 || result == 7);
+        best = (result < best) ? result : best;
+        shard_destroy(&sh);
+        shard_destroy(&shards[i]);
+    }
+    free(shards);
+    assert(best == 6);
+    // an external incumbent at the root bound ends a shard at once
+    FILE *inc = fopen("shard_test.tmp", "w");
+    fprintf(inc, "6\n");
+    fclose(inc);
+    unsigned source = dag_source(graph);
+    shard root = {.m = 2, .incumbent = 7, .bound = 6, .len = 1,
+                  .prefix = &source};
+    best = bbsearch_shard(graph, &root, -1, "shard_test.tmp", &path_opts,
+                          &path_stats);
+    assert(best == 6);
+    assert(path_stats.nodes == 1);
+    remove("shard_test.tmp");
+
+    // a beam of four finds the optimum the greedy schedule misses, and
+    // proves it with the root bound. A beam of one does not.
+    unsigned beam_order[dag_size(graph)];
+    unsigned beam_bound;
+    int beam_len = bbsearch_beam(graph, 2, 1, &path_opts, NULL, NULL, NULL);
+    assert(beam_len == 7);
+    beam_len = bbsearch_beam(graph, 2, 4, &path_opts, beam_order, &beam_bound,
+                             NULL);
+    assert(beam_len == 6);
+    (void) beam_len;
+    assert(beam_bound == 6);
+    schedule *beam = schedule_create(graph, 2);
+    for (size_t idx = 0; idx < dag_size(graph); idx++) {
+        schedule_add(beam, beam_order[idx]);
+    }
+    assert(schedule_is_valid(beam));
+    schedule_build(beam, 0);
+    assert(schedule_length(beam) == 6);
+    schedule_destroy(beam);
+
+    // resuming a checkpoint written at the root's second child skips
+    // the first child's subtree, and keeps the counters
+    unsigned path[] = {source, 3};
+    unsigned order[] = {source, 1, 2, 3, 4, 5, dag_sink(graph)};
+    checkpoint cp = {.m = 2, .incumbent = 7, .order_len = 7,
+                     .order = order, .len = 2, .path = path};
+    cp.stats.nodes = 100;
+    cp.stats.dp_closed = 2;
+    cp.stats.passes = 3;
+    err = checkpoint_write("checkpoint_test.tmp", &cp);
+    assert(err == 0);
+    checkpoint read_cp;
+    err = checkpoint_read("checkpoint_test.tmp", &read_cp);
+    assert(err == 0);
+    assert(read_cp.incumbent == 7 && read_cp.len == 2);
+    assert(read_cp.path[1] == 3 && read_cp.order[6] == dag_sink(graph));
+    assert(read_cp.stats.nodes == 100);
+    assert(read_cp.stats.dp_closed == 2 && read_cp.stats.passes == 3);
+    checkpoint_destroy(&read_cp);
+    path_opts.resume_path = "checkpoint_test.tmp";
+    path_len = bbsearch_opts(graph, 2, -1, &path_opts, &path_stats);
+    assert(path_len == 6);
+    assert(path_stats.nodes > 100);
+    path_len = bbsearch_opts(graph, 3, -1, &path_opts, &path_stats);
+    assert(path_len == -1);
+    // only depth first searches resume
+    path_opts.driver = SEARCH_LDS;
+    path_len = bbsearch_opts(graph, 2, -1, &path_opts, &path_stats);
+    assert(path_len == -1);
+    path_opts.driver = SEARCH_DFS;
+    path_opts.resume_path = NULL;
+    remove("checkpoint_test.tmp");
+
+    // the best order evaluates to the makespan, and warm starts from
+    // it after an edit
+    unsigned best_order[dag_size(graph)];
+    int warm_result = bbsearch_warm(graph, 2, -1, &path_opts, NULL,
+                                    best_order, NULL);
+    assert(warm_result == 6);
+    schedule *opt = schedule_create(graph, 2);
+    for (size_t idx = 0; idx < dag_size(graph); idx++) {
+        schedule_add(opt, best_order[idx]);
+    }
+    assert(schedule_is_valid(opt));
+    schedule_build(opt, 0);
+    assert(schedule_length(opt) == 6);
+    schedule_destroy(opt);
+    // two of the short tasks wait for the long ones
+    err = dag_add_edge(graph, 1, 3);
+    assert(err == 0);
+    err = dag_add_edge(graph, 2, 4);
+    assert(err == 0);
+    bbwarm warm = {.order = best_order};
+    warm_result = bbsearch_warm(graph, 2, -1, &path_opts, &warm, best_order,
+                                NULL);
+    path_len = bbsearch_opts(graph, 2, -1, &path_opts, NULL);
+    assert(warm_result == path_len);
+    assert(warm_result == 7);
+    // removing them again lowers the optimum below the warm order's
+    err = dag_remove_edge(graph, 1, 3);
+    assert(err == 0);
+    err = dag_remove_edge(graph, 2, 4);
+    assert(err == 0);
+    warm_result = bbsearch_warm(graph, 2, -1, &path_opts, &warm, NULL, NULL);
+    assert(warm_result == 6);
+    (void) warm_result;
     dag_destroy(graph);
+
+    // series blocks are solved separately
+    graph = dag_create();
+    a = dag_vertex(graph, 3, 0, NULL);
+    b = dag_vertex(graph, 2, 0, NULL);
+    unsigned c_deps[] = {a, b};
+    c = dag_vertex(graph, 1, 2, c_deps);
+    d = dag_vertex(graph, 4, 1, &c);
+    e = dag_vertex(graph, 5, 1, &c);
+    dag_build(graph);
+    bbopts opts;
+    bbopts_init(&opts);
+    bbstats stats;
+    int block_len = bbsearch_opts(graph, 2, -1, &opts, &stats);
+    assert(block_len == 9);
+    assert(stats.blocks == 3);
+    // both two task blocks fit on two machines
+    assert(stats.width_closed == 2);
+    block_len = bbsearch_opts(graph, 1, -1, &opts, &stats);
+    assert(block_len == 15);
+    assert(stats.width_closed == 0);
+    opts.decompose = 0;
+    block_len = bbsearch_opts(graph, 2, -1, &opts, &stats);
+    assert(block_len == 9);
+    assert(stats.blocks == 1);
+    (void) block_len;
+
+    // the best schedule comes back with its start times and machines
+    schedule *best_sched = NULL;
+    opts.decompose = 1;
+    int best_len = bbsearch_best(graph, 2, -1, &opts, &best_sched, NULL);
+    assert(best_len == 9);
+    assert(best_sched != NULL && schedule_is_complete(best_sched));
+    assert(schedule_length(best_sched) == 9);
+    unsigned starts[dag_size(graph)];
+    unsigned machines[dag_size(graph)];
+    err = schedule_assign(best_sched, starts, machines);
+    assert(err == 0);
+    assert(starts[a] == 0 && starts[b] == 0 && machines[a] != machines[b]);
+    assert(starts[c] == 3 && starts[d] == 4 && starts[e] == 4);
+    assert(schedule_verify(best_sched, starts, machines) == 1);
+    // a task started before its predecessor ends
+    starts[e] = 3;
+    assert(schedule_verify(best_sched, starts, machines) == 0);
+    // two tasks overlapping on one machine
+    starts[e] = 4;
+    machines[e] = machines[d];
+    assert(schedule_verify(best_sched, starts, machines) == 0);
+    machines[e] = 2;
+    assert(schedule_verify(best_sched, starts, machines) == 0);
+    (void) best_len;
+    (void) starts;
+    (void) machines;
+    schedule_destroy(best_sched);
+    dag_destroy(graph);
+
+    // this dag packs into its critical path of 18 on four machines,
+    // where the greedy schedule takes 19, so no root bound may exceed
+    // 18. Fujita's search once started above the critical path and
+    // returned 19 here, which pruned the optimum. The reverse agrees.
+    err = parse_patterson("series/data1401/Pat3.rcp", &graph);
+    assert(err == 0);
+    assert(dag_level(graph, dag_source(graph)) == 18);
+    assert(bbsearch_root_bound(graph, 4) == 18);
+    bbopts pack_opts;
+    bbopts_init(&pack_opts);
+    bbstats pack_stats;
+    int pack_len = bbsearch_opts(graph, 4, -1, &pack_opts, &pack_stats);
+    assert(pack_len == 18);
+    assert(pack_stats.root_closed == 0 && pack_stats.nodes > 0);
+    pack_opts.bounds = BOUND_FUJITA;
+    pack_len = bbsearch_opts(graph, 4, -1, &pack_opts, NULL);
+    assert(pack_len == 18);
+    pack_opts.bounds = BOUND_CHEAP | BOUND_FUJITA;
+    pack_opts.direction = DIRECTION_REVERSE;
+    pack_len = bbsearch_opts(graph, 4, -1, &pack_opts, NULL);
+    assert(pack_len == 18);
+    // a portfolio's schedule may come from any of its searches
+    pack_opts.direction = DIRECTION_FORWARD;
+    pack_opts.portfolio = 1;
+    schedule *pack_best = NULL;
+    pack_len = bbsearch_best(graph, 4, -1, &pack_opts, &pack_best, NULL);
+    assert(pack_len == 18);
+    assert(schedule_length(pack_best) == 18);
+    schedule_destroy(pack_best);
+    (void) pack_len;
+    dag_destroy(graph);
+
+    unsigned bounds;
+    err = bound_parse("none", &bounds);
+    assert(err == 0 && bounds == 0);
+    err = bound_parse("fujita,cheap", &bounds);
+    assert(err == 0);
+    assert(bounds == (BOUND_FUJITA | BOUND_CHEAP));
+    err = bound_parse("cheap,bogus", &bounds);
+    assert(err == -1);
+    branch_policy policy;
+    err = branch_parse("slack", &policy);
+    assert(err == 0 && policy == BRANCH_SLACK);
+    err = branch_parse("bogus", &policy);
+    assert(err == -1);
+    assert(strcmp(branch_policy_name(BRANCH_SUCCS), "succs") == 0);
+    search_driver driver;
+    err = driver_parse("lds", &driver);
+    assert(err == 0 && driver == SEARCH_LDS);
+    err = driver_parse("bogus", &driver);
+    assert(err == -1);
+    assert(strcmp(search_driver_name(SEARCH_RESTARTS), "restarts") == 0);
+    search_direction direction;
+    err = direction_parse("race", &direction);
+    assert(err == 0 && direction == DIRECTION_RACE);
+    err = direction_parse("bogus", &direction);
+    assert(err == -1);
+    assert(strcmp(search_direction_name(DIRECTION_AUTO), "auto") == 0);
+}
+
+// returns the next number of a small deterministic generator, so the
+// random dags below do not depend on the C library.
+static unsigned test_rand(uint64_t *state) {
+    *state = *state * 6364136223846793005ull + 1442695040888963407ull;
+    return *state >> 33;
+}
+
+// returns the shortest list schedule of `g' on `m' machines over all
+// orders of its tasks that respect precedence and start with the
+// `len' tasks of `order', which are marked in `placed'.
+static int brute_force(dag *g, unsigned m, unsigned *order, size_t len,
+                       char *placed) {
+    size_t size = dag_size(g);
+    if (len == size) {
+        return bbsearch_order_length(g, m, order);
+    }
+    int best = INT_MAX;
+    for (unsigned i = 1; i < size; i++) {
+        if (placed[i]) {
+            continue;
+        }
+        unsigned preds[size];
+        size_t npreds = dag_npreds(g, i);
+        dag_preds(g, i, preds);
+        size_t j = 0;
+        while (j < npreds && placed[preds[j]]) {
+            j++;
+        }
+        if (j < npreds) {
+            continue;
+        }
+        placed[i] = 1;
+        order[len] = i;
+        int length = brute_force(g, m, order, len + 1, placed);
+        best = (length < best) ? length : best;
+        placed[i] = 0;
+    }
+    return best;
+}
+
+void test_dominance(void) {
+    printf("Testing dominance\n");
+    // small random dags with few distinct weights, so that many pairs
+    // of tasks are interchangeable and the dominance rule prunes often.
+    // Without the dynamic program, the searches must match every order.
+    uint64_t state = 1;
+    bbopts opts;
+    bbopts_init(&opts);
+    opts.dp = 0;
+    int searched = 0;
+    for (int trial = 0; trial < 150; trial++) {
+        dag *g = dag_create();
+        assert(g != NULL);
+        unsigned n = 3 + test_rand(&state) % 5;
+        for (unsigned i = 1; i <= n; i++) {
+            unsigned deps[n];
+            size_t ndeps = 0;
+            for (unsigned j = 1; j < i; j++) {
+                if (test_rand(&state) % 3 == 0) {
+                    deps[ndeps++] = j;
+                }
+            }
+            dag_vertex(g, 1 + test_rand(&state) % 3, ndeps, deps);
+        }
+        int err = dag_build(g);
+        assert(err == 0);
+        uint64_t hash = dag_hash(g);
+        size_t size = dag_size(g);
+        unsigned order[size];
+        char placed[size];
+        memset(placed, 0, size);
+        order[0] = dag_source(g);
+        placed[dag_source(g)] = 1;
+        for (unsigned m = 1; m <= 3; m++) {
+            int optimum = brute_force(g, m, order, 1, placed);
+            bbstats stats;
+            int result = bbsearch_opts(g, m, -1, &opts, &stats);
+            assert(result == optimum);
+            searched += stats.nodes > 0;
+            (void) result;
+            (void) optimum;
+        }
+        // the searches reduced a copy, not the dag itself
+        assert(!dag_has_closure(g) && dag_hash(g) == hash);
+        dag_destroy(g);
+        (void) err;
+        (void) hash;
+    }
+    assert(searched > 0);
+    (void) searched;
+}
+
+void test_width(void) {
+    printf("Testing width\n");
+    // the matching against the largest antichain of random dags, found
+    // by trying every set of tasks
+    uint64_t state = 7;
+    for (int trial = 0; trial < 200; trial++) {
+        dag *g = dag_create();
+        assert(g != NULL);
+        unsigned n = 1 + test_rand(&state) % 12;
+        unsigned density = 2 + test_rand(&state) % 5;
+        for (unsigned i = 1; i <= n; i++) {
+            unsigned deps[n];
+            size_t ndeps = 0;
+            for (unsigned j = 1; j < i; j++) {
+                if (test_rand(&state) % density == 0) {
+                    deps[ndeps++] = j;
+                }
+            }
+            dag_vertex(g, 1, ndeps, deps);
+        }
+        int err = dag_build(g);
+        assert(err == 0);
+        err = dag_closure(g);
+        assert(err == 0);
+        size_t largest = 0;
+        for (unsigned set = 1; set < 1u << n; set++) {
+            int antichain = 1;
+            for (unsigned i = 1; i <= n && antichain; i++) {
+                for (unsigned j = i + 1; j <= n && antichain; j++) {
+                    antichain = !(set >> (i - 1) & set >> (j - 1) & 1)
+                        || !dag_reaches(g, i, j);
+                }
+            }
+            size_t count = __builtin_popcount(set);
+            if (antichain && count > largest) {
+                largest = count;
+            }
+        }
+        assert(dag_width(g) == largest);
+        dag_destroy(g);
+        (void) err;
+        (void) largest;
+    }
 }
 
 void test_parser(void) {
@@ -294,6 +993,598 @@ void test_parser(void) {
     dag_preds(g, 3, &pred);
     assert(pred == 2);
     dag_destroy(g);
+
+    // successors must come later in the file
+    FILE *f = fopen("parser_test.tmp", "w");
+    assert(f != NULL);
+    fprintf(f, "4 0\n\n0 1 2\n1 1 3\n1 1 2\n0 0\n");
+    fclose(f);
+    err = parse_patterson("parser_test.tmp", &g);
+    assert(err == -1);
+    (void) err;
+    remove("parser_test.tmp");
+}
+
+// returns the machine bound of the built schedule `s' straight from
+// its definition, over every pair of distinct window times.
+static int naive_machine_bound(schedule *s) {
+    dag *g = schedule_dag(s);
+    size_t size = dag_size(g);
+    unsigned times[2 * size];
+    size_t ntimes = 0;
+    for (size_t k = 0; k < 2 * size; k++) {
+        unsigned t = (k < size) ? schedule_max_start(s, k) :
+            schedule_min_end(s, k - size);
+        size_t j = 0;
+        while (j < ntimes && times[j] != t) {
+            j++;
+        }
+        if (j == ntimes) {
+            times[ntimes++] = t;
+        }
+    }
+    int max_m = INT_MIN;
+    for (size_t i = 0; i < ntimes; i++) {
+        for (size_t j = 0; j < ntimes; j++) {
+            unsigned ci = times[i], cj = times[j];
+            if (ci >= cj) {
+                continue;
+            }
+            int density = 0;
+            for (size_t k = 0; k < size; k++) {
+                int start = schedule_max_start(s, k);
+                int end = schedule_min_end(s, k);
+                if ((unsigned) start < cj && (unsigned) end > ci) {
+                    int d = dag_weight(g, k);
+                    d = (end - (int) ci < d) ? end - (int) ci : d;
+                    d = ((int) cj - start < d) ? (int) cj - start : d;
+                    d = ((int) (cj - ci) < d) ? (int) (cj - ci) : d;
+                    density += d;
+                }
+            }
+            int m = density / (cj - ci) + (density % (cj - ci) != 0);
+            max_m = (m > max_m) ? m : max_m;
+        }
+    }
+    return max_m;
+}
+
+void test_gen(void) {
+    printf("Testing generator\n");
+    genopts opts;
+    genopts_init(&opts);
+    opts.n = 12;
+    opts.width = 3;
+    opts.density = 1;
+    opts.min_weight = 2;
+    opts.max_weight = 5;
+    FILE *f = fopen("gen_test.tmp", "w");
+    assert(f != NULL);
+    int err = gen_patterson(f, &opts);
+    assert(err == 0);
+    fclose(f);
+    dag *g;
+    err = parse_patterson("gen_test.tmp", &g);
+    assert(err == 0);
+    assert(dag_size(g) == 14);
+    for (unsigned i = 1; i <= 12; i++) {
+        assert(dag_weight(g, i) >= 2 && dag_weight(g, i) <= 5);
+    }
+    // at density 1 only the pairs within a layer are unordered
+    err = dag_closure(g);
+    assert(err == 0);
+    size_t ordered = 0;
+    for (unsigned i = 1; i <= 12; i++) {
+        for (unsigned j = i + 1; j <= 12; j++) {
+            ordered += dag_reaches(g, i, j);
+            assert(dag_reaches(g, i, j) == ((i - 1) / 3 < (j - 1) / 3));
+        }
+    }
+    assert(ordered == 54);
+    assert(gen_width(12, 54.0 / 66) == 3);
+    (void) ordered;
+    dag_destroy(g);
+
+    // at density 0 every task has exactly one predecessor, in the
+    // layer before it
+    opts.density = 0;
+    f = fopen("gen_test.tmp", "w");
+    assert(f != NULL);
+    err = gen_patterson(f, &opts);
+    assert(err == 0);
+    fclose(f);
+    err = parse_patterson("gen_test.tmp", &g);
+    assert(err == 0);
+    for (unsigned i = 4; i <= 12; i++) {
+        unsigned pred;
+        assert(dag_npreds(g, i) == 1);
+        dag_preds(g, i, &pred);
+        assert((pred - 1) / 3 + 1 == (i - 1) / 3);
+        (void) pred;
+    }
+    dag_destroy(g);
+
+    // a dag whose search outlasts the first restart and the first
+    // discrepancy passes
+    opts.n = 30;
+    opts.width = 6;
+    opts.density = 0.3;
+    opts.min_weight = 1;
+    opts.max_weight = 10;
+    opts.seed = 7;
+    f = fopen("gen_test.tmp", "w");
+    assert(f != NULL);
+    err = gen_patterson(f, &opts);
+    assert(err == 0);
+    fclose(f);
+    err = parse_patterson("gen_test.tmp", &g);
+    assert(err == 0);
+    int optimum = bbsearch(g, 3, -1);
+    assert(optimum > 0);
+    bbopts search_opts;
+    bbopts_init(&search_opts);
+    bbstats stats;
+    for (int driver = SEARCH_LDS; driver < N_SEARCH_DRIVERS; driver++) {
+        search_opts.driver = driver;
+        int result = bbsearch_opts(g, 3, -1, &search_opts, &stats);
+        assert(result == optimum);
+        assert(stats.passes > 1);
+        (void) result;
+    }
+
+    // beam search never does worse than the greedy schedule, and its
+    // result does not depend on the number of threads
+    unsigned order[dag_size(g)];
+    unsigned bound;
+    int beam = bbsearch_beam(g, 3, 8, &search_opts, order, &bound, NULL);
+    assert(beam >= optimum && (unsigned) optimum >= bound);
+    schedule *greedy = schedule_create(g, 3);
+    schedule_add(greedy, dag_source(g));
+    schedule_complete_greedy(greedy);
+    schedule_build(greedy, 0);
+    assert(beam <= (int) schedule_length(greedy));
+    schedule_destroy(greedy);
+    search_opts.threads = 3;
+    int threaded = bbsearch_beam(g, 3, 8, &search_opts, NULL, NULL, NULL);
+    assert(threaded == beam);
+    (void) threaded;
+    (void) beam;
+    (void) bound;
+    (void) optimum;
+    dag_destroy(g);
+
+    // the packed variants for up to 64, 128 and 256 tasks, the general
+    // loop beyond that, and the general loop for times too large for
+    // 16 bits all give the bound its definition gives
+    size_t sizes[] = { 40, 100, 200, 300, 40 };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(*sizes); i++) {
+        opts.n = sizes[i];
+        opts.width = 25;
+        opts.density = 0.1;
+        opts.min_weight = (i == 4) ? 20000 : 1;
+        opts.max_weight = (i == 4) ? 20003 : 3;
+        opts.seed = i + 1;
+        f = fopen("gen_test.tmp", "w");
+        assert(f != NULL);
+        err = gen_patterson(f, &opts);
+        assert(err == 0);
+        fclose(f);
+        err = parse_patterson("gen_test.tmp", &g);
+        assert(err == 0);
+        schedule *s = schedule_create(g, 4);
+        schedule_add(s, dag_source(g));
+        schedule_complete_greedy(s);
+        // a partial schedule, against a deadline past its critical path
+        while (schedule_size(s) > sizes[i] / 2) {
+            schedule_pop(s);
+        }
+        schedule_build(s, dag_level(g, dag_source(g)) + 5);
+        assert(schedule_machine_bound(s) == naive_machine_bound(s));
+        schedule_destroy(s);
+        dag_destroy(g);
+    }
+    (void) err;
+    remove("gen_test.tmp");
+}
+
+void test_bbsched(void) {
+    printf("Testing bbsched\n");
+    assert(bbsched_version() == BBSCHED_VERSION);
+    // five independent tasks of lengths 3, 3, 2, 2, 2 fit in 6 on two
+    // machines
+    int weights[] = { 3, 3, 2, 2, 2 };
+    bbsched_dag *g = bbsched_from_arrays(5, weights, 0, NULL, NULL);
+    assert(g != NULL);
+    assert(bbsched_ntasks(g) == 5);
+    bbsched_opts opts;
+    bbsched_opts_init(&opts, sizeof(opts));
+    bbsched_result res = {.size = sizeof(res)};
+    unsigned starts[5];
+    unsigned machines[5];
+    int makespan = bbsched_solve(g, 2, &opts, &res, starts, machines);
+    assert(makespan == 6);
+    assert(res.makespan == 6);
+    unsigned load[2] = { 0, 0 };
+    for (int i = 0; i < 5; i++) {
+        assert(machines[i] < 2 && starts[i] + weights[i] <= 6);
+        load[machines[i]] += weights[i];
+    }
+    assert(load[0] == 6 && load[1] == 6);
+    // the same dag again, on three machines and by beam search
+    makespan = bbsched_solve(g, 3, &opts, &res, NULL, NULL);
+    assert(makespan == 5);
+    opts.beam = 4;
+    makespan = bbsched_solve(g, 2, &opts, &res, NULL, NULL);
+    assert(makespan == 6);
+    assert(res.bound == 6);
+    opts.bounds = "nope";
+    makespan = bbsched_solve(g, 2, &opts, &res, NULL, NULL);
+    assert(makespan == -1);
+    // a beam search is not cached, and a cache that cannot be written
+    // fails the solve
+    opts.bounds = NULL;
+    opts.cache = ".";
+    makespan = bbsched_solve(g, 2, &opts, &res, NULL, NULL);
+    assert(makespan == -1);
+    opts.beam = 0;
+    opts.cache = "no/such/dir";
+    makespan = bbsched_solve(g, 2, &opts, &res, NULL, NULL);
+    assert(makespan == -1);
+    // nor is a beam search raced
+    opts.cache = NULL;
+    opts.portfolio = 1;
+    makespan = bbsched_solve(g, 2, &opts, &res, NULL, NULL);
+    assert(makespan == 6);
+    opts.beam = 4;
+    makespan = bbsched_solve(g, 2, &opts, &res, NULL, NULL);
+    assert(makespan == -1);
+    bbsched_free(g);
+
+    // a chain 0 -> 1 -> 2, and an edge that goes backwards
+    unsigned from[] = { 0, 1 };
+    unsigned to[] = { 1, 2 };
+    g = bbsched_from_arrays(3, weights, 2, from, to);
+    assert(g != NULL);
+    bbsched_opts_init(&opts, sizeof(opts));
+    makespan = bbsched_solve(g, 2, &opts, &res, starts, machines);
+    assert(makespan == 8);
+    assert(starts[0] == 0 && starts[1] == 3 && starts[2] == 6);
+    // bad arguments fail instead of crashing
+    makespan = bbsched_solve(g, 0, &opts, &res, NULL, NULL);
+    assert(makespan == -1 && res.makespan == -1);
+    makespan = bbsched_solve(NULL, 2, &opts, &res, NULL, NULL);
+    assert(makespan == -1);
+    makespan = bbsched_solve(g, 2, NULL, &res, NULL, NULL);
+    assert(makespan == -1);
+    makespan = bbsched_solve(g, 2, &opts, NULL, NULL, NULL);
+    assert(makespan == -1);
+    // a caller whose structs end before the fields appended since gets
+    // the defaults for them, and no writes past its result
+    opts.cache = "no/such/dir";
+    bbsched_opts_init(&opts, offsetof(bbsched_opts, cache));
+    size_t old_size = offsetof(bbsched_result, dp_closed);
+    res.size = old_size;
+    res.dp_closed = 12345;
+    makespan = bbsched_solve(g, 2, &opts, &res, NULL, NULL);
+    assert(makespan == 8 && res.size == old_size && res.dp_closed == 12345);
+    res.size = sizeof(res);
+    // structs that end before the fields of the first version fail
+    bbsched_opts_init(&opts, offsetof(bbsched_opts, threads));
+    makespan = bbsched_solve(g, 2, &opts, &res, NULL, NULL);
+    assert(makespan == -1);
+    bbsched_opts_init(&opts, sizeof(opts));
+    res.size = sizeof(res.size);
+    makespan = bbsched_solve(g, 2, &opts, &res, NULL, NULL);
+    assert(makespan == -1);
+    res.size = sizeof(res);
+    bbsched_free(g);
+    assert(bbsched_from_arrays(3, weights, 2, to, from) == NULL);
+    int negative[] = {2, -1, 3};
+    assert(bbsched_from_arrays(3, negative, 2, from, to) == NULL);
+    (void) negative;
+
+    g = bbsched_load("test.rcp");
+    assert(g != NULL && bbsched_ntasks(g) == 5);
+    bbsched_free(g);
+    (void) load;
+    (void) makespan;
+    (void) old_size;
+}
+
+// builds a dag of tasks a and b before c, listing c's predecessors in
+// either order, and with a redundant edge a -> d if `extra'.
+static dag *cache_test_dag(int swap, int extra) {
+    dag *g = dag_create();
+    unsigned a = dag_vertex(g, 2, 0, NULL);
+    unsigned b = dag_vertex(g, 3, 0, NULL);
+    unsigned c_deps[] = { swap ? b : a, swap ? a : b };
+    unsigned c = dag_vertex(g, 4, 2, c_deps);
+    unsigned d_deps[] = { c, a };
+    dag_vertex(g, 1, extra ? 2 : 1, d_deps);
+    int err = dag_build(g);
+    assert(err == 0);
+    (void) err;
+    return g;
+}
+
+void test_cache(void) {
+    printf("Testing cache\n");
+    dag *a = cache_test_dag(0, 0);
+    dag *b = cache_test_dag(1, 0);
+    dag *c = cache_test_dag(0, 1);
+    assert(dag_hash(a) == dag_hash(b));
+    assert(dag_hash(a) != dag_hash(c));
+    // the cache keys on the reduced dag, without the redundant edge
+    int err = dag_closure(c);
+    assert(err == 0);
+    assert(dag_hash(a) == dag_hash(c));
+    dag_destroy(a);
+    dag_destroy(b);
+    dag_destroy(c);
+
+    dag *g;
+    err = parse_patterson("test.rcp", &g);
+    assert(err == 0);
+    size_t size = dag_size(g);
+    bbopts opts;
+    bbopts_init(&opts);
+    cache_entry e;
+    err = dag_closure(g);
+    assert(err == 0);
+    e.hash = dag_hash(g);
+    e.m = 2;
+    cache_config(&opts, e.config, sizeof(e.config));
+    char path[64];
+    cache_path(".", e.hash, e.m, e.config, path, sizeof(path));
+    remove(path);
+
+    // a miss is searched and stored, and then answered from the cache
+    unsigned order[size];
+    bbstats stats;
+    double seconds;
+    cache_status status;
+    int optimum = bbsearch(g, 2, -1);
+    assert(optimum > 0);
+    int result = cache_solve(".", g, 2, -1, &opts, order, &stats, &seconds,
+                             &status);
+    assert(result == optimum && status == CACHE_MISS);
+    unsigned long nodes = stats.nodes;
+    result = cache_solve(".", g, 2, -1, &opts, order, &stats, &seconds,
+                         &status);
+    assert(result == optimum && status == CACHE_HIT);
+    assert(stats.nodes == nodes);
+    cache_entry read;
+    err = cache_lookup(".", e.hash, 2, e.config, &read);
+    assert(err == 0);
+    assert(read.optimal && read.makespan == (unsigned) optimum);
+    assert(read.order_len == size);
+    assert(memcmp(read.order, order, size * sizeof(*order)) == 0);
+    cache_entry_destroy(&read);
+    // other options are another instance
+    bbopts other = opts;
+    other.branch = BRANCH_WEIGHT;
+    char config[128];
+    cache_config(&other, config, sizeof(config));
+    assert(strcmp(config, e.config) != 0);
+    err = cache_lookup(".", e.hash, 2, config, &read);
+    assert(err == -1);
+
+    // a time out is final for searches no longer than it, and a longer
+    // search starts from its schedule
+    unsigned identity[size];
+    for (size_t i = 0; i < size; i++) {
+        identity[i] = i;
+    }
+    e.optimal = 0;
+    e.makespan = optimum + 5;
+    e.bound = 0;
+    e.timeout = 1;
+    e.seconds = 1;
+    e.order_len = size;
+    e.order = identity;
+    memset(&e.stats, 0, sizeof(e.stats));
+    err = cache_store(".", &e);
+    assert(err == 0);
+    result = cache_solve(".", g, 2, 1, &opts, order, &stats, &seconds,
+                         &status);
+    assert(result == -2 && status == CACHE_HIT && seconds == 1);
+    assert(memcmp(order, identity, size * sizeof(*order)) == 0);
+    result = cache_solve(".", g, 2, -1, &opts, order, &stats, &seconds,
+                         &status);
+    assert(result == optimum && status == CACHE_WARM);
+    result = cache_solve(".", g, 2, 1, &opts, NULL, NULL, NULL, &status);
+    assert(result == optimum && status == CACHE_HIT);
+    remove(path);
+    dag_destroy(g);
+    (void) err;
+    (void) result;
+    (void) nodes;
+}
+
+// returns schedule_verify of the given times, with the tasks ordered
+// by start time.
+static int verify_times(dag *g, unsigned m, const unsigned *starts,
+                        const unsigned *machines) {
+    size_t size = dag_size(g);
+    unsigned order[size];
+    for (size_t i = 0; i < size; i++) {
+        size_t j = i;
+        for (; j > 0 && starts[order[j - 1]] > starts[i]; j--) {
+            order[j] = order[j - 1];
+        }
+        order[j] = i;
+    }
+    schedule *s = schedule_create(g, m);
+    assert(s != NULL);
+    for (size_t i = 0; i < size; i++) {
+        schedule_add(s, order[i]);
+    }
+    int result = schedule_verify(s, starts, machines);
+    schedule_destroy(s);
+    return result;
+}
+
+void test_listsched(void) {
+    printf("Testing listsched\n");
+    // the heaviest tasks first leave 3+2+2 on one machine, where 3+3
+    // and 2+2+2 would take 6
+    dag *g = dag_create();
+    assert(g != NULL);
+    int weights[] = {3, 3, 2, 2, 2};
+    for (int i = 0; i < 5; i++) {
+        dag_vertex(g, weights[i], 0, NULL);
+    }
+    int err = dag_build(g);
+    assert(err == 0);
+    size_t size = dag_size(g);
+    unsigned starts[size];
+    unsigned machines[size];
+    int length = list_schedule(g, 2, LIST_WEIGHT, starts, machines);
+    assert(length == 7);
+    assert(verify_times(g, 2, starts, machines) == 1);
+    int optimum = bbsearch(g, 2, -1);
+    assert(optimum == 6);
+    dag_destroy(g);
+
+    // every rule gives a feasible schedule no shorter than the optimum
+    err = parse_patterson("series/data1201/Pat0.rcp", &g);
+    assert(err == 0);
+    optimum = bbsearch(g, 4, -1);
+    size = dag_size(g);
+    unsigned big_starts[size];
+    unsigned big_machines[size];
+    for (int rule = 0; rule < N_LIST_RULES; rule++) {
+        int makespan = list_schedule(g, 4, rule, big_starts, big_machines);
+        assert(makespan >= optimum);
+        assert(makespan == (int) big_starts[dag_sink(g)]);
+        assert(verify_times(g, 4, big_starts, big_machines) == 1);
+        (void) makespan;
+    }
+    dag_destroy(g);
+
+    list_rule rule;
+    err = list_rule_parse("succs", &rule);
+    assert(err == 0 && rule == LIST_SUCCS);
+    err = list_rule_parse("bogus", &rule);
+    assert(err == -1);
+    assert(strcmp(list_rule_name(LIST_LEVEL), "level") == 0);
+    (void) length;
+    (void) optimum;
+    (void) err;
+}
+
+void test_dp(void) {
+    printf("Testing dp\n");
+    dag *g;
+    int err = parse_patterson("series/data1201/Pat1.rcp", &g);
+    assert(err == 0);
+    size_t size = dag_size(g);
+    unsigned order[size];
+    dplimits limits = {.do_timeout = 0, .cancel = NULL,
+                       .max_labels = SIZE_MAX};
+    bbopts opts;
+    bbopts_init(&opts);
+    opts.dp = 0;
+    for (unsigned m = 2; m <= 4; m++) {
+        int optimum = bbsearch_opts(g, m, -1, &opts, NULL);
+        unsigned long labels = 0;
+        int result = dp_solve(g, m, optimum + 1, &limits, order, &labels);
+        assert(result == optimum && labels > 0);
+        assert(order[0] == dag_source(g));
+        assert(bbsearch_order_length(g, m, order) == optimum);
+        // nothing beats the optimum
+        result = dp_solve(g, m, optimum, &limits, order, NULL);
+        assert(result == optimum);
+        (void) result;
+    }
+    // gives up rather than exceed its labels
+    limits.max_labels = 1;
+    err = dp_solve(g, 4, UINT_MAX, &limits, order, NULL);
+    assert(err == -3);
+
+    // a short search leaves the dag open, and the program closes it
+    bbstats stats;
+    bbopts_init(&opts);
+    int result = bbsearch_opts(g, 4, -1, &opts, &stats);
+    assert(result == 22 && stats.dp_closed == 1);
+    opts.dp = 0;
+    result = bbsearch_opts(g, 4, -1, &opts, &stats);
+    assert(result == 22 && stats.dp_closed == 0);
+    dag_destroy(g);
+    (void) result;
+    (void) err;
+}
+
+void test_tuning(void) {
+    printf("Testing tuning\n");
+    // a -> b -> c next to d: a width of 2, and 3 of the 6 pairs ordered
+    dag *g = dag_create();
+    assert(g != NULL);
+    unsigned a = dag_vertex(g, 1, 0, NULL);
+    unsigned b = dag_vertex(g, 2, 1, &a);
+    dag_vertex(g, 3, 1, &b);
+    dag_vertex(g, 4, 0, NULL);
+    int err = dag_build(g);
+    assert(err == 0);
+    features f;
+    err = features_compute(g, 1, &f);
+    assert(err == 0);
+    assert(f.n == 4 && f.width == 2);
+    assert(f.strength == 0.5 && f.ratio == 0.5);
+
+    // the width shortcut for two machines, the dynamic program for one
+    tuning *t = tuning_default();
+    assert(t != NULL && tuning_size(t) == 4);
+    assert(tuning_match(t, &f) == 2);
+    engine e;
+    bbopts opts;
+    bbopts_init(&opts);
+    tuning_apply(tuning_rule_get(t, 2), 4, &e, &opts);
+    assert(e == ENGINE_SEARCH && opts.driver == SEARCH_DFS && opts.dp);
+    err = features_compute(g, 2, &f);
+    assert(err == 0 && f.ratio == 1);
+    assert(tuning_match(t, &f) == 1);
+    // without a width, only rules on the size match
+    features huge = {.n = 1 << 20};
+    assert(tuning_match(t, &huge) == 0);
+    tuning_apply(tuning_rule_get(t, 0), 4, &e, &opts);
+    assert(e == ENGINE_HEURISTIC);
+    tuning_destroy(t);
+
+    FILE *file = fopen("rules_test.tmp", "w");
+    assert(file != NULL);
+    fprintf(file, "# a comment\n\n"
+            "n=..3 engine=heuristic\n"
+            "strength=0.4..0.6 ratio=..0.8 bounds=cheap,fernandez "
+            "search=lds dp=0 threads=2 # racing\n");
+    fclose(file);
+    t = tuning_read("rules_test.tmp");
+    assert(t != NULL && tuning_size(t) == 2);
+    assert(tuning_match(t, &f) == -1);
+    err = features_compute(g, 1, &f);
+    assert(err == 0);
+    assert(tuning_match(t, &f) == 1);
+    tuning_apply(tuning_rule_get(t, 1), 1, &e, &opts);
+    assert(e == ENGINE_SEARCH && opts.driver == SEARCH_LDS && !opts.dp);
+    assert(opts.bounds == (BOUND_CHEAP | BOUND_FERNANDEZ));
+    assert(opts.direction == DIRECTION_FORWARD && !opts.portfolio);
+    tuning_apply(tuning_rule_get(t, 1), 4, &e, &opts);
+    assert(opts.direction == DIRECTION_RACE && !opts.portfolio);
+    tuning_destroy(t);
+
+    const char *bad[] = {"n=5..2\n", "n=1\n", "speed=1\n",
+                         "threads=0\n", "engine=magic\n", "ratio=1.x..\n"};
+    for (size_t i = 0; i < sizeof(bad) / sizeof(*bad); i++) {
+        file = fopen("rules_test.tmp", "w");
+        assert(file != NULL);
+        fputs(bad[i], file);
+        fclose(file);
+        assert(tuning_read("rules_test.tmp") == NULL);
+    }
+    remove("rules_test.tmp");
+    assert(tuning_read("rules_test.tmp") == NULL);
+    dag_destroy(g);
+    (void) err;
 }
 
 void test_bitmap(void) {
@@ -341,6 +1632,25 @@ void test_bitmap(void) {
     bitmap_set(bm, 10000, 1);
     assert(bitmap_get(bm, 10000) == 1);
 
+    bitmap *other = bitmap_create(0);
+    assert(bitmap_is_subset(other, bm));
+    assert(!bitmap_intersects(other, bm));
+    bitmap_set(other, 5, 1);
+    assert(!bitmap_is_subset(other, bm));
+    int err = bitmap_or(other, bm);
+    assert(err == 0);
+    assert(bitmap_is_subset(bm, other));
+    assert(bitmap_intersects(other, bm));
+    assert(bitmap_count(other) == 2);
+    assert(bitmap_next_diff(other, bm, 0) == 5);
+    assert(bitmap_next_diff(other, bm, 6) == -1);
+    bitmap_clear(bm);
+    assert(bitmap_count(bm) == 0);
+    assert(bitmap_next_diff(other, bm, 6) == 10000);
+    assert(bitmap_next_diff(other, bm, 10001) == -1);
+    bitmap_destroy(other);
+    (void) err;
+
     bitmap_destroy(bm);
 }
 
@@ -367,6 +1677,8 @@ void test_binheap(void) {
 
     assert(binheap_size(heap) == 5);
 
+    assert(binheap_peek(heap) == 9);
+    assert(binheap_size(heap) == 5);
     assert(binheap_get(heap) == 9);
     assert(binheap_get(heap) == 3);
     assert(binheap_get(heap) == 1);
@@ -377,13 +1689,163 @@ void test_binheap(void) {
     binheap_destroy(heap);
 }
 
+void test_bucketq(void) {
+    printf("Testing bucketq\n");
+    bucketq *q = bucketq_create(200);
+    assert(q != NULL);
+
+    assert(bucketq_size(q) == 0);
+    assert(bucketq_get(q) == (unsigned) -1);
+
+    unsigned prios[] = {0, 3, 180, 5, 12, 14, 16, 5, 2, 180};
+    for (unsigned i = 0; i < 10; i++) {
+        int err = bucketq_put(q, i, prios[i]);
+        assert(err == 0);
+    }
+
+    assert(bucketq_size(q) == 10);
+
+    // ties come out in insertion order
+    assert(bucketq_get(q) == 2);
+    assert(bucketq_get(q) == 9);
+    assert(bucketq_get(q) == 6);
+    assert(bucketq_get(q) == 5);
+    assert(bucketq_get(q) == 4);
+
+    assert(bucketq_size(q) == 5);
+
+    // interleave puts and gets
+    int err = bucketq_put(q, 10, 4);
+    assert(err == 0);
+    err = bucketq_put(q, 11, 200);
+    assert(err == 0);
+    assert(bucketq_get(q) == 11);
+    assert(bucketq_get(q) == 3);
+    assert(bucketq_get(q) == 7);
+    assert(bucketq_get(q) == 10);
+    assert(bucketq_get(q) == 1);
+    assert(bucketq_get(q) == 8);
+    assert(bucketq_get(q) == 0);
+
+    assert(bucketq_size(q) == 0);
+
+    bucketq_put(q, 1, 1);
+    bucketq_put(q, 2, 2);
+    bucketq_clear(q);
+    assert(bucketq_size(q) == 0);
+    assert(bucketq_get(q) == (unsigned) -1);
+    bucketq_destroy(q);
+
+    unsigned vals[] = {70, 3, 3, 0, 129, 64, 70, 1};
+    size_t n = bucket_sort_unique(vals, 8);
+    assert(n == 6);
+    assert(vals[0] == 0);
+    assert(vals[1] == 1);
+    assert(vals[2] == 3);
+    assert(vals[3] == 64);
+    assert(vals[4] == 70);
+    assert(vals[5] == 129);
+    (void) err;
+}
+
+void test_profile(void) {
+    printf("Testing profile\n");
+    profile *p = profile_create(3);
+    assert(p != NULL);
+    assert(profile_m(p) == 3);
+    assert(profile_nruns(p) == 1);
+    assert(profile_earliest(p) == 0);
+    assert(profile_latest(p) == 0);
+
+    unsigned start = profile_place(p, 0, 5);
+    assert(start == 0);
+    start = profile_place(p, 0, 2);
+    assert(start == 0);
+    assert(profile_nruns(p) == 3);
+    assert(profile_earliest(p) == 0);
+    assert(profile_latest(p) == 5);
+    // waits for time 4 on the machine free at 2, not the one free at 0
+    start = profile_place(p, 4, 1);
+    assert(start == 4);
+    assert(profile_nruns(p) == 2);
+    assert(profile_earliest(p) == 0);
+    assert(profile_load(p) == 10);
+    start = profile_place(p, 6, 1);
+    assert(start == 6);
+    assert(profile_latest(p) == 7);
+    start = profile_place(p, 0, 3);
+    assert(start == 0);
+    assert(profile_earliest(p) == 3);
+
+    // the same free times reached in a different order
+    profile *q = profile_create(3);
+    start = profile_place(q, 0, 3);
+    assert(start == 0);
+    start = profile_place(q, 0, 7);
+    assert(start == 0);
+    assert(!profile_equal(p, q));
+    assert(profile_dominates(q, p));
+    assert(!profile_dominates(p, q));
+    start = profile_place(q, 0, 5);
+    assert(start == 0);
+    assert(profile_equal(p, q));
+    assert(profile_hash(p) == profile_hash(q));
+    assert(profile_dominates(p, q) && profile_dominates(q, p));
+
+    profile_reset(q);
+    assert(profile_nruns(q) == 1);
+    assert(profile_latest(q) == 0);
+    assert(profile_dominates(q, p));
+    profile_copy(q, p);
+    assert(profile_equal(p, q));
+
+    unsigned times[3];
+    profile_times(p, times);
+    assert(times[0] == 3 && times[1] == 5 && times[2] == 7);
+    profile_reset(q);
+    profile_set_times(q, times);
+    assert(profile_equal(p, q));
+    assert(profile_load(q) == 15);
+
+    profile_destroy(p);
+    profile_destroy(q);
+
+    // many machines use the binary search
+    p = profile_create(1000);
+    for (unsigned i = 0; i < 1000; i++) {
+        start = profile_place(p, 0, i + 1);
+        assert(start == 0);
+    }
+    assert(profile_nruns(p) == 1000);
+    start = profile_place(p, 500, 1000);
+    assert(start == 500);
+    assert(profile_nruns(p) == 1000);
+    assert(profile_latest(p) == 1500);
+    start = profile_place(p, 0, 1);
+    assert(start == 1);
+    assert(profile_nruns(p) == 999);
+    assert(profile_earliest(p) == 2);
+    profile_destroy(p);
+    (void) start;
+}
+
 int main(void) {
     test_dag();
     test_bitmap();
     test_binheap();
+    test_bucketq();
+    test_profile();
     test_schedule();
     test_bbsearch();
+    test_dominance();
+    test_width();
     test_parser();
+    test_gen();
+    test_listsched();
+    test_dp();
+    test_tuning();
+    test_bbsched();
+    test_cache();
 }
 
 #pragma GCC diagnostic pop
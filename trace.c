@@ -0,0 +1,79 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "trace.h"
+
+struct tracer {
+    FILE *f;
+    trace_event *events;
+    size_t capacity;
+    size_t size;
+    struct timespec start;
+    // set once a write fails; later events are dropped
+    int err;
+};
+
+static uint64_t elapsed_ns(const struct timespec *start) {
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return (uint64_t) (now.tv_sec - start->tv_sec) * 1000000000 +
+        now.tv_nsec - start->tv_nsec;
+}
+
+tracer *tracer_create(const char *path, size_t capacity) {
+    assert(path != NULL);
+    assert(capacity > 0);
+    tracer *t = malloc(sizeof(*t));
+    if (t == NULL) {
+        return NULL;
+    }
+    t->events = malloc(capacity * sizeof(*t->events));
+    t->f = fopen(path, "wb");
+    uint32_t event_size = sizeof(trace_event);
+    if (t->events == NULL || t->f == NULL ||
+        fwrite("BBTRACE1", 8, 1, t->f) != 1 ||
+        fwrite(&event_size, sizeof(event_size), 1, t->f) != 1) {
+        if (t->f != NULL) {
+            fclose(t->f);
+        }
+        free(t->events);
+        free(t);
+        return NULL;
+    }
+    t->capacity = capacity;
+    t->size = 0;
+    t->err = 0;
+    timespec_get(&t->start, TIME_UTC);
+    return t;
+}
+
+// writes out the buffered events.
+static void tracer_flush(tracer *t) {
+    if (!t->err && t->size > 0 &&
+        fwrite(t->events, sizeof(*t->events), t->size, t->f) != t->size) {
+        t->err = 1;
+    }
+    t->size = 0;
+}
+
+int tracer_close(tracer *t) {
+    assert(t != NULL);
+    tracer_flush(t);
+    int err = (fclose(t->f) != 0 || t->err) ? -1 : 0;
+    free(t->events);
+    free(t);
+    return err;
+}
+
+void tracer_add(tracer *t, trace_event event) {
+    assert(t != NULL);
+    event.time = elapsed_ns(&t->start);
+    event.pad = 0;
+    t->events[t->size++] = event;
+    if (t->size == t->capacity) {
+        tracer_flush(t);
+    }
+}
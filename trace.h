@@ -0,0 +1,64 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+// kinds of search events. Every node visited ends with exactly one
+// EXPAND, PRUNE or LEAF event; the PROBE and INCUMBENT events of a
+// node come before it.
+typedef enum trace_kind {
+    // the node was not pruned and its children are tried next
+    TRACE_EXPAND,
+    // a bound stage pruned the node
+    TRACE_PRUNE,
+    // the node is a complete schedule
+    TRACE_LEAF,
+    // the complete schedule became the new incumbent
+    TRACE_INCUMBENT,
+    // a bound stage ran
+    TRACE_PROBE,
+    N_TRACE_KINDS
+} trace_kind;
+
+// one fixed-size trace record, written to the file as is.
+typedef struct trace_event {
+    // nanoseconds since the tracer was created
+    uint64_t time;
+    // the number of tasks scheduled at the node, counting the source,
+    // and the last of them
+    uint32_t depth;
+    uint32_t task;
+    // the bound (PROBE, PRUNE) or makespan (LEAF, INCUMBENT) of the
+    // node, or 0, and the incumbent the node was searched against
+    uint32_t value;
+    uint32_t best;
+    uint8_t kind;
+    // the bound stage of PROBE and PRUNE events
+    uint8_t stage;
+    uint16_t pad;
+    // the series block being searched
+    uint32_t block;
+} trace_event;
+
+// Buffers events in memory and appends them to a file whenever the
+// buffer fills up, so tracing costs a store per event and a write per
+// `capacity' events. A tracer belongs to a single search thread.
+struct tracer;
+typedef struct tracer tracer;
+
+// creates the trace file at `path' and a tracer that buffers
+// `capacity' events before writing them out, or returns NULL on
+// failure. The file starts with the 8 byte magic "BBTRACE1" and the
+// size of an event as a 32 bit integer, followed by the events, in
+// the machine's byte order.
+tracer *tracer_create(const char *path, size_t capacity);
+
+// writes out the buffered events, closes the file and cleans up.
+// Returns 0 on success and -1 if any write failed.
+int tracer_close(tracer *t);
+
+// records an event at the current time.
+void tracer_add(tracer *t, trace_event event);
+
+#endif // TRACE_H
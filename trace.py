@@ -0,0 +1,138 @@
+"""Decode a binary search trace written by bbexps --trace.
+
+usage: python3 trace.py <trace file> [summary|dot|folded] [max nodes]
+
+summary prints event counts, then per depth the nodes, how they ended
+and the mean time per node. dot prints the first `max nodes' (default
+1000) nodes of the search tree as a DOT graph. folded prints one line
+per node with its path of tasks and the nanoseconds since the node
+before it, the input format of flamegraph.pl.
+"""
+
+import struct
+import sys
+
+# must match trace_kind in trace.h and bound_stage in bbsearch.h
+EXPAND, PRUNE, LEAF, INCUMBENT, PROBE = range(5)
+KIND_NAMES = ["expand", "prune", "leaf", "incumbent", "probe"]
+STAGE_NAMES = ["cheap", "fernandez", "fujita"]
+
+# struct trace_event
+EVENT = struct.Struct("=QIIIIBBHI")
+
+def read_events(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[:8] != b"BBTRACE1":
+        sys.exit("{} is not a trace file".format(path))
+    size, = struct.unpack_from("=I", data, 8)
+    if size != EVENT.size:
+        sys.exit("unexpected event size {}".format(size))
+    events = []
+    for offset in range(12, len(data) - size + 1, size):
+        time, depth, task, value, best, kind, stage, _, block = \
+            EVENT.unpack_from(data, offset)
+        events.append((time, depth, task, value, best, kind, stage, block))
+    return events
+
+def read_nodes(events):
+    """Groups the events into nodes: dicts holding the node's terminal
+    event, whether it set a new incumbent, its path of tasks and the
+    time since the node before it."""
+    nodes = []
+    path = []
+    last_time = 0
+    last_block = None
+    incumbent = False
+    for time, depth, task, value, best, kind, stage, block in events:
+        if kind == INCUMBENT:
+            incumbent = True
+            continue
+        if kind == PROBE:
+            continue
+        if block != last_block:
+            path = []
+            last_block = block
+        del path[depth - 1:]
+        path.extend([None] * (depth - 1 - len(path)))
+        path.append(len(nodes))
+        nodes.append({
+            "kind": kind, "depth": depth, "task": task, "value": value,
+            "best": best, "stage": stage, "block": block,
+            "incumbent": incumbent, "path": list(path),
+            "time": time - last_time,
+        })
+        last_time = time
+        incumbent = False
+    return nodes
+
+def summary(events, nodes):
+    counts = [0] * len(KIND_NAMES)
+    for event in events:
+        counts[event[5]] += 1
+    print(", ".join("{}: {}".format(name, count)
+                    for name, count in zip(KIND_NAMES, counts)))
+    if events:
+        print("elapsed: {:.3f} ms".format(events[-1][0] / 1e6))
+    by_depth = {}
+    for node in nodes:
+        row = by_depth.setdefault(node["depth"], {
+            "nodes": 0, "expand": 0, "leaf": 0, "time": 0,
+            "prunes": [0] * len(STAGE_NAMES)})
+        row["nodes"] += 1
+        row["time"] += node["time"]
+        if node["kind"] == EXPAND:
+            row["expand"] += 1
+        elif node["kind"] == LEAF:
+            row["leaf"] += 1
+        elif node["stage"] < len(STAGE_NAMES):
+            row["prunes"][node["stage"]] += 1
+    print("depth nodes expand leaf " +
+          " ".join("prune-" + name for name in STAGE_NAMES) + " mean-us")
+    for depth in sorted(by_depth):
+        row = by_depth[depth]
+        print("{} {} {} {} {} {:.2f}".format(
+            depth, row["nodes"], row["expand"], row["leaf"],
+            " ".join(str(p) for p in row["prunes"]),
+            row["time"] / row["nodes"] / 1e3))
+
+def dot(nodes, max_nodes):
+    print("digraph trace {")
+    for i, node in enumerate(nodes[:max_nodes]):
+        if node["kind"] == EXPAND:
+            label, color = "{}".format(node["task"]), "white"
+        elif node["kind"] == LEAF:
+            label = "{}\\nlen {}".format(node["task"], node["value"])
+            color = "gold" if node["incumbent"] else "palegreen"
+        else:
+            label = "{}\\n{} {}>={}".format(
+                node["task"], STAGE_NAMES[node["stage"]], node["value"],
+                node["best"])
+            color = "lightpink"
+        print('\t{} [label="{}", style=filled, fillcolor={}];'.format(
+            i, label, color))
+        if len(node["path"]) > 1 and node["path"][-2] is not None:
+            print("\t{} -> {};".format(node["path"][-2], i))
+    print("}")
+
+def folded(nodes):
+    for node in nodes:
+        tasks = ["block{}".format(node["block"])]
+        tasks += [str(nodes[j]["task"]) for j in node["path"]
+                  if j is not None]
+        print("{} {}".format(";".join(tasks), node["time"]))
+
+if __name__ == "__main__":
+    if len(sys.argv) < 2 or len(sys.argv) > 4:
+        sys.exit(__doc__)
+    mode = sys.argv[2] if len(sys.argv) > 2 else "summary"
+    events = read_events(sys.argv[1])
+    nodes = read_nodes(events)
+    if mode == "summary":
+        summary(events, nodes)
+    elif mode == "dot":
+        dot(nodes, int(sys.argv[3]) if len(sys.argv) > 3 else 1000)
+    elif mode == "folded":
+        folded(nodes)
+    else:
+        sys.exit(__doc__)
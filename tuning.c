@@ -0,0 +1,339 @@
+#include <assert.h>
+#include <errno.h>
+#include <float.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bbsearch.h"
+#include "dag.h"
+#include "tuning.h"
+#include "vector.h"
+
+// the longest line of a rule file
+#define LINE_MAX_LEN (512)
+
+// the built in table, in the format of tuning_read
+static const char *default_table =
+    // searches of generated dags this large only proved the optima
+    // that the list schedule meets the bound of, and the presolve
+    // takes seconds from 1000 tasks on
+    "n=200.. engine=heuristic\n"
+    // the width shortcut closes these before any search
+    "ratio=1..\n"
+    // a short search, then the dynamic program
+    "n=..62 search=dfs dp=1\n"
+    // limited discrepancy search proves more of large_data than depth
+    // first search with either bound, and the portfolio more still
+    "search=lds threads=3\n";
+
+DECLARE_VECTOR(rule_vec, tuning_rule);
+DEFINE_VECTOR(rule_vec, tuning_rule);
+
+struct tuning {
+    rule_vec rules;
+};
+
+static const char *engine_names[N_ENGINES] = {
+    [ENGINE_SEARCH] = "search",
+    [ENGINE_HEURISTIC] = "heuristic",
+};
+
+const char *engine_name(engine e) {
+    assert(e < N_ENGINES);
+    return engine_names[e];
+}
+
+int engine_parse(const char *name, engine *e) {
+    assert(name != NULL);
+    assert(e != NULL);
+    for (int i = 0; i < N_ENGINES; i++) {
+        if (strcmp(name, engine_names[i]) == 0) {
+            *e = i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int features_compute(dag *g, unsigned m, features *f) {
+    assert(g != NULL);
+    assert(m > 0);
+    assert(f != NULL);
+    size_t size = dag_size(g);
+    f->n = size - 2;
+    f->width = 0;
+    f->strength = 0;
+    f->ratio = 0;
+    if (f->n == 0 || size > FEATURES_MAX_SIZE) {
+        return 0;
+    }
+    dag *reduced = bbsearch_reduce(g);
+    if (reduced == NULL) {
+        return -1;
+    }
+    size_t width = dag_width(reduced);
+    // every task reaches the sink, which is not a task
+    unsigned long long pairs = 0;
+    for (unsigned i = 1; i + 1 < size; i++) {
+        pairs += dag_ndescs(reduced, i) - 1;
+    }
+    if (reduced != g) {
+        dag_destroy(reduced);
+    }
+    if (width == (size_t) -1) {
+        return -1;
+    }
+    f->width = width;
+    if (f->n > 1) {
+        f->strength = pairs / ((double) f->n * (f->n - 1) / 2);
+    }
+    f->ratio = (double) m / width;
+    return 0;
+}
+
+// parses `text', of the form <lo>..<hi> where either end may be left
+// out, into `lo' and `hi', which keep their values for a missing end.
+// Returns 0 on success and -1 on a malformed range.
+static int parse_range(const char *text, double *lo, double *hi) {
+    const char *dots = strstr(text, "..");
+    if (dots == NULL) {
+        return -1;
+    }
+    char *end;
+    if (dots != text) {
+        // strtod would take "1." of "1..2" as a number
+        char lo_text[LINE_MAX_LEN];
+        size_t len = dots - text;
+        memcpy(lo_text, text, len);
+        lo_text[len] = '\0';
+        errno = 0;
+        *lo = strtod(lo_text, &end);
+        if (*end != '\0' || errno != 0) {
+            return -1;
+        }
+    }
+    if (dots[2] != '\0') {
+        errno = 0;
+        *hi = strtod(dots + 2, &end);
+        if (*end != '\0' || errno != 0) {
+            return -1;
+        }
+    }
+    return (*lo <= *hi) ? 0 : -1;
+}
+
+// sets a key of `rule' from `value'. Returns 0 on success and -1 on an
+// unknown key or a bad value.
+static int parse_key(tuning_rule *rule, const char *key, const char *value) {
+    if (strcmp(key, "n") == 0) {
+        double lo = rule->min_n;
+        double hi = (double) rule->max_n;
+        if (parse_range(value, &lo, &hi) != 0 || lo < 0) {
+            return -1;
+        }
+        rule->min_n = lo;
+        rule->max_n = (hi >= (double) SIZE_MAX) ? SIZE_MAX : (size_t) hi;
+        return 0;
+    }
+    if (strcmp(key, "strength") == 0) {
+        return parse_range(value, &rule->min_strength, &rule->max_strength);
+    }
+    if (strcmp(key, "ratio") == 0) {
+        return parse_range(value, &rule->min_ratio, &rule->max_ratio);
+    }
+    if (strcmp(key, "engine") == 0) {
+        return engine_parse(value, &rule->engine);
+    }
+    if (strcmp(key, "bounds") == 0) {
+        return bound_parse(value, &rule->bounds);
+    }
+    if (strcmp(key, "search") == 0) {
+        return driver_parse(value, &rule->driver);
+    }
+    char *end;
+    long n = strtol(value, &end, 10);
+    if (*end != '\0' || end == value) {
+        return -1;
+    }
+    if (strcmp(key, "dp") == 0 && (n == 0 || n == 1)) {
+        rule->dp = n;
+        return 0;
+    }
+    if (strcmp(key, "threads") == 0 && n > 0 && n <= UINT_MAX) {
+        rule->threads = n;
+        return 0;
+    }
+    return -1;
+}
+
+// parses one line of a table and adds its rule to `t', unless the line
+// is blank or a comment. Changes `line'. Returns 0 on success and -1
+// on a malformed line or failure.
+static int parse_line(tuning *t, char *line) {
+    bbopts defaults;
+    bbopts_init(&defaults);
+    tuning_rule rule = {
+        .min_n = 0,
+        .max_n = SIZE_MAX,
+        .min_strength = 0,
+        .max_strength = 1,
+        .min_ratio = 0,
+        .max_ratio = DBL_MAX,
+        .engine = ENGINE_SEARCH,
+        .bounds = defaults.bounds,
+        .driver = defaults.driver,
+        .dp = defaults.dp,
+        .threads = 1,
+    };
+    int words = 0;
+    while (1) {
+        line += strspn(line, " \t\r\n");
+        if (*line == '\0' || *line == '#') {
+            break;
+        }
+        char *word = line;
+        line += strcspn(line, " \t\r\n");
+        if (*line != '\0') {
+            *line++ = '\0';
+        }
+        char *value = strchr(word, '=');
+        if (value == NULL) {
+            return -1;
+        }
+        *value++ = '\0';
+        if (parse_key(&rule, word, value) != 0) {
+            return -1;
+        }
+        words++;
+    }
+    if (words == 0) {
+        return 0;
+    }
+    return rule_vec_push(&t->rules, rule);
+}
+
+static tuning *tuning_create(void) {
+    tuning *t = malloc(sizeof(*t));
+    if (t == NULL) {
+        return NULL;
+    }
+    if (rule_vec_init(&t->rules, 8) != 0) {
+        free(t);
+        return NULL;
+    }
+    return t;
+}
+
+tuning *tuning_default(void) {
+    tuning *t = tuning_create();
+    if (t == NULL) {
+        return NULL;
+    }
+    char line[LINE_MAX_LEN];
+    for (const char *text = default_table; *text != '\0';) {
+        size_t len = strcspn(text, "\n");
+        assert(len < LINE_MAX_LEN);
+        memcpy(line, text, len);
+        line[len] = '\0';
+        if (parse_line(t, line) != 0) {
+            tuning_destroy(t);
+            return NULL;
+        }
+        text += (text[len] == '\n') ? len + 1 : len;
+    }
+    return t;
+}
+
+tuning *tuning_read(const char *path) {
+    assert(path != NULL);
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        return NULL;
+    }
+    tuning *t = tuning_create();
+    if (t == NULL) {
+        fclose(f);
+        return NULL;
+    }
+    char line[LINE_MAX_LEN];
+    while (fgets(line, sizeof(line), f) != NULL) {
+        if (strchr(line, '\n') == NULL && !feof(f)) {
+            goto err;
+        }
+        if (parse_line(t, line) != 0) {
+            goto err;
+        }
+    }
+    if (ferror(f)) {
+        goto err;
+    }
+    fclose(f);
+    return t;
+ err:
+    tuning_destroy(t);
+    fclose(f);
+    return NULL;
+}
+
+void tuning_destroy(tuning *t) {
+    assert(t != NULL);
+    rule_vec_destroy(&t->rules);
+    free(t);
+}
+
+size_t tuning_size(const tuning *t) {
+    assert(t != NULL);
+    return t->rules.size;
+}
+
+// returns 1 if `rule' matches `f', 0 otherwise.
+static int rule_matches(const tuning_rule *rule, const features *f) {
+    if (f->n < rule->min_n || f->n > rule->max_n) {
+        return 0;
+    }
+    int narrows = rule->min_strength > 0 || rule->max_strength < 1 ||
+        rule->min_ratio > 0 || rule->max_ratio < DBL_MAX;
+    if (f->width == 0) {
+        return !narrows;
+    }
+    return f->strength >= rule->min_strength &&
+        f->strength <= rule->max_strength && f->ratio >= rule->min_ratio &&
+        f->ratio <= rule->max_ratio;
+}
+
+int tuning_match(const tuning *t, const features *f) {
+    assert(t != NULL);
+    assert(f != NULL);
+    for (size_t i = 0; i < t->rules.size; i++) {
+        if (rule_matches(&t->rules.data[i], f)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+const tuning_rule *tuning_rule_get(const tuning *t, size_t index) {
+    assert(t != NULL);
+    assert(index < t->rules.size);
+    return &t->rules.data[index];
+}
+
+void tuning_apply(const tuning_rule *rule, unsigned max_threads,
+                  engine *e, bbopts *opts) {
+    assert(rule != NULL);
+    assert(e != NULL);
+    assert(opts != NULL);
+    *e = rule->engine;
+    opts->bounds = rule->bounds;
+    opts->driver = rule->driver;
+    opts->dp = rule->dp;
+    unsigned threads = (rule->threads < max_threads) ? rule->threads :
+        max_threads;
+    opts->portfolio = threads >= 3;
+    if (threads == 2) {
+        opts->direction = DIRECTION_RACE;
+    }
+}
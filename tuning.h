@@ -0,0 +1,104 @@
+#ifndef TUNING_H
+#define TUNING_H
+
+#include "bbsearch.h"
+#include "dag.h"
+
+// Picks how to solve a dag from a few cheap features of it, by the
+// first rule of a table that matches them. The built in table follows
+// batch runs over series/, large_data/ and generated dags; runTuning in
+// experiments.py derives one from new runs, in the format of
+// tuning_read.
+
+// dags up to this size get a width and an order strength, which take
+// the closure and a bipartite matching over it. Larger ones only have
+// a size.
+#define FEATURES_MAX_SIZE (1 << 12)
+
+typedef struct features {
+    // tasks, without the source and sink
+    size_t n;
+    // the size of the largest set of pairwise independent tasks, and
+    // the fraction of task pairs joined by a path, or both 0 for dags
+    // above FEATURES_MAX_SIZE
+    size_t width;
+    double strength;
+    // machines per task of the width, or 0 without a width. From 1 on,
+    // no task ever waits for a machine.
+    double ratio;
+} features;
+
+// what a rule runs
+typedef enum engine {
+    // bbsearch with the rule's options
+    ENGINE_SEARCH,
+    // a single list schedule by level, as bbexps --heuristic
+    ENGINE_HEURISTIC,
+    N_ENGINES
+} engine;
+
+typedef struct tuning_rule {
+    // the rule matches dags with n, strength and ratio in these closed
+    // ranges. A rule that narrows strength or ratio never matches a
+    // dag without them.
+    size_t min_n, max_n;
+    double min_strength, max_strength;
+    double min_ratio, max_ratio;
+    engine engine;
+    // the search's bound stages, driver and dynamic program
+    unsigned bounds;
+    search_driver driver;
+    int dp;
+    // the most threads the search may use: 2 race both directions and
+    // 3 or more race the bound portfolio
+    unsigned threads;
+} tuning_rule;
+
+struct tuning;
+typedef struct tuning tuning;
+
+// returns the name of the given engine.
+const char *engine_name(engine e);
+
+// parses an engine name into `e'. Returns 0 on success and -1 on an
+// unknown name.
+int engine_parse(const char *name, engine *e);
+
+// computes the features of `g' on `m' machines. Dags up to
+// FEATURES_MAX_SIZE are measured on a copy reduced by bbsearch_reduce,
+// so `g' keeps its edges. Returns 0 on success and -1 on failure.
+int features_compute(dag *g, unsigned m, features *f);
+
+// returns the built in table, or NULL on failure.
+tuning *tuning_default(void);
+
+// reads a table from a text file of one rule per line, first match
+// first. Blank lines and lines starting with '#' are skipped. A rule
+// is a list of key=value words:
+//   n=<lo>..<hi> strength=<lo>..<hi> ratio=<lo>..<hi>
+//     conditions, where either end of a range may be left out
+//   engine=search|heuristic bounds=<list> search=<driver> dp=0|1
+//   threads=<k>
+//     what to run, with bounds and search as for bbexps
+// Keys left out match anything, or run bbopts_init's defaults with one
+// thread. Returns NULL on a malformed file or failure.
+tuning *tuning_read(const char *path);
+
+void tuning_destroy(tuning *t);
+
+// returns the number of rules of the table.
+size_t tuning_size(const tuning *t);
+
+// returns the index of the first rule of `t' that matches `f', or -1
+// if none does.
+int tuning_match(const tuning *t, const features *f);
+
+// returns the rule of the given index.
+const tuning_rule *tuning_rule_get(const tuning *t, size_t index);
+
+// sets the engine and the fields of `opts' that `rule' covers, with at
+// most `max_threads' threads. Other fields keep their values.
+void tuning_apply(const tuning_rule *rule, unsigned max_threads,
+                  engine *e, bbopts *opts);
+
+#endif // TUNING_H